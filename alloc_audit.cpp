@@ -0,0 +1,155 @@
+#include "alloc_audit.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+	#define AUDIT_NOINLINE __declspec(noinline)
+#else
+	#define AUDIT_NOINLINE __attribute__((noinline))
+#endif
+
+// liczniki musza dzialac przed konstruktorami statycznymi i bez alokacji,
+// wiec sa zwyklymi zmiennymi atomowymi inicjalizowanymi stalymi
+static std::atomic<bool>				armed(false);
+static std::atomic<unsigned long long>	count(0);
+static std::atomic<unsigned long long>	bytes(0);
+
+void alloc_audit_arm()
+{
+	count = 0;
+	bytes = 0;
+	armed = true;
+}
+
+void alloc_audit_disarm()
+{
+	armed = false;
+}
+
+unsigned long long alloc_audit_count()
+{
+	return count;
+}
+
+unsigned long long alloc_audit_bytes()
+{
+	return bytes;
+}
+
+// osobna funkcja, zeby dalo sie na niej postawic pulapke
+extern "C" AUDIT_NOINLINE void alloc_audit_hit(size_t size)
+{
+	count.fetch_add(1, std::memory_order_relaxed);
+	bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static inline void note(size_t size)
+{
+	if (armed.load(std::memory_order_relaxed))
+		alloc_audit_hit(size);
+}
+
+#ifdef __GLIBC__
+
+// glibc: podmieniamy malloc i rodzine; operator new z libstdc++ i tak przez nie przechodzi
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t size);
+	void* __libc_memalign(size_t align, size_t size);
+
+	void* malloc(size_t size)
+	{
+		note(size);
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t n, size_t size)
+	{
+		note(n * size);
+		return __libc_calloc(n, size);
+	}
+
+	void* realloc(void* p, size_t size)
+	{
+		note(size);
+		return __libc_realloc(p, size);
+	}
+
+	void* aligned_alloc(size_t align, size_t size)
+	{
+		note(size);
+		return __libc_memalign(align, size);
+	}
+
+	void* memalign(size_t align, size_t size)
+	{
+		note(size);
+		return __libc_memalign(align, size);
+	}
+
+	int posix_memalign(void** out, size_t align, size_t size)
+	{
+		note(size);
+		void* p = __libc_memalign(align, size);
+
+		if (!p)
+			return 12; // ENOMEM
+
+		*out = p;
+		return 0;
+	}
+}
+
+#else
+
+// gdzie indziej liczymy tylko globalny operator new
+void* operator new(size_t size)
+{
+	note(size);
+
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	note(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nt) noexcept
+{
+	return operator new(size, nt);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+#endif
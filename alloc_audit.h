@@ -0,0 +1,19 @@
+#ifndef ALLOC_AUDIT_H
+#define ALLOC_AUDIT_H
+
+#include <cstddef>
+
+// liczenie alokacji na stercie (build z CHIP8_ALLOC_AUDIT). Podmieniamy malloc
+// i rodzine (glibc) albo globalny operator new (inne biblioteki); po
+// alloc_audit_arm() kazda alokacja z dowolnego watku jest liczona i przechodzi
+// przez alloc_audit_hit() - w debuggerze wystarczy "break alloc_audit_hit"
+
+void alloc_audit_arm();
+void alloc_audit_disarm();
+
+unsigned long long alloc_audit_count();
+unsigned long long alloc_audit_bytes();
+
+extern "C" void alloc_audit_hit(size_t size);
+
+#endif
@@ -0,0 +1,173 @@
+#include "analysis.h"
+#include "hash.h"
+#include "mapfile.h"
+#include <cinttypes> // PRIx64
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+	#include <direct.h> // _mkdir
+#else
+	#include <sys/stat.h> // mkdir
+#endif
+
+using namespace std;
+
+struct CacheHeader
+{
+	char				magic[4];		// "C8AC"
+	uint32_t			version;
+	uint64_t			image_hash;
+	uint64_t			payload_hash;
+	uint32_t			payload_size;
+	uint32_t			reserved;
+};
+
+static const char cache_magic[4] = { 'C', '8', 'A', 'C' };
+static const uint32_t cache_format = 1;
+
+// zmiana formatu pliku albo rodzajow superinstrukcji uniewaznia stare wpisy
+static uint32_t cache_version()
+{
+	return cache_format << 16 | Chip8Core::analysis_version;
+}
+
+uint64_t image_hash(const Chip8Core& core)
+{
+	return hash64(core.image(), Chip8Core::ram_size);
+}
+
+std::string AnalysisCache::entry_path(const Chip8Core& core) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016" PRIx64 ".c8a", image_hash(core));
+
+	return dir + "/" + name;
+}
+
+bool AnalysisCache::read_entry(const std::string& path, uint64_t image_hash, Chip8Analysis& out)
+{
+	MappedFile file;
+
+	if (!file.open_read(path) || file.size() != sizeof(CacheHeader) + sizeof(Chip8Analysis))
+		return false;
+
+	CacheHeader hdr;
+	memcpy(&hdr, file.data(), sizeof(hdr));
+
+	if (memcmp(hdr.magic, cache_magic, sizeof(cache_magic)) != 0 || hdr.version != cache_version()
+		|| hdr.image_hash != image_hash || hdr.payload_size != sizeof(Chip8Analysis))
+	{
+		return false;
+	}
+
+	const unsigned char* payload = file.data() + sizeof(hdr);
+
+	if (hash64(payload, sizeof(Chip8Analysis)) != hdr.payload_hash)
+		return false;
+
+	memcpy(&out, payload, sizeof(Chip8Analysis));
+
+	return true;
+}
+
+bool AnalysisCache::load(Chip8Core& core)
+{
+	loaded_payload = 0;
+
+	if (dir.empty())
+		return false;
+
+	MappedFile file;
+
+	if (!file.open_read(entry_path(core)) || file.size() != sizeof(CacheHeader) + sizeof(Chip8Analysis))
+		return false;
+
+	CacheHeader hdr;
+	memcpy(&hdr, file.data(), sizeof(hdr));
+
+	if (memcmp(hdr.magic, cache_magic, sizeof(cache_magic)) != 0 || hdr.version != cache_version()
+		|| hdr.image_hash != image_hash(core) || hdr.payload_size != sizeof(Chip8Analysis))
+	{
+		return false;
+	}
+
+	// dane czytamy prosto z mapowania, bez kopii posredniej
+	const Chip8Analysis* analysis = reinterpret_cast<const Chip8Analysis*>(file.data() + sizeof(hdr));
+
+	if (hash64(analysis, sizeof(Chip8Analysis)) != hdr.payload_hash || !core.import_analysis(*analysis))
+		return false;
+
+	loaded_payload = hdr.payload_hash;
+
+	return true;
+}
+
+bool AnalysisCache::store(const Chip8Core& core)
+{
+	if (dir.empty())
+		return false;
+
+	vector<unsigned char> buf(sizeof(CacheHeader) + sizeof(Chip8Analysis));
+	Chip8Analysis* analysis = reinterpret_cast<Chip8Analysis*>(&buf[sizeof(CacheHeader)]);
+
+	core.export_analysis(*analysis);
+
+	if (analysis->code_count == 0)
+		return false;
+
+	CacheHeader hdr;
+	memcpy(hdr.magic, cache_magic, sizeof(cache_magic));
+	hdr.version = cache_version();
+	hdr.image_hash = image_hash(core);
+	hdr.payload_hash = hash64(analysis, sizeof(Chip8Analysis));
+	hdr.payload_size = sizeof(Chip8Analysis);
+	hdr.reserved = 0;
+
+	// nic nowego od wczytania
+	if (hdr.payload_hash == loaded_payload)
+		return true;
+
+	memcpy(&buf[0], &hdr, sizeof(hdr));
+
+#ifdef _WIN32
+	_mkdir(dir.c_str());
+#else
+	mkdir(dir.c_str(), 0755);
+#endif
+
+	// zapis do pliku tymczasowego i zamiana nazwy, zeby inny proces nigdy nie
+	// zobaczyl polowy wpisu
+	const string path = entry_path(core);
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%p.tmp", static_cast<const void*>(&core));
+	const string tmp = path + suffix;
+
+	FILE* f = fopen(tmp.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	const bool written = fwrite(&buf[0], 1, buf.size(), f) == buf.size();
+
+	if (fclose(f) != 0 || !written)
+	{
+		remove(tmp.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	remove(path.c_str());
+#endif
+
+	if (rename(tmp.c_str(), path.c_str()) != 0)
+	{
+		remove(tmp.c_str());
+		return false;
+	}
+
+	loaded_payload = hdr.payload_hash;
+
+	return true;
+}
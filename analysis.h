@@ -0,0 +1,38 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <cstdint>
+#include <string>
+#include "chip8core.h"
+
+// pamiec podreczna analizy kodu na dysku: jeden plik na gre, nazwany haszem
+// obrazu pamieci gry (czcionka + ROM). Przy starcie wpis jest mapowany
+// w pamieci, sprawdzany (wersja, hasz gry, suma kontrolna) i przenoszony do
+// rdzenia; nieaktualne albo uszkodzone wpisy sa pomijane i nadpisywane
+class AnalysisCache
+{
+private:
+	std::string			dir;
+	uint64_t			loaded_payload	= 0;	// suma kontrolna wczytanego wpisu (0 = brak)
+
+public:
+	explicit AnalysisCache(const std::string& cache_dir = "") : dir(cache_dir) {}
+
+	void set_dir(const std::string& cache_dir) { dir = cache_dir; loaded_payload = 0; }
+	bool enabled() const { return !dir.empty(); }
+
+	// wywolywane zaraz po wczytaniu gry; true = analiza pochodzi z dysku
+	bool load(Chip8Core& core);
+	// zapisuje analize, jesli od wczytania przybylo cos nowego
+	bool store(const Chip8Core& core);
+
+	std::string entry_path(const Chip8Core& core) const;
+
+	// odczyt i weryfikacja jednego wpisu (np. dla narzedzi)
+	static bool read_entry(const std::string& path, uint64_t image_hash, Chip8Analysis& out);
+};
+
+// hasz obrazu gry, pod ktorym zapisywana jest analiza
+uint64_t image_hash(const Chip8Core& core);
+
+#endif
@@ -0,0 +1,442 @@
+#include "capture.h"
+#include <iostream>
+#include <cstring> // memcpy, memcmp
+#include <chrono>
+#include <algorithm> // min, max, fill
+
+using namespace std;
+
+namespace
+{
+	// bitowy zapis kodow LZW w podblokach GIF-a (max 255 bajtow)
+	struct LzwWriter
+	{
+		FILE*			f;
+		BYTE			block[255];
+		int				block_len	= 0;
+		unsigned int	bits		= 0;
+		int				nbits		= 0;
+
+		explicit LzwWriter(FILE* out) : f(out) {}
+
+		void put_byte(BYTE b)
+		{
+			block[block_len++] = b;
+
+			if (block_len == 255)
+				flush_block();
+		}
+
+		void flush_block()
+		{
+			if (block_len == 0)
+				return;
+
+			fputc(block_len, f);
+			fwrite(block, 1, block_len, f);
+			block_len = 0;
+		}
+
+		void write_code(int code, int size)
+		{
+			bits |= static_cast<unsigned int>(code) << nbits;
+			nbits += size;
+
+			while (nbits >= 8)
+			{
+				put_byte(bits & 0xFF);
+				bits >>= 8;
+				nbits -= 8;
+			}
+		}
+
+		void finish()
+		{
+			if (nbits > 0)
+				put_byte(bits & 0xFF);
+
+			flush_block();
+			fputc(0, f); // koniec danych obrazu
+		}
+	};
+
+	void put_word(FILE* f, unsigned int v)
+	{
+		fputc(v & 0xFF, f);
+		fputc((v >> 8) & 0xFF, f);
+	}
+
+	// kompresja LZW pikseli o wartosciach 0/1 (paleta 2 kolorow, min. rozmiar kodu 2)
+	const int lzw_max_codes = 4096;
+
+	// tree: lzw_max_codes * 2 elementow, drzewo kodow - dla kazdego kodu nastepnik po pikselu 0 i 1
+	void write_lzw(FILE* f, const BYTE* px, int w, int h, vector<short>& tree)
+	{
+		const int min_code_size = 2;
+		const int clear_code = 1 << min_code_size;
+		const int max_codes = lzw_max_codes;
+
+		fill(tree.begin(), tree.end(), 0);
+
+		LzwWriter out(f);
+		fputc(min_code_size, f);
+
+		int code_size = min_code_size + 1;
+		int max_code = clear_code + 1;
+		int cur = -1;
+
+		out.write_code(clear_code, code_size);
+
+		for (int i = 0; i < w * h; i++)
+		{
+			const int next = px[i];
+
+			if (cur < 0)
+			{
+				cur = next;
+			}
+			else if (tree[cur * 2 + next])
+			{
+				cur = tree[cur * 2 + next];
+			}
+			else
+			{
+				out.write_code(cur, code_size);
+				tree[cur * 2 + next] = static_cast<short>(++max_code);
+
+				if (max_code >= (1 << code_size))
+					code_size++;
+
+				if (max_code == max_codes - 1)
+				{
+					// slownik pelny - zaczynamy od nowa
+					out.write_code(clear_code, code_size);
+					fill(tree.begin(), tree.end(), 0);
+					code_size = min_code_size + 1;
+					max_code = clear_code + 1;
+				}
+
+				cur = next;
+			}
+		}
+
+		out.write_code(cur, code_size);
+		out.write_code(clear_code, code_size);
+		out.write_code(clear_code + 1, min_code_size + 1);
+		out.finish();
+	}
+}
+
+FrameCapture::FrameCapture()
+	: head(0), tail(0), dropped_frames(0), running(false)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+	close();
+}
+
+bool FrameCapture::open(const std::string& y4m_path, const std::string& gif_path, int pixel_scale, bool wait_for_encoder)
+{
+	close();
+
+	scale = pixel_scale > 0 ? pixel_scale : 1;
+	blocking = wait_for_encoder;
+
+	if (!y4m_path.empty())
+	{
+		y4m = fopen(y4m_path.c_str(), "wb");
+
+		if (!y4m)
+			cerr << "Can't open capture file " << y4m_path << endl;
+		else
+			fprintf(y4m, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444\n", width * scale, height * scale);
+	}
+
+	if (!gif_path.empty())
+	{
+		gif = fopen(gif_path.c_str(), "wb");
+
+		if (!gif)
+			cerr << "Can't open capture file " << gif_path << endl;
+		else
+			write_gif_header();
+	}
+
+	if (!y4m && !gif)
+		return false;
+
+	// bufory kodera przygotowane z gory - watek kodera nie alokuje w trakcie nagrania
+	if (y4m)
+		y4m_frame.resize(width * scale * height * scale * 3);
+
+	if (gif)
+	{
+		gif_rect.resize(width * scale * height * scale);
+		lzw_tree.resize(lzw_max_codes * 2);
+	}
+
+	queue.resize(queue_slots);
+	head = 0;
+	tail = 0;
+	dropped_frames = 0;
+	reported_drops = 0;
+	have_last = false;
+	have_prev = false;
+	gif_delay_pos = -1;
+	gif_time_cs = 0;
+
+	running = true;
+	worker = thread(&FrameCapture::worker_loop, this);
+
+	return true;
+}
+
+void FrameCapture::close(unsigned int end_frame)
+{
+	if (!running)
+		return;
+
+	// watek kodera oprozni kolejke przed zakonczeniem
+	running = false;
+	worker.join();
+
+	// klatki bez zmian po ostatniej zakolejkowanej tez naleza do nagrania
+	if (have_prev && end_frame < prev_frame_no + 1)
+		end_frame = prev_frame_no + 1;
+
+	if (gif)
+	{
+		if (have_prev)
+			patch_gif_delay(end_frame);
+
+		fputc(0x3B, gif); // koniec pliku GIF
+		fclose(gif);
+		gif = nullptr;
+	}
+
+	if (y4m)
+	{
+		if (have_prev)
+			write_y4m_frame(end_frame - prev_frame_no - 1);
+
+		fclose(y4m);
+		y4m = nullptr;
+	}
+
+	if (dropped_frames)
+		cerr << "Capture: " << dropped_frames << " frames dropped (queue overflow).\n";
+}
+
+void FrameCapture::push(const BYTE* fb, unsigned int frame_no)
+{
+	if (!running)
+		return;
+
+	// nic sie nie zmienilo od ostatniej zakolejkowanej klatki
+	if (have_last && memcmp(last_pushed, fb, sizeof(last_pushed)) == 0)
+		return;
+
+	const unsigned int h = head.load(memory_order_relaxed);
+
+	while (h - tail.load(memory_order_acquire) >= queue_slots)
+	{
+		if (!blocking)
+		{
+			dropped_frames.fetch_add(1, memory_order_relaxed);
+			return;
+		}
+
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+
+	Frame& f = queue[h % queue_slots];
+	f.frame_no = frame_no;
+	memcpy(f.pixels, fb, sizeof(f.pixels));
+	head.store(h + 1, memory_order_release);
+
+	memcpy(last_pushed, fb, sizeof(last_pushed));
+	have_last = true;
+}
+
+void FrameCapture::worker_loop()
+{
+	for (;;)
+	{
+		const unsigned int t = tail.load(memory_order_relaxed);
+
+		if (t == head.load(memory_order_acquire))
+		{
+			if (!running)
+				break;
+
+			this_thread::sleep_for(chrono::milliseconds(2));
+			continue;
+		}
+
+		encode(queue[t % queue_slots]);
+		tail.store(t + 1, memory_order_release);
+
+		const unsigned int drops = dropped_frames.load(memory_order_relaxed);
+
+		if (drops != reported_drops)
+		{
+			cerr << "Warning: capture queue overflow, " << drops << " frames dropped so far.\n";
+			reported_drops = drops;
+		}
+	}
+}
+
+void FrameCapture::encode(const Frame& f)
+{
+	if (y4m)
+	{
+		// klatki bez zmian powtarzamy, zeby zachowac stale 60 fps
+		if (have_prev && f.frame_no - prev_frame_no > 1)
+			write_y4m_frame(f.frame_no - prev_frame_no - 1);
+
+		const int w = width * scale;
+		const int h = height * scale;
+
+		BYTE* luma = &y4m_frame[0];
+
+		for (int y = 0; y < h; y++)
+		{
+			const BYTE* src = &f.pixels[(y / scale) * width];
+
+			for (int x = 0; x < w; x++)
+				*luma++ = src[x / scale] ? 255 : 0;
+		}
+
+		// chrominancja stala - obraz jest czarno-bialy
+		memset(&y4m_frame[w * h], 128, w * h * 2);
+
+		write_y4m_frame(1);
+	}
+
+	if (gif)
+	{
+		if (have_prev)
+			patch_gif_delay(f.frame_no);
+
+		write_gif_frame(f.pixels, f.frame_no);
+	}
+
+	memcpy(prev, f.pixels, sizeof(prev));
+	prev_frame_no = f.frame_no;
+	have_prev = true;
+}
+
+void FrameCapture::write_y4m_frame(unsigned int repeat)
+{
+	while (repeat--)
+	{
+		fputs("FRAME\n", y4m);
+		fwrite(&y4m_frame[0], 1, y4m_frame.size(), y4m);
+	}
+}
+
+void FrameCapture::write_gif_header()
+{
+	fwrite("GIF89a", 1, 6, gif);
+	put_word(gif, width * scale);
+	put_word(gif, height * scale);
+	fputc(0x80, gif); // globalna paleta z 2 kolorami
+	fputc(0, gif); // kolor tla
+	fputc(0, gif); // proporcje piksela
+
+	const BYTE palette[] = { 0, 0, 0, 255, 255, 255 };
+	fwrite(palette, 1, sizeof(palette), gif);
+
+	// zapetlanie animacji
+	const BYTE loop[] = { 0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 0x03, 0x01, 0x00, 0x00, 0x00 };
+	fwrite(loop, 1, sizeof(loop), gif);
+}
+
+void FrameCapture::write_gif_frame(const BYTE* px, unsigned int frame_no)
+{
+	// prostokat obejmujacy piksele zmienione od poprzedniej klatki
+	int x0 = 0, y0 = 0, x1 = width - 1, y1 = height - 1;
+
+	if (have_prev)
+	{
+		x0 = width;
+		y0 = height;
+		x1 = -1;
+		y1 = -1;
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				if (px[y * width + x] != prev[y * width + x])
+				{
+					x0 = min(x0, x);
+					x1 = max(x1, x);
+					y0 = min(y0, y);
+					y1 = max(y1, y);
+				}
+			}
+		}
+
+		if (x1 < 0)
+		{
+			x0 = x1 = 0;
+			y0 = y1 = 0;
+		}
+	}
+	else
+	{
+		gif_time_cs = frame_no * 100 / 60;
+	}
+
+	const int rw = (x1 - x0 + 1) * scale;
+	const int rh = (y1 - y0 + 1) * scale;
+
+	// rozszerzenie sterujace: bez usuwania poprzedniej klatki, opoznienie uzupelniamy pozniej
+	fputc(0x21, gif);
+	fputc(0xF9, gif);
+	fputc(0x04, gif);
+	fputc(0x04, gif);
+	gif_delay_pos = ftell(gif);
+	put_word(gif, 0);
+	fputc(0, gif);
+	fputc(0, gif);
+
+	// deskryptor obrazu
+	fputc(0x2C, gif);
+	put_word(gif, x0 * scale);
+	put_word(gif, y0 * scale);
+	put_word(gif, rw);
+	put_word(gif, rh);
+	fputc(0, gif);
+
+	BYTE* rect = &gif_rect[0];
+
+	for (int y = 0; y < rh; y++)
+	{
+		const BYTE* src = &px[(y0 + y / scale) * width + x0];
+
+		for (int x = 0; x < rw; x++)
+			rect[y * rw + x] = src[x / scale];
+	}
+
+	write_lzw(gif, rect, rw, rh, lzw_tree);
+}
+
+void FrameCapture::patch_gif_delay(unsigned int frame_no)
+{
+	if (gif_delay_pos < 0)
+		return;
+
+	// opoznienie liczymy od poczatku nagrania, zeby zaokraglenia sie nie sumowaly.
+	// Przegladarki traktuja opoznienia ponizej 2 cs jako 10 cs, stad minimum
+	const unsigned int target = frame_no * 100 / 60;
+	const unsigned int delay = target > gif_time_cs + 2 ? target - gif_time_cs : 2;
+	gif_time_cs += delay;
+
+	fseek(gif, gif_delay_pos, SEEK_SET);
+	put_word(gif, delay);
+	fseek(gif, 0, SEEK_END);
+}
@@ -0,0 +1,83 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chip8core.h"
+
+// nagrywanie obrazu do Y4M (bezstratnie, dla narzedzi) i animowanego GIF-a.
+// Watek emulacji tylko kopiuje zmieniona klatke do kolejki, a kodowaniem
+// i zapisem na dysk zajmuje sie osobny watek. Gdy kolejka jest pelna,
+// emulacja w czasie rzeczywistym pomija klatke (i liczy ja jako zgubiona),
+// a nagranie blokujace (bez czasu rzeczywistego) czeka na wolne miejsce
+class FrameCapture
+{
+public:
+	static const int			width			= Chip8Core::width;
+	static const int			height			= Chip8Core::height;
+	static const unsigned int	queue_slots		= 256;
+
+private:
+	struct Frame
+	{
+		unsigned int	frame_no;
+		BYTE			pixels[height * width];
+	};
+
+	// kolejka jeden producent - jeden konsument
+	std::vector<Frame>			queue;
+	std::atomic<unsigned int>	head;
+	std::atomic<unsigned int>	tail;
+	std::atomic<unsigned int>	dropped_frames;
+	std::atomic<bool>			running;
+	bool						blocking		= false;
+	std::thread					worker;
+
+	// strona producenta
+	BYTE						last_pushed[height * width];
+	bool						have_last		= false;
+
+	// strona kodera
+	int							scale			= 1;
+	FILE*						y4m				= nullptr;
+	FILE*						gif				= nullptr;
+	std::vector<BYTE>			y4m_frame;
+	std::vector<BYTE>			gif_rect;
+	std::vector<short>			lzw_tree;
+	BYTE						prev[height * width];
+	unsigned int				prev_frame_no	= 0;
+	bool						have_prev		= false;
+	long						gif_delay_pos	= -1;
+	unsigned int				gif_time_cs		= 0;
+	unsigned int				reported_drops	= 0;
+
+public:
+	FrameCapture();
+	~FrameCapture();
+
+	// puste sciezki wylaczaja dany format; scale to rozmiar piksela w pikselach.
+	// wait_for_encoder: push() czeka na koder zamiast gubic klatki (np. chip8_headless)
+	bool open(const std::string& y4m_path, const std::string& gif_path, int pixel_scale, bool wait_for_encoder = false);
+	// end_frame: numer klatki po ostatniej nagrywanej; ostatni obraz trwa do niej
+	// (0 = konczy sie na ostatniej zakolejkowanej klatce)
+	void close(unsigned int end_frame = 0);
+	bool is_open() const { return running; }
+
+	// wywolywane z watku emulacji po kazdej klatce; kolejkuje tylko zmienione klatki
+	void push(const BYTE* fb, unsigned int frame_no);
+
+	unsigned int dropped() const { return dropped_frames; }
+
+private:
+	void worker_loop();
+	void encode(const Frame& f);
+	void write_y4m_frame(unsigned int repeat);
+	void write_gif_header();
+	void write_gif_frame(const BYTE* px, unsigned int frame_no);
+	void patch_gif_delay(unsigned int frame_no);
+};
+
+#endif
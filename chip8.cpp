@@ -1,36 +1,128 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include "chip8.h"
-#include "INIReader.h"
+#include "config.h"
+#include "romfile.h"
 #include <iostream>
-#include <fstream>
-#include <iomanip> // cout hex value
-#include <cstdlib> // srand
 #include <ctime> // time
 #include "elapsedtimer.h"
 
 using namespace std;
 
 Chip8::Chip8(std::string cfg_filepath)
+	: gdb(core)
 {
-	INIReader cfg(cfg_filepath);
+	Chip8Config cfg;
+	load_config(cfg_filepath, cfg);
 
-	if (cfg.ParseError() == 0)
-	{
-		// tutaj mamy poprawnie wczytany plik konfiguracyjny
+	rom_path = cfg.rom_path;
+	pixel_size = cfg.pixel_size;
+	core.set_cycles_per_frame(cfg.cycles_per_frame);
+	core.set_timing(cfg.timing);
+	core.set_fusion(cfg.fusion);
+
+	// obie strony gry przez siec musza miec to samo ziarno
+	const bool netplay = !cfg.netplay_peer.empty();
+
+	if (cfg.seed)
+		core.set_seed(cfg.seed);
+	else if (!netplay)
+		core.set_seed(static_cast<unsigned int>(time(nullptr)));
 
-		rom_path = cfg.Get("", "rom_path", rom_path);
-		pixel_size = static_cast<int>(cfg.GetInteger("", "pixel_size", pixel_size));
+	log_set_level(cfg.log_level);
+	ahead.set_depth(cfg.runahead);
+	cache.set_dir(cfg.analysis_cache);
+
+	if (!cfg.profile.empty())
+	{
+		profile = new Chip8Profile;
+		profile_path = cfg.profile;
+		core.set_profile(profile);
 	}
 
-	srand(static_cast<unsigned int>(time(nullptr)));
+	phosphor.set_decay(cfg.phosphor_decay);
+
+	if (cfg.frame_stats || cfg.frame_overlay)
+	{
+		stats = new FrameStats;
+		overlay = cfg.frame_overlay;
+	}
 
 	init_display();
 	init();
+
+	// wznowiona sesja rozjechalaby sie z drugim graczem
+	if (!cfg.session_file.empty() && loaded && !netplay)
+	{
+		bool resumed;
+		session.set_interval(cfg.session_checkpoint);
+
+		if (session.open(cfg.session_file, core, resumed) && resumed)
+		{
+			frame_no = static_cast<unsigned int>(session.frame_number());
+			cout << "Resuming session from frame " << frame_no << ".\n";
+		}
+	}
+	else if (!cfg.session_file.empty() && netplay)
+		cerr << "session_file is ignored in netplay.\n";
+
+	if (netplay && loaded)
+	{
+		net = new Netplay(core);
+
+		if (!net->open(cfg.netplay_local, cfg.netplay_peer, cfg.netplay_latency))
+		{
+			delete net;
+			net = nullptr;
+		}
+	}
+
+	if (!cfg.capture_y4m.empty() || !cfg.capture_gif.empty())
+		capture.open(cfg.capture_y4m, cfg.capture_gif, pixel_size);
+
+	if (!cfg.gdb.empty())
+		gdb.listen(cfg.gdb);
+
+	if (!cfg.shm_export.empty() && loaded)
+		shm.create(cfg.shm_export, core);
 }
 
 Chip8::~Chip8()
 {
+	gdb.close();
+	shm.close();
+	session.close();
+	capture.close(frame_no);
+
+	if (net)
+	{
+		cout << net->report() << "\n";
+		delete net;
+	}
+
+	if (loaded)
+		cache.store(core);
+
+	if (profile)
+	{
+		core.set_profile(nullptr);
+
+		if (!profile->write_collapsed(profile_path))
+			cerr << "Can't write profile " << profile_path << endl;
+
+		cout << profile->report() << "\n";
+		delete profile;
+	}
+
+	if (stats)
+	{
+		cout << stats->report() << "\n";
+		delete stats;
+	}
+
+	if (screen_tex)
+		SDL_DestroyTexture(screen_tex);
+
 	if (renderer)
 		SDL_DestroyRenderer(renderer);
 
@@ -58,239 +150,111 @@ int Chip8::game_loop()
 
 	cout << "\nStarting the game...\n\n";
 
-	WORD opcode = 0;
 	ElapsedTimer tim(1000 / 60);
 	
 	while (alive)
 	{
-		opcode = fetch_opcode();
-		decode_opcode(opcode);
-
 		if (tim.elapsed())
 		{
-			draw();
-			decrement_timers();
-			read_keys();
 			tim.tic();
-		}
 
-		sdl_events();
+			if (gdb.is_listening())
+				gdb.poll(0);
 
-		SDL_Delay(2);
-	}
-
-	cout << "Game Over.\n";
-	
-	return 0;
-}
-
-void Chip8::init()
-{
-	// wyzerowanie pamieci przeznaczonej na gre
-	memset(game_memory, 0, ram_size);
-
-	// wyzerowanie rejestrow
-	memset(registers, 0, reg_size);
-
-	// wyzerowanie rejestru I
-	address_I = 0;
-
-	// ustawienie zmiennej program_counter na adres poczatku gry
-	program_counter = game_start_addr;
-
-	// czyscimy stos
-	while(!stack.empty())
-		stack.pop();
-
-	// czyscimy ekran
-	clear_display();
-
-	// resetujemy stan klawiatury
-	memset(key, 0, keys_number);
-
-	// zerujemy timery
-	delay_timer = 0;
-	sound_timer = 0;
-
-	// inicjalizujemy sprite'y cyfr w pamieci gry
-	init_digit_sprites();
+			bool done = false;
 
-	// wczytujemy plik z gra
+			// zatrzymany przez debugger rdzen stoi, ale okno dalej sie odswieza
+			if (net)
+			{
+				{
+					ProfileScope scope(profile, Chip8Profile::SUB_RUN_FRAME);
+					TimingScope timing(stats, FrameStats::EMULATE);
+					shm.begin_frame();
+					done = net->advance(keys);
+					shm.end_frame();
+				}
+
+				// przy czekaniu na drugiego gracza nie ma nowej klatki
+				if (done)
+				{
+					ProfileScope scope(profile, Chip8Profile::SUB_CAPTURE);
+					capture.push(core.framebuffer(), frame_no++);
+				}
+			}
+			else if (gdb.frame_done())
+			{
+				// klatka dokonczona krokowaniem w debuggerze
+				ahead.clear_prediction();
+				done = true;
 
-	ifstream file(rom_path, ifstream::binary);
+				ProfileScope scope(profile, Chip8Profile::SUB_CAPTURE);
+				capture.push(core.framebuffer(), frame_no++);
+				session.frame_done();
+			}
+			else if (!gdb.is_halted())
+			{
+				{
+					ProfileScope scope(profile, Chip8Profile::SUB_RUN_FRAME);
+					TimingScope timing(stats, FrameStats::EMULATE);
+					shm.begin_frame();
+					done = ahead.run_frame(core);
+					shm.end_frame();
+				}
+
+				if (done)
+				{
+					ProfileScope scope(profile, Chip8Profile::SUB_CAPTURE);
+					capture.push(ahead.framebuffer(core), frame_no++);
+					session.frame_done();
+				}
+				else
+					gdb.report_stop();
+			}
 
-	if (file)
-	{
-		cout << "Reading file " << rom_path << endl;
+			{
+				ProfileScope scope(profile, Chip8Profile::SUB_DRAW);
 
-		// wczytujemy rozmiar pliku
-		file.seekg(0, file.end);
-		const auto len = file.tellg();
-		file.seekg(0, file.beg);
+				{
+					TimingScope timing(stats, FrameStats::RENDER);
+					draw(done);
+				}
 
-		cout << "File size is " << len << " bytes.\n";
+				present();
+			}
 
-		if (len > (ram_size - game_start_addr))
-		{
-			cerr << "Game file is too big!\n";
-			loaded = false;
-			file.close();
-			return;
+			{
+				ProfileScope scope(profile, Chip8Profile::SUB_READ_KEYS);
+				read_keys();
+			}
 		}
 
-		file.read((char*)&game_memory[game_start_addr], len);
-
-		if (file)
 		{
-			cout << "File loaded successfully.\n";
-			loaded = true;
-		}
-		else
-		{
-			cerr << "Error: loaded only " << file.gcount() << " bytes.\n";
-			loaded = false;
+			ProfileScope scope(profile, Chip8Profile::SUB_SDL_EVENTS);
+			sdl_events();
 		}
 
-		file.close();
-	}
-	else
-	{
-		cerr << "Can't read file " << rom_path << endl;
-		loaded = false;
+		ProfileScope scope(profile, Chip8Profile::SUB_IDLE);
+		SDL_Delay(1);
 	}
+
+	cout << "Game Over.\n";
+
+	if (ahead.get_depth())
+		cout << ahead.report() << "\n";
+	
+	return 0;
 }
 
-void Chip8::init_digit_sprites()
+void Chip8::init()
 {
-	int cur_addr = 0; // wypelniamy pamiec gry od samego poczatku
-
-	// "0"
-	digit_sprite_addr[0] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "1"
-	digit_sprite_addr[1] = cur_addr;
-	game_memory[cur_addr++] = 0x20;
-	game_memory[cur_addr++] = 0x60;
-	game_memory[cur_addr++] = 0x20;
-	game_memory[cur_addr++] = 0x20;
-	game_memory[cur_addr++] = 0x70;
-
-	// "2"
-	digit_sprite_addr[2] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "3"
-	digit_sprite_addr[3] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "4"
-	digit_sprite_addr[4] = cur_addr;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0x10;
-
-	// "5"
-	digit_sprite_addr[5] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "6"
-	digit_sprite_addr[6] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "7"
-	digit_sprite_addr[7] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0x20;
-	game_memory[cur_addr++] = 0x40;
-	game_memory[cur_addr++] = 0x40;
-
-	// "8"
-	digit_sprite_addr[8] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "9"
-	digit_sprite_addr[9] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x10;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "A"
-	digit_sprite_addr[0xA] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0x90;
-
-	// "B"
-	digit_sprite_addr[0xB] = cur_addr;
-	game_memory[cur_addr++] = 0xE0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xE0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xE0;
-
-	// "C"
-	digit_sprite_addr[0xC] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "D"
-	digit_sprite_addr[0xD] = cur_addr;
-	game_memory[cur_addr++] = 0xE0;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0x90;
-	game_memory[cur_addr++] = 0xE0;
-
-	// "E"
-	digit_sprite_addr[0xE] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-
-	// "F"
-	digit_sprite_addr[0xF] = cur_addr;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0xF0;
-	game_memory[cur_addr++] = 0x80;
-	game_memory[cur_addr++] = 0x80;
+	// czyscimy ekran
+	clear_display();
+
+	// wczytujemy plik z gra
+	loaded = load_rom_file(rom_path, core);
+
+	if (loaded)
+		cache.load(core);
 }
 
 void Chip8::init_display()
@@ -328,6 +292,15 @@ void Chip8::init_display()
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 	SDL_RenderClear(renderer);
 	SDL_RenderPresent(renderer);
+
+	if (phosphor.enabled())
+	{
+		screen_tex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+
+		// bez tekstury zostaje zwykly obraz bez poswiaty
+		if (!screen_tex)
+			cerr << "SDL_CreateTexture Error: " << SDL_GetError() << endl;
+	}
 	
 	video_ok = true;
 }
@@ -337,22 +310,22 @@ void Chip8::clear_display()
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 	SDL_RenderClear(renderer);
 	SDL_RenderPresent(renderer);
+}
 
-	for (int y = 0; y < height; y++)
+void Chip8::draw(bool new_frame)
+{
+	if (screen_tex)
 	{
-		for (int x = 0; x < width; x++)
-		{
-			screen[x][y] = 0;
-		}
+		draw_phosphor(new_frame);
+		return;
 	}
-}
 
-void Chip8::draw()
-{
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
 	SDL_RenderClear(renderer);
 	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 
+	const BYTE* screen = ahead.framebuffer(core);
+
 	SDL_Rect r;
 	r.w = pixel_size;
 	r.h = pixel_size;
@@ -361,7 +334,7 @@ void Chip8::draw()
 	{
 		for (int x = 0; x < width; x++)
 		{
-			if (screen[x][y])
+			if (screen[y * Chip8Core::pitch() + x])
 			{
 				r.x = x * pixel_size;
 				r.y = y * pixel_size;
@@ -371,149 +344,143 @@ void Chip8::draw()
 		}
 	}
 
-	SDL_RenderPresent(renderer);
+	if (overlay)
+		draw_overlay();
 }
 
-WORD Chip8::fetch_opcode()
+void Chip8::draw_phosphor(bool new_frame)
 {
-	WORD ret = game_memory[program_counter++] << 8;
-	ret |= game_memory[program_counter++];
+	// poswiata gasnie z kazda klatka gry, a nie z kazdym odswiezeniem okna
+	// (np. przy zatrzymaniu przez debugger obraz stoi)
+	if (new_frame)
+		phosphor.update(ahead.framebuffer(core));
 
-	return ret;
-}
+	void* pixels;
+	int pitch;
 
-void Chip8::decode_opcode(const WORD& opcode)
-{
-	switch (opcode & 0xF000)
+	if (SDL_LockTexture(screen_tex, nullptr, &pixels, &pitch) == 0)
 	{
-	case 0x0000:
-	{
-		switch (opcode & 0x00FF)
-		{
-		case 0x00E0: opcode_00E0(); break;
-		case 0x00EE: opcode_00EE(); break;
-		default:
-			cout << "Warning: unexpected opcode 0x" << hex << uppercase << opcode << dec << endl;
-			break;
-		}
-	}
-		break;
-	case 0x1000: opcode_1nnn(opcode); break;
-	case 0x2000: opcode_2nnn(opcode); break;
-	case 0x3000: opcode_3xkk(opcode); break;
-	case 0x4000: opcode_4xkk(opcode); break;
-	case 0x5000: opcode_5xy0(opcode); break;
-	case 0x6000: opcode_6xkk(opcode); break;
-	case 0x7000: opcode_7xkk(opcode); break;
-	case 0x8000:
-	{
-		switch (opcode & 0x000F)
-		{
-		case 0x0000: opcode_8xy0(opcode); break;
-		case 0x0001: opcode_8xy1(opcode); break;
-		case 0x0002: opcode_8xy2(opcode); break;
-		case 0x0003: opcode_8xy3(opcode); break;
-		case 0x0004: opcode_8xy4(opcode); break;
-		case 0x0005: opcode_8xy5(opcode); break;
-		case 0x0006: opcode_8xy6(opcode); break;
-		case 0x0007: opcode_8xy7(opcode); break;
-		case 0x000E: opcode_8xyE(opcode); break;
-		default:
-			cout << "Warning: unexpected opcode 0x" << hex << uppercase << opcode << dec << endl;
-			break;
-		}
+		phosphor.to_argb(static_cast<uint32_t*>(pixels), pitch);
+		SDL_UnlockTexture(screen_tex);
 	}
-		break;
-	case 0x9000: opcode_9xy0(opcode); break;
-	case 0xA000: opcode_Annn(opcode); break;
-	case 0xB000: opcode_Bnnn(opcode); break;
-	case 0xC000: opcode_Cxkk(opcode); break;
-	case 0xD000: opcode_Dxyn(opcode); break;
-	case 0xE000:
+
+	SDL_RenderCopy(renderer, screen_tex, nullptr, nullptr);
+
+	if (overlay)
+		draw_overlay();
+}
+
+void Chip8::draw_overlay()
+{
+	// ostatnie klatki od prawej: emulacja (zielony), rysowanie (niebieski)
+	// i wyswietlenie (czerwony) jeden na drugim, odstep od poprzedniej klatki
+	// jako zolta kreska; dolna polowa okna to 2/60 s, szara linia to 1/60 s
+	const int graph_h = height * pixel_size / 2;
+	const int bottom = height * pixel_size;
+	const int bar_w = width * pixel_size / FrameStats::history > 1 ? width * pixel_size / FrameStats::history : 1;
+	const double px_per_us = graph_h / 33333.0;
+	const unsigned int count = stats->frame_count() < FrameStats::history ? stats->frame_count() : FrameStats::history;
+
+	static const BYTE colors[FrameStats::PRESENT + 1][3] = { { 0, 200, 0 }, { 60, 120, 255 }, { 230, 40, 40 } };
+
+	SDL_Rect r;
+	r.w = bar_w;
+
+	for (unsigned int i = 0; i < count; i++)
 	{
-		switch (opcode & 0x00FF)
+		const FrameStats::Sample& s = stats->sample(i);
+		int y = bottom;
+
+		r.x = (width * pixel_size) - (i + 1) * bar_w;
+
+		for (int m = FrameStats::EMULATE; m <= FrameStats::PRESENT; m++)
 		{
-		case 0x009E: opcode_Ex9E(opcode); break;
-		case 0x00A1: opcode_ExA1(opcode); break;
-		default:
-			cout << "Warning: unexpected opcode 0x" << hex << uppercase << opcode << dec << endl;
-			break;
+			r.h = static_cast<int>(s.us[m] * px_per_us + 0.5);
+
+			if (r.h > y - (bottom - graph_h))
+				r.h = y - (bottom - graph_h);
+
+			if (r.h <= 0)
+				continue;
+
+			y -= r.h;
+			r.y = y;
+
+			SDL_SetRenderDrawColor(renderer, colors[m][0], colors[m][1], colors[m][2], 255);
+			SDL_RenderFillRect(renderer, &r);
 		}
-	}
-		break;
-	case 0xF000:
-	{
-		switch (opcode & 0x00FF)
+
+		if (s.us[FrameStats::INTERVAL])
 		{
-		case 0x0007: opcode_Fx07(opcode); break;
-		case 0x000A: opcode_Fx0A(opcode); break;
-		case 0x0015: opcode_Fx15(opcode); break;
-		case 0x0018: opcode_Fx18(opcode); break;
-		case 0x001E: opcode_Fx1E(opcode); break;
-		case 0x0029: opcode_Fx29(opcode); break;
-		case 0x0033: opcode_Fx33(opcode); break;
-		case 0x0055: opcode_Fx55(opcode); break;
-		case 0x0065: opcode_Fx65(opcode); break;
-		default:
-			cout << "Warning: unexpected opcode 0x" << hex << uppercase << opcode << dec << endl;
-			break;
+			const int h = static_cast<int>(s.us[FrameStats::INTERVAL] * px_per_us + 0.5);
+
+			r.h = 2;
+			r.y = bottom - (h < graph_h ? h : graph_h);
+
+			SDL_SetRenderDrawColor(renderer, 255, 220, 0, 255);
+			SDL_RenderFillRect(renderer, &r);
 		}
 	}
-		break;
-	default:
-		cout << "Warning: unknown opcode 0x" << hex << uppercase << opcode << dec << endl;
-		break; // nieobslugiwany opcode
-	}
+
+	r.x = 0;
+	r.y = bottom - graph_h / 2;
+	r.w = width * pixel_size;
+	r.h = 1;
+
+	SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
+	SDL_RenderFillRect(renderer, &r);
 }
 
-BYTE Chip8::wait_key()
+void Chip8::present()
 {
-	while (alive)
+	if (!stats)
 	{
-		read_keys();
+		SDL_RenderPresent(renderer);
+		return;
+	}
 
-		for (BYTE i = 0; i < keys_number; i++)
-		{
-			if (key[i])
-				return i;
-		}
+	const FrameStats::clock::time_point t0 = FrameStats::clock::now();
 
-		sdl_events();
-		SDL_Delay(50);
-	}
+	SDL_RenderPresent(renderer);
 
-	return 0x0;
+	const FrameStats::clock::time_point t1 = FrameStats::clock::now();
+
+	stats->add(FrameStats::PRESENT, t1 - t0);
+	stats->presented(t1, core.take_observed_keys());
 }
 
-void Chip8::decrement_timers()
+WORD Chip8::keypad_mask(const Uint8* kb)
 {
-	if (delay_timer > 0)
-		delay_timer--;
-
-	if (sound_timer > 0)
-		sound_timer--;
+	WORD mask = 0;
+
+	if (kb[SDL_SCANCODE_KP_0]) mask |= 1 << 0;
+	if (kb[SDL_SCANCODE_KP_1]) mask |= 1 << 1;
+	if (kb[SDL_SCANCODE_KP_2]) mask |= 1 << 2;
+	if (kb[SDL_SCANCODE_KP_3]) mask |= 1 << 3;
+	if (kb[SDL_SCANCODE_KP_4]) mask |= 1 << 4;
+	if (kb[SDL_SCANCODE_KP_5]) mask |= 1 << 5;
+	if (kb[SDL_SCANCODE_KP_6]) mask |= 1 << 6;
+	if (kb[SDL_SCANCODE_KP_7]) mask |= 1 << 7;
+	if (kb[SDL_SCANCODE_KP_8]) mask |= 1 << 8;
+	if (kb[SDL_SCANCODE_KP_9]) mask |= 1 << 9;
+	if (kb[SDL_SCANCODE_A]) mask |= 1 << 0xA;
+	if (kb[SDL_SCANCODE_B]) mask |= 1 << 0xB;
+	if (kb[SDL_SCANCODE_C]) mask |= 1 << 0xC;
+	if (kb[SDL_SCANCODE_D]) mask |= 1 << 0xD;
+	if (kb[SDL_SCANCODE_E]) mask |= 1 << 0xE;
+	if (kb[SDL_SCANCODE_F]) mask |= 1 << 0xF;
+
+	return mask;
 }
 
 void Chip8::read_keys()
 {
 	const Uint8* kb = SDL_GetKeyboardState(nullptr);
+	const WORD mask = keypad_mask(kb);
+
+	keys = mask;
+	core.set_keys(mask);
 
-	key[0] = kb[SDL_SCANCODE_KP_0] ? 1 : 0;
-	key[1] = kb[SDL_SCANCODE_KP_1] ? 1 : 0;
-	key[2] = kb[SDL_SCANCODE_KP_2] ? 1 : 0;
-	key[3] = kb[SDL_SCANCODE_KP_3] ? 1 : 0;
-	key[4] = kb[SDL_SCANCODE_KP_4] ? 1 : 0;
-	key[5] = kb[SDL_SCANCODE_KP_5] ? 1 : 0;
-	key[6] = kb[SDL_SCANCODE_KP_6] ? 1 : 0;
-	key[7] = kb[SDL_SCANCODE_KP_7] ? 1 : 0;
-	key[8] = kb[SDL_SCANCODE_KP_8] ? 1 : 0;
-	key[9] = kb[SDL_SCANCODE_KP_9] ? 1 : 0;
-	key[0xA] = kb[SDL_SCANCODE_A] ? 1 : 0;
-	key[0xB] = kb[SDL_SCANCODE_B] ? 1 : 0;
-	key[0xC] = kb[SDL_SCANCODE_C] ? 1 : 0;
-	key[0xD] = kb[SDL_SCANCODE_D] ? 1 : 0;
-	key[0xE] = kb[SDL_SCANCODE_E] ? 1 : 0;
-	key[0xF] = kb[SDL_SCANCODE_F] ? 1 : 0;
 	alive = kb[SDL_SCANCODE_ESCAPE] ? false : true;
 }
 
@@ -532,4 +499,8 @@ void Chip8::sdl_events()
 			break;
 		}
 	}
+
+	// czas wcisniecia klawisza z dokladnoscia do obiegu petli (ok. 1 ms)
+	if (stats)
+		stats->keys(keypad_mask(SDL_GetKeyboardState(nullptr)), FrameStats::clock::now());
 }
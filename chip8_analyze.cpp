@@ -0,0 +1,130 @@
+#include "chip8core.h"
+#include "romanalysis.h"
+#include "romfile.h"
+#include "analysis.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// analiza gry bez uruchamiania: listing, graf przeplywu sterowania (Graphviz)
+// i mapa blokow; opcjonalnie wpis w pamieci podrecznej analizy, z ktorym
+// emulator zaczyna od rozpoznanego juz kodu
+
+static void usage()
+{
+	cerr << "Usage: chip8_analyze ROM [options]\n"
+		"  --listing FILE  write the disassembly listing (default: stdout)\n"
+		"  --dot FILE      write the control-flow graph for Graphviz\n"
+		"  --map FILE      write the machine-readable block map\n"
+		"  --cache DIR     predecode the code into the analysis cache in DIR\n"
+		"FILE may be - for stdout.\n";
+}
+
+static bool write_text(const string& path, const string& text)
+{
+	if (path == "-")
+	{
+		fwrite(text.data(), 1, text.size(), stdout);
+		return true;
+	}
+
+	FILE* f = fopen(path.c_str(), "w");
+
+	if (!f)
+		return false;
+
+	const bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+
+	return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char *argv[])
+{
+	string rom_path, listing_path, dot_path, map_path, cache_dir;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--listing" && i + 1 < argc)
+			listing_path = argv[++i];
+		else if (arg == "--dot" && i + 1 < argc)
+			dot_path = argv[++i];
+		else if (arg == "--map" && i + 1 < argc)
+			map_path = argv[++i];
+		else if (arg == "--cache" && i + 1 < argc)
+			cache_dir = argv[++i];
+		else if (arg[0] != '-' && rom_path.empty())
+			rom_path = arg;
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+
+	if (rom_path.empty())
+	{
+		usage();
+		return -1;
+	}
+
+	if (listing_path.empty() && dot_path.empty() && map_path.empty() && cache_dir.empty())
+		listing_path = "-";
+
+	vector<BYTE> rom;
+
+	if (!read_rom_file(rom_path, rom))
+	{
+		cerr << "Can't read " << rom_path << endl;
+		return -1;
+	}
+
+	Chip8Core core;
+
+	if (!core.load_rom(rom.empty() ? nullptr : &rom[0], rom.size()))
+	{
+		cerr << "Game file too big\n";
+		return -1;
+	}
+
+	RomAnalysis analysis;
+	analysis.analyze(core.image(), rom.size());
+
+	const struct { const string& path; string (RomAnalysis::*fn)() const; } outputs[] =
+	{
+		{ listing_path, &RomAnalysis::listing },
+		{ dot_path, &RomAnalysis::dot },
+		{ map_path, &RomAnalysis::block_map }
+	};
+
+	for (size_t i = 0; i < sizeof(outputs) / sizeof(outputs[0]); i++)
+	{
+		if (!outputs[i].path.empty() && !write_text(outputs[i].path, (analysis.*outputs[i].fn)()))
+		{
+			cerr << "Can't write " << outputs[i].path << endl;
+			return -1;
+		}
+	}
+
+	if (!cache_dir.empty())
+	{
+		// dopisujemy do tego, co emulator juz odkryl przy wczesniejszych uruchomieniach
+		AnalysisCache cache(cache_dir);
+		cache.load(core);
+		analysis.predecode(core);
+
+		if (!cache.store(core))
+		{
+			cerr << "Can't write analysis cache entry " << cache.entry_path(core) << endl;
+			return -1;
+		}
+
+		cerr << "Predecoded " << analysis.code_bytes() / 2 << " instructions into " << cache.entry_path(core) << endl;
+	}
+
+	return 0;
+}
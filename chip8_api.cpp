@@ -0,0 +1,298 @@
+#include "chip8_api.h"
+#include "chip8core.h"
+#include "chip8_batch.h"
+#include "chip8_log.h"
+#include <cstring> // memcpy
+
+// naglowek zapisanego stanu - pozwala odrzucic stan z innej wersji biblioteki
+struct StateHeader
+{
+	unsigned int	magic;
+	unsigned int	version;
+	unsigned int	size;
+	unsigned int	reserved;
+};
+
+static const unsigned int state_magic = 0x38504843; // "CHP8"
+
+static_assert(CHIP8_PACKED_FRAME_SIZE == Chip8Batch::packed_frame_size, "packed frame size mismatch");
+static_assert(CHIP8_LOG_DEBUG == LOG_DEBUG && CHIP8_LOG_OFF == LOG_OFF, "log level mismatch");
+
+struct chip8_instance
+{
+	Chip8Core		core;
+};
+
+struct chip8_batch
+{
+	Chip8Batch		batch;
+	chip8_reward_fn	reward		= nullptr;
+	void*			user		= nullptr;
+
+	chip8_batch(unsigned int count, unsigned int threads)
+		: batch(count, threads)
+	{
+	}
+};
+
+unsigned int chip8_api_version(void)
+{
+	return CHIP8_API_VERSION;
+}
+
+void chip8_set_log_level(int level)
+{
+	try
+	{
+		log_set_level(level < CHIP8_LOG_DEBUG ? CHIP8_LOG_DEBUG : level > CHIP8_LOG_OFF ? CHIP8_LOG_OFF : level);
+	}
+	catch (...)
+	{
+	}
+}
+
+void chip8_shutdown(void)
+{
+	try
+	{
+		log_stop();
+	}
+	catch (...)
+	{
+	}
+}
+
+chip8_t* chip8_create(void)
+{
+	// konstruktor rdzenia tez alokuje (obraz pamieci), a watek dziennika
+	// startujemy przed emulacja - zaden wyjatek nie moze przejsc przez interfejs C
+	try
+	{
+		log_start();
+		return new chip8_instance;
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void chip8_destroy(chip8_t* c8)
+{
+	delete c8;
+}
+
+int chip8_load_rom(chip8_t* c8, const unsigned char* data, size_t len)
+{
+	return c8->core.load_rom(data, len) ? 0 : -1;
+}
+
+void chip8_reset(chip8_t* c8)
+{
+	c8->core.reset();
+}
+
+void chip8_set_seed(chip8_t* c8, unsigned int seed)
+{
+	c8->core.set_seed(seed);
+}
+
+void chip8_set_cycles_per_frame(chip8_t* c8, unsigned int cycles)
+{
+	c8->core.set_cycles_per_frame(cycles);
+}
+
+void chip8_set_timing(chip8_t* c8, int model)
+{
+	c8->core.set_timing(model == CHIP8_TIMING_VIP ? Chip8Core::TIMING_VIP : Chip8Core::TIMING_FIXED);
+}
+
+void chip8_run_cycles(chip8_t* c8, unsigned int n)
+{
+	c8->core.run_cycles(n);
+}
+
+void chip8_run_frames(chip8_t* c8, unsigned int n)
+{
+	while (n--)
+		c8->core.run_frame();
+}
+
+void chip8_set_keys(chip8_t* c8, unsigned short mask)
+{
+	c8->core.set_keys(mask);
+}
+
+unsigned short chip8_get_keys(const chip8_t* c8)
+{
+	return c8->core.get_keys();
+}
+
+size_t chip8_state_size(void)
+{
+	return sizeof(StateHeader) + sizeof(Chip8State);
+}
+
+int chip8_save_state(const chip8_t* c8, void* buf, size_t len)
+{
+	if (len < chip8_state_size())
+		return -1;
+
+	StateHeader hdr;
+	hdr.magic = state_magic;
+	hdr.version = CHIP8_API_VERSION;
+	hdr.size = sizeof(Chip8State);
+	hdr.reserved = 0;
+
+	// zapis zawiera cala pamiec, takze strony czytane ze wspolnego obrazu gry
+	Chip8State s;
+	c8->core.full_state(s);
+
+	BYTE* out = static_cast<BYTE*>(buf);
+	memcpy(out, &hdr, sizeof(hdr));
+	memcpy(out + sizeof(hdr), &s, sizeof(Chip8State));
+
+	return 0;
+}
+
+int chip8_load_state(chip8_t* c8, const void* buf, size_t len)
+{
+	if (len < chip8_state_size())
+		return -1;
+
+	const BYTE* in = static_cast<const BYTE*>(buf);
+
+	StateHeader hdr;
+	memcpy(&hdr, in, sizeof(hdr));
+
+	if (hdr.magic != state_magic || hdr.version != CHIP8_API_VERSION || hdr.size != sizeof(Chip8State))
+		return -1;
+
+	Chip8State s;
+	memcpy(&s, in + sizeof(hdr), sizeof(Chip8State));
+	c8->core.load_state(s);
+
+	return 0;
+}
+
+const unsigned char* chip8_framebuffer(const chip8_t* c8, int* width, int* height, int* pitch)
+{
+	if (width)
+		*width = Chip8Core::width;
+
+	if (height)
+		*height = Chip8Core::height;
+
+	if (pitch)
+		*pitch = Chip8Core::pitch();
+
+	return c8->core.framebuffer();
+}
+
+// przejscie z nagrody C++ (Chip8State) na widok dla C
+static float batch_reward(unsigned int env, const Chip8State& s, bool& done, void* user)
+{
+	chip8_batch* b = static_cast<chip8_batch*>(user);
+
+	// widok pokazuje cala pamiec, wiec niezmienione strony uzupelniamy z obrazu
+	// gry; zwykle nic nie trzeba kopiowac, bo strony wracaja do obrazu tylko
+	// przy resecie i odtworzeniu stanu
+	b->batch.env(env).sync_memory();
+
+	chip8_view view;
+	view.memory = s.game_memory;
+	view.registers = s.registers;
+	view.screen = &s.screen[0][0];
+	view.i = s.address_I;
+	view.pc = s.program_counter;
+	view.delay_timer = s.delay_timer;
+	view.sound_timer = s.sound_timer;
+
+	int finished = 0;
+	const float reward = b->reward(env, &view, &finished, b->user);
+	done = finished != 0;
+
+	return reward;
+}
+
+chip8_batch_t* chip8_batch_create(unsigned int count, unsigned int threads)
+{
+	try
+	{
+		log_start();
+		return new chip8_batch(count, threads);
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void chip8_batch_destroy(chip8_batch_t* b)
+{
+	delete b;
+}
+
+unsigned int chip8_batch_size(const chip8_batch_t* b)
+{
+	return b->batch.size();
+}
+
+int chip8_batch_load_rom(chip8_batch_t* b, const unsigned char* data, size_t len)
+{
+	return b->batch.load_rom(data, len) ? 0 : -1;
+}
+
+void chip8_batch_set_seed(chip8_batch_t* b, unsigned int seed)
+{
+	b->batch.set_seed(seed);
+}
+
+void chip8_batch_set_cycles_per_frame(chip8_batch_t* b, unsigned int cycles)
+{
+	b->batch.set_cycles_per_frame(cycles);
+}
+
+void chip8_batch_set_timing(chip8_batch_t* b, int model)
+{
+	b->batch.set_timing(model == CHIP8_TIMING_VIP ? Chip8Core::TIMING_VIP : Chip8Core::TIMING_FIXED);
+}
+
+void chip8_batch_set_reward(chip8_batch_t* b, chip8_reward_fn fn, void* user)
+{
+	b->reward = fn;
+	b->user = user;
+	b->batch.set_reward(fn ? batch_reward : nullptr, b);
+}
+
+void chip8_batch_reset(chip8_batch_t* b, int env)
+{
+	if (env < 0)
+		b->batch.reset_all();
+	else if (static_cast<unsigned int>(env) < b->batch.size())
+		b->batch.reset(env);
+}
+
+void chip8_batch_step(chip8_batch_t* b, const unsigned short* actions, unsigned int repeat,
+	unsigned char* frames, float* rewards, unsigned char* dones)
+{
+	b->batch.step(actions, repeat, frames, rewards, dones);
+}
+
+size_t chip8_batch_clone_size(void)
+{
+	return sizeof(Chip8State);
+}
+
+void chip8_batch_clone(const chip8_batch_t* b, unsigned int env, void* buf)
+{
+	memcpy(buf, &b->batch.env(env).state(), sizeof(Chip8State));
+}
+
+void chip8_batch_restore(chip8_batch_t* b, unsigned int env, const void* buf)
+{
+	// bufor od wolajacego moze nie byc wyrownany jak Chip8State
+	Chip8State s;
+	memcpy(&s, buf, sizeof(s));
+	b->batch.restore(env, s);
+}
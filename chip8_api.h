@@ -0,0 +1,164 @@
+#ifndef CHIP8_API_H
+#define CHIP8_API_H
+
+/*
+ * Stabilne C API emulatora CHIP-8 (biblioteka chip8, bez SDLa).
+ *
+ * Kazda instancja ma wlasny stan, wiec funkcje sa wielobieznne pomiedzy
+ * instancjami. Jednej instancji nie wolno uzywac z kilku watkow naraz.
+ * Po chip8_create() biblioteka nie alokuje juz pamieci.
+ *
+ * Ostrzezenia emulacji (np. nieznany opcode) wypisuje na stderr watek
+ * biblioteki uruchamiany przez chip8_create() / chip8_batch_create();
+ * chip8_set_log_level() zmienia prog albo wylacza wypisywanie (i konczy
+ * watek). Przed dlclose()/FreeLibrary() trzeba wywolac chip8_shutdown().
+ */
+
+#include <stddef.h>
+
+#ifdef _WIN32
+	#ifdef CHIP8_API_EXPORTS
+		#define CHIP8_API __declspec(dllexport)
+	#else
+		#define CHIP8_API __declspec(dllimport)
+	#endif
+#else
+	#define CHIP8_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHIP8_API_VERSION 1
+
+typedef struct chip8_instance chip8_t;
+
+/* wersja ABI, z ktora zbudowano biblioteke (CHIP8_API_VERSION) */
+CHIP8_API unsigned int chip8_api_version(void);
+
+/* poziomy komunikatow wypisywanych na stderr */
+#define CHIP8_LOG_DEBUG		0
+#define CHIP8_LOG_INFO		1
+#define CHIP8_LOG_WARNING	2
+#define CHIP8_LOG_ERROR		3
+#define CHIP8_LOG_OFF		4
+
+/*
+ * Wspolny dla wszystkich instancji w procesie (domyslnie CHIP8_LOG_WARNING).
+ * CHIP8_LOG_OFF konczy watek wypisujacy; ustawione przed chip8_create()
+ * sprawia, ze biblioteka w ogole go nie uruchamia i nic nie pisze na stderr.
+ */
+CHIP8_API void chip8_set_log_level(int level);
+
+/*
+ * Wypisuje zalegle komunikaty i konczy watek biblioteki. Wolac, gdy zadna
+ * instancja nie pracuje, a na pewno przed wyladowaniem biblioteki; kolejne
+ * chip8_create() uruchamia watek od nowa.
+ */
+CHIP8_API void chip8_shutdown(void);
+
+/* tworzy instancje z pusta pamiecia; zwraca NULL przy braku pamieci */
+CHIP8_API chip8_t* chip8_create(void);
+CHIP8_API void chip8_destroy(chip8_t* c8);
+
+/* wczytuje gre z bufora i resetuje maszyne; 0 = ok, -1 = gra za duza */
+CHIP8_API int chip8_load_rom(chip8_t* c8, const unsigned char* data, size_t len);
+CHIP8_API void chip8_reset(chip8_t* c8);
+CHIP8_API void chip8_set_seed(chip8_t* c8, unsigned int seed);
+
+/* ile instrukcji wykonuje jedna klatka (domyslnie 8) */
+CHIP8_API void chip8_set_cycles_per_frame(chip8_t* c8, unsigned int cycles);
+
+/* model czasu: stala liczba instrukcji na klatke albo koszty cykli COSMAC VIP */
+#define CHIP8_TIMING_FIXED	0
+#define CHIP8_TIMING_VIP	1
+CHIP8_API void chip8_set_timing(chip8_t* c8, int model);
+
+/* wykonuje n instrukcji (bez timerow) albo n klatek 60 Hz (instrukcje + timery) */
+CHIP8_API void chip8_run_cycles(chip8_t* c8, unsigned int n);
+CHIP8_API void chip8_run_frames(chip8_t* c8, unsigned int n);
+
+/* bit i maski = klawisz i (0x0 - 0xF) wcisniety */
+CHIP8_API void chip8_set_keys(chip8_t* c8, unsigned short mask);
+CHIP8_API unsigned short chip8_get_keys(const chip8_t* c8);
+
+/* rozmiar bufora potrzebnego do zapisu stanu */
+CHIP8_API size_t chip8_state_size(void);
+/* 0 = ok, -1 = za maly bufor / niepoprawny stan */
+CHIP8_API int chip8_save_state(const chip8_t* c8, void* buf, size_t len);
+CHIP8_API int chip8_load_state(chip8_t* c8, const void* buf, size_t len);
+
+/*
+ * Wskaznik tylko do odczytu na bufor ekranu instancji (bez kopiowania).
+ * Piksel (x, y) to fb[y * pitch + x], wartosc 0 albo 1. Wskaznik jest
+ * wazny az do chip8_destroy(); dowolny z parametrow wyjsciowych moze byc NULL.
+ */
+CHIP8_API const unsigned char* chip8_framebuffer(const chip8_t* c8, int* width, int* height, int* pitch);
+
+/*
+ * Paczka srodowisk z ta sama gra do uczenia ze wzmocnieniem. chip8_batch_step()
+ * wykonuje klatki wszystkich srodowisk rownolegle na puli watkow i zapisuje
+ * wyniki do tablic przygotowanych przez wolajacego (bez alokacji).
+ */
+typedef struct chip8_batch chip8_batch_t;
+
+/* widok stanu srodowiska przekazywany do funkcji nagrody */
+typedef struct chip8_view
+{
+	const unsigned char*	memory;		/* 4096 bajtow */
+	const unsigned char*	registers;	/* V0 - VF */
+	const unsigned char*	screen;		/* 64x32, 1 bajt na piksel */
+	unsigned short			i;
+	unsigned short			pc;
+	unsigned char			delay_timer;
+	unsigned char			sound_timer;
+} chip8_view;
+
+/*
+ * Nagroda za jedna klatke srodowiska env; *done = 1 konczy epizod (srodowisko
+ * stoi az do chip8_batch_reset). Wolana rownolegle z watkow puli.
+ */
+typedef float (*chip8_reward_fn)(unsigned int env, const chip8_view* view, int* done, void* user);
+
+/* obraz spakowany bit na piksel (wiersz po wierszu, najstarszy bit = lewy piksel) */
+#define CHIP8_PACKED_FRAME_SIZE 256
+
+/* threads = 0 - tyle watkow, ile rdzeni; NULL przy braku pamieci */
+CHIP8_API chip8_batch_t* chip8_batch_create(unsigned int count, unsigned int threads);
+CHIP8_API void chip8_batch_destroy(chip8_batch_t* b);
+CHIP8_API unsigned int chip8_batch_size(const chip8_batch_t* b);
+
+/* wczytuje gre do wszystkich srodowisk; 0 = ok, -1 = gra za duza */
+CHIP8_API int chip8_batch_load_rom(chip8_batch_t* b, const unsigned char* data, size_t len);
+/* srodowisko i dostaje ziarno seed + i */
+CHIP8_API void chip8_batch_set_seed(chip8_batch_t* b, unsigned int seed);
+CHIP8_API void chip8_batch_set_cycles_per_frame(chip8_batch_t* b, unsigned int cycles);
+CHIP8_API void chip8_batch_set_timing(chip8_batch_t* b, int model);
+CHIP8_API void chip8_batch_set_reward(chip8_batch_t* b, chip8_reward_fn fn, void* user);
+
+/* env < 0 resetuje wszystkie srodowiska */
+CHIP8_API void chip8_batch_reset(chip8_batch_t* b, int env);
+
+/*
+ * Kazde srodowisko i dostaje akcje actions[i] (maska klawiszy) na repeat klatek.
+ * frames: size * CHIP8_PACKED_FRAME_SIZE bajtow, rewards i dones: size elementow.
+ * Kazdy wskaznik moze byc NULL (actions = NULL - nic nie wcisniete).
+ */
+CHIP8_API void chip8_batch_step(chip8_batch_t* b, const unsigned short* actions, unsigned int repeat,
+	unsigned char* frames, float* rewards, unsigned char* dones);
+
+/*
+ * Klonowanie stanu jednego srodowiska to kopia plaskiej struktury. Klon mozna
+ * odtworzyc w dowolnym srodowisku tej samej paczki (nie jest przenosny miedzy
+ * wersjami biblioteki - do tego sluzy chip8_save_state).
+ */
+CHIP8_API size_t chip8_batch_clone_size(void);
+CHIP8_API void chip8_batch_clone(const chip8_batch_t* b, unsigned int env, void* buf);
+CHIP8_API void chip8_batch_restore(chip8_batch_t* b, unsigned int env, const void* buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,239 @@
+#include "chip8_batch.h"
+#include <algorithm> // min, max
+#include <cstdint>
+#include <cstring> // memcpy
+
+using namespace std;
+
+Chip8Batch::Chip8Batch(unsigned int count, unsigned int threads)
+	: states(count), envs(count), finished(count, 0), next_chunk(0)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		envs[i] = new Chip8Core;
+		envs[i]->attach_state(&states[i]);
+	}
+
+	if (threads == 0)
+		threads = max(1u, thread::hardware_concurrency());
+
+	// nie ma sensu trzymac wiecej watkow niz paczek srodowisk
+	const unsigned int chunks = (count + chunk - 1) / chunk;
+	threads = min(threads, max(1u, chunks));
+
+	// watek wolajacy step() tez pracuje, wiec pula jest o jeden mniejsza
+	for (unsigned int i = 1; i < threads; i++)
+		workers.push_back(thread(&Chip8Batch::worker_loop, this));
+}
+
+Chip8Batch::~Chip8Batch()
+{
+	{
+		lock_guard<mutex> guard(lock);
+		quit = true;
+	}
+
+	wake.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	for (size_t i = 0; i < envs.size(); i++)
+		delete envs[i];
+}
+
+bool Chip8Batch::load_rom(const BYTE* data, size_t len)
+{
+	if (envs.empty())
+		return true;
+
+	// obraz gry ma tylko pierwsze srodowisko; pozostale czytaja z niego
+	// i maja wlasne tylko strony zapisane przez program
+	if (!envs[0]->load_rom(data, len))
+		return false;
+
+	for (size_t i = 0; i < envs.size(); i++)
+	{
+		envs[i]->share_image(*envs[0]);
+		finished[i] = 0;
+	}
+
+	return true;
+}
+
+void Chip8Batch::set_seed(unsigned int seed)
+{
+	for (size_t i = 0; i < envs.size(); i++)
+		envs[i]->set_seed(seed + static_cast<unsigned int>(i));
+}
+
+void Chip8Batch::set_cycles_per_frame(unsigned int n)
+{
+	for (size_t i = 0; i < envs.size(); i++)
+		envs[i]->set_cycles_per_frame(n);
+}
+
+void Chip8Batch::set_timing(int model)
+{
+	for (size_t i = 0; i < envs.size(); i++)
+		envs[i]->set_timing(model);
+}
+
+void Chip8Batch::set_reward(RewardFn fn, void* user)
+{
+	reward_fn = fn;
+	reward_user = user;
+}
+
+void Chip8Batch::reset(unsigned int env)
+{
+	envs[env]->reset();
+	finished[env] = 0;
+}
+
+void Chip8Batch::reset_all()
+{
+	for (unsigned int i = 0; i < size(); i++)
+		reset(i);
+}
+
+void Chip8Batch::restore(unsigned int env, const Chip8State& s)
+{
+	envs[env]->restore_state(s);
+	finished[env] = 0;
+}
+
+void Chip8Batch::pack_frame(const BYTE* fb, BYTE* out)
+{
+	// 8 pikseli (bajty 0/1) -> 1 bajt: mnozenie przesuwa kazdy bajt na swoj bit
+	// najstarszego bajtu iloczynu. Wymaga odczytu little endian
+	static const uint16_t probe = 1;
+	const bool little_endian = *reinterpret_cast<const BYTE*>(&probe) == 1;
+
+	for (int i = 0; i < packed_frame_size; i++)
+	{
+		const BYTE* px = fb + 8 * i;
+
+		if (little_endian)
+		{
+			uint64_t v;
+			memcpy(&v, px, sizeof(v));
+			out[i] = static_cast<BYTE>(((v & 0x0101010101010101ULL) * 0x8040201008040201ULL) >> 56);
+		}
+		else
+		{
+			BYTE b = 0;
+
+			for (int bit = 0; bit < 8; bit++)
+				b = static_cast<BYTE>(b << 1 | (px[bit] & 1));
+
+			out[i] = b;
+		}
+	}
+}
+
+void Chip8Batch::step_env(unsigned int i)
+{
+	Chip8Core& core = *envs[i];
+	float reward = 0;
+
+	if (!finished[i])
+	{
+		core.set_keys(step_actions ? step_actions[i] : 0);
+
+		for (unsigned int r = 0; r < step_repeat; r++)
+		{
+			core.run_frame();
+
+			if (reward_fn)
+			{
+				bool done = false;
+				reward += reward_fn(i, states[i], done, reward_user);
+
+				if (done)
+				{
+					finished[i] = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	if (step_frames)
+		pack_frame(core.framebuffer(), step_frames + static_cast<size_t>(i) * packed_frame_size);
+
+	if (step_rewards)
+		step_rewards[i] = reward;
+
+	if (step_dones)
+		step_dones[i] = finished[i];
+}
+
+void Chip8Batch::run_chunks()
+{
+	const unsigned int count = size();
+
+	for (unsigned int c = next_chunk++; c * chunk < count; c = next_chunk++)
+	{
+		const unsigned int end = min(count, (c + 1) * chunk);
+
+		for (unsigned int i = c * chunk; i < end; i++)
+			step_env(i);
+	}
+}
+
+void Chip8Batch::worker_loop()
+{
+	unsigned long long seen = 0;
+
+	for (;;)
+	{
+		{
+			unique_lock<mutex> guard(lock);
+			wake.wait(guard, [&]() { return quit || generation != seen; });
+
+			if (quit)
+				return;
+
+			seen = generation;
+		}
+
+		run_chunks();
+
+		{
+			lock_guard<mutex> guard(lock);
+
+			if (--busy == 0)
+				idle.notify_one();
+		}
+	}
+}
+
+void Chip8Batch::step(const WORD* actions, unsigned int repeat, BYTE* frames, float* rewards, BYTE* dones)
+{
+	step_actions = actions;
+	step_repeat = repeat ? repeat : 1;
+	step_frames = frames;
+	step_rewards = rewards;
+	step_dones = dones;
+	next_chunk = 0;
+
+	if (!workers.empty())
+	{
+		{
+			lock_guard<mutex> guard(lock);
+			busy = static_cast<unsigned int>(workers.size());
+			generation++;
+		}
+
+		wake.notify_all();
+	}
+
+	run_chunks();
+
+	if (!workers.empty())
+	{
+		unique_lock<mutex> guard(lock);
+		idle.wait(guard, [&]() { return busy == 0; });
+	}
+}
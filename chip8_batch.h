@@ -0,0 +1,93 @@
+#ifndef CHIP8_BATCH_H
+#define CHIP8_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "chip8core.h"
+
+// wiele srodowisk z ta sama gra krokowanych jednoczesnie (np. do uczenia ze
+// wzmocnieniem). Stany wszystkich srodowisk leza w jednej ciaglej tablicy,
+// wiec klonowanie i odtwarzanie stanu to kopiowanie plaskiej struktury.
+// Krok jest rozdzielany miedzy stala pule watkow; wyniki trafiaja do tablic
+// przygotowanych przez wolajacego, wiec krok niczego nie alokuje
+class Chip8Batch
+{
+public:
+	// obraz spakowany bit na piksel, wiersz po wierszu, najstarszy bit = lewy piksel
+	static const int	packed_frame_size = Chip8Core::width * Chip8Core::height / 8;
+
+	// nagroda za jedna klatke srodowiska env; ustawienie done konczy epizod.
+	// Wolana z watkow puli, rownolegle dla roznych srodowisk
+	typedef float (*RewardFn)(unsigned int env, const Chip8State& s, bool& done, void* user);
+
+private:
+	static const unsigned int	chunk			= 16; // srodowisk na jedno zadanie
+
+	std::vector<Chip8State>		states;
+	std::vector<Chip8Core*>		envs;
+	std::vector<BYTE>			finished;
+	RewardFn					reward_fn		= nullptr;
+	void*						reward_user		= nullptr;
+
+	// pula watkow
+	std::vector<std::thread>	workers;
+	std::mutex					lock;
+	std::condition_variable		wake;
+	std::condition_variable		idle;
+	unsigned long long			generation		= 0;
+	unsigned int				busy			= 0;
+	bool						quit			= false;
+	std::atomic<unsigned int>	next_chunk;
+
+	// parametry biezacego kroku
+	const WORD*					step_actions	= nullptr;
+	unsigned int				step_repeat		= 1;
+	BYTE*						step_frames		= nullptr;
+	float*						step_rewards	= nullptr;
+	BYTE*						step_dones		= nullptr;
+
+public:
+	// threads = 0 - tyle watkow, ile rdzeni
+	explicit Chip8Batch(unsigned int count, unsigned int threads = 0);
+	~Chip8Batch();
+
+	Chip8Batch(const Chip8Batch&) = delete;
+	Chip8Batch& operator=(const Chip8Batch&) = delete;
+
+	unsigned int size() const { return static_cast<unsigned int>(envs.size()); }
+
+	// wszystkie srodowiska dziela jeden obraz gry (patrz Chip8Core::share_image)
+	bool load_rom(const BYTE* data, size_t len);
+	// kolejne srodowiska dostaja ziarna seed, seed + 1, ...
+	void set_seed(unsigned int seed);
+	void set_cycles_per_frame(unsigned int n);
+	void set_timing(int model);
+	void set_reward(RewardFn fn, void* user);
+
+	void reset(unsigned int env);
+	void reset_all();
+
+	// kazde srodowisko dostaje akcje actions[i] (maska klawiszy) na repeat klatek.
+	// frames: size() * packed_frame_size bajtow, rewards i dones: size() elementow
+	// (kazda z tablic moze byc nullptr). Zakonczone srodowiska stoja az do reset()
+	void step(const WORD* actions, unsigned int repeat, BYTE* frames, float* rewards, BYTE* dones);
+
+	// klon to kopia stanu; odtwarzac mozna do dowolnego srodowiska tej paczki
+	void clone(unsigned int env, Chip8State& out) const { out = states[env]; }
+	void restore(unsigned int env, const Chip8State& s);
+
+	Chip8Core& env(unsigned int i) { return *envs[i]; }
+	const Chip8Core& env(unsigned int i) const { return *envs[i]; }
+
+	static void pack_frame(const BYTE* fb, BYTE* out);
+
+private:
+	void worker_loop();
+	void run_chunks();
+	void step_env(unsigned int i);
+};
+
+#endif
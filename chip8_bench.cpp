@@ -0,0 +1,227 @@
+#include "chip8core.h"
+#include "phosphor.h"
+#include "romfile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // strtoul
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// pomiary wydajnosci rdzenia: szybkosc emulacji oraz koszt resetu
+// i odtwarzania stanu (ile kosztuje jedno wykonanie przy przeszukiwaniu/fuzzingu)
+
+// program uzywany, gdy nie podano gry: rysuje cyfry BCD licznika w petli,
+// wiec zapisuje troche pamieci (Fx33, Fx55) jak typowa gra
+static const BYTE builtin_rom[] =
+{
+	0x00, 0xE0,		// 200: CLS
+	0xA3, 0x00,		// 202: LD I, 0x300
+	0xF0, 0x33,		// 204: LD B, V0
+	0xF2, 0x65,		// 206: LD V2, [I]
+	0xF0, 0x29,		// 208: LD F, V0
+	0xD4, 0x55,		// 20A: DRW V4, V5, 5
+	0xF1, 0x29,		// 20C: LD F, V1
+	0xD6, 0x55,		// 20E: DRW V6, V5, 5
+	0xA3, 0x40,		// 210: LD I, 0x340
+	0xF3, 0x55,		// 212: LD [I], V3
+	0x70, 0x01,		// 214: ADD V0, 1
+	0x64, 0x08,		// 216: LD V4, 8
+	0x66, 0x10,		// 218: LD V6, 16
+	0x12, 0x00		// 21A: JP 0x200
+};
+
+static void usage()
+{
+	cerr << "Usage: chip8_bench [ROM] [options]\n"
+		"  --frames N      frames per benchmark run (default 600)\n"
+		"  --iterations N  repetitions of reset/restore measurements (default 20000)\n";
+}
+
+static double elapsed_ns(steady_clock::time_point t0)
+{
+	return static_cast<double>(duration_cast<nanoseconds>(steady_clock::now() - t0).count());
+}
+
+static void report(const char* name, double ns, unsigned long ops)
+{
+	printf("%-32s %12.1f ns/op  (%lu ops)\n", name, ns / ops, ops);
+}
+
+int main(int argc, char *argv[])
+{
+	string rom_path;
+	unsigned long frames = 600;
+	unsigned long iterations = 20000;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--frames" && i + 1 < argc)
+			frames = strtoul(argv[++i], nullptr, 0);
+		else if (arg == "--iterations" && i + 1 < argc)
+			iterations = strtoul(argv[++i], nullptr, 0);
+		else if (arg[0] != '-')
+			rom_path = arg;
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+
+	if (!frames || !iterations)
+	{
+		usage();
+		return -1;
+	}
+
+	vector<BYTE> rom(builtin_rom, builtin_rom + sizeof(builtin_rom));
+
+	if (!rom_path.empty() && !read_rom_file(rom_path, rom))
+	{
+		cerr << "Can't read " << rom_path << endl;
+		return -1;
+	}
+
+	Chip8Core core;
+
+	if (!core.load_rom(rom.empty() ? nullptr : &rom[0], rom.size()))
+	{
+		cerr << "Game file too big\n";
+		return -1;
+	}
+
+	printf("%s, %u instructions per frame\n", rom_path.empty() ? "built-in ROM" : rom_path.c_str(), core.get_cycles_per_frame());
+
+	// szybkosc emulacji
+	{
+		const auto t0 = steady_clock::now();
+
+		for (unsigned long f = 0; f < frames; f++)
+			core.run_frame();
+
+		const double ns = elapsed_ns(t0);
+		report("run_frame", ns, frames);
+		printf("%-32s %12.1f x realtime\n", "", frames / 60.0 / (ns * 1e-9));
+	}
+
+	// model VIP: staly koszt pracy na klatke, porownywalny miedzy maszynami
+	{
+		core.set_timing(Chip8Core::TIMING_VIP);
+		core.reset();
+
+		const unsigned long long before = core.fusion_stats().instructions;
+		const auto t0 = steady_clock::now();
+
+		for (unsigned long f = 0; f < frames; f++)
+			core.run_frame();
+
+		const double ns = elapsed_ns(t0);
+		report("run_frame (VIP timing)", ns, frames);
+		printf("%-32s %12.1f instructions/frame, %.1f M VIP cycles/s\n", "",
+			static_cast<double>(core.fusion_stats().instructions - before) / frames,
+			frames * static_cast<double>(Chip8Core::vip_frame_cycles) / (ns * 1e-3));
+
+		core.set_timing(Chip8Core::TIMING_FIXED);
+		core.reset();
+	}
+
+	// reset po krotkiej grze: strony zmienione przez program wracaja do obrazu gry bez kopiowania
+	const unsigned long play = frames < 10 ? frames : 10;
+	double reset_ns = 0, full_reset_ns = 0;
+	unsigned int dirty = 0;
+
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (unsigned long f = 0; f < play; f++)
+			core.run_frame();
+
+		unsigned long long mask = core.state().dirty_pages;
+		dirty = 0;
+
+		for (; mask; mask &= mask - 1)
+			dirty++;
+
+		const auto t0 = steady_clock::now();
+		core.reset();
+		reset_ns += elapsed_ns(t0);
+	}
+
+	// dla porownania: reset calej pamieci i calego przeanalizowanego kodu
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (unsigned long f = 0; f < play; f++)
+			core.run_frame();
+
+		const auto t0 = steady_clock::now();
+		core.invalidate_code();
+		core.reset();
+		full_reset_ns += elapsed_ns(t0);
+	}
+
+	printf("%-32s %12u of %d pages\n", "dirty pages per reset", dirty, Chip8State::pages);
+	report("reset (dirty pages)", reset_ns, iterations);
+	report("reset (full memory)", full_reset_ns, iterations);
+
+	// odtworzenie zapisanego stanu w trakcie gry
+	core.reset();
+
+	for (unsigned long f = 0; f < play; f++)
+		core.run_frame();
+
+	const Chip8State snapshot = core.state();
+	double restore_ns = 0, load_ns = 0;
+
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (unsigned long f = 0; f < play; f++)
+			core.run_frame();
+
+		const auto t0 = steady_clock::now();
+		core.restore_state(snapshot);
+		restore_ns += elapsed_ns(t0);
+	}
+
+	// load_state() kopiuje cala pamiec i porownuje ja z obrazem gry
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		for (unsigned long f = 0; f < play; f++)
+			core.run_frame();
+
+		const auto t0 = steady_clock::now();
+		core.load_state(snapshot);
+		load_ns += elapsed_ns(t0);
+	}
+
+	report("restore_state (dirty pages)", restore_ns, iterations);
+	report("load_state (full copy)", load_ns, iterations);
+
+	// poswiata przed wyslaniem obrazu (frontend, niezalezna od pixel_size)
+	{
+		Phosphor phosphor;
+		phosphor.set_decay(60);
+
+		vector<uint32_t> argb(Phosphor::pixels);
+		double phosphor_ns = 0;
+
+		for (unsigned long i = 0; i < iterations; i++)
+		{
+			if (i % play == 0)
+				core.run_frame();
+
+			const auto t0 = steady_clock::now();
+			phosphor.update(core.framebuffer());
+			phosphor.to_argb(&argb[0], Phosphor::width * sizeof(uint32_t));
+			phosphor_ns += elapsed_ns(t0);
+		}
+
+		report("phosphor update + ARGB", phosphor_ns, iterations);
+	}
+
+	return 0;
+}
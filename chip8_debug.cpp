@@ -0,0 +1,151 @@
+#include "chip8core.h"
+#include <cstring> // memset
+
+// wsparcie dla debuggera: pulapki na adresach kodu i obserwowanie zapisow do pamieci
+
+void Chip8Core::set_breakpoint(WORD addr, bool on)
+{
+	addr &= ram_size - 1;
+
+	const unsigned long long bit = 1ULL << (addr & 63);
+	const bool was = (breakpoints[addr >> 6] & bit) != 0;
+
+	if (on && !was)
+	{
+		breakpoints[addr >> 6] |= bit;
+		breakpoint_count++;
+	}
+	else if (!on && was)
+	{
+		breakpoints[addr >> 6] &= ~bit;
+		breakpoint_count--;
+	}
+}
+
+void Chip8Core::set_watchpoint(WORD addr, WORD len, bool on)
+{
+	for (WORD i = 0; i < len; i++)
+	{
+		const WORD a = (addr + i) & (ram_size - 1);
+		const unsigned long long bit = 1ULL << (a & 63);
+		const bool was = (watchpoints[a >> 6] & bit) != 0;
+
+		if (on && !was)
+		{
+			watchpoints[a >> 6] |= bit;
+			watchpoint_count++;
+		}
+		else if (!on && was)
+		{
+			watchpoints[a >> 6] &= ~bit;
+			watchpoint_count--;
+		}
+	}
+}
+
+void Chip8Core::clear_debug()
+{
+	memset(breakpoints, 0, sizeof(breakpoints));
+	memset(watchpoints, 0, sizeof(watchpoints));
+	breakpoint_count = 0;
+	watchpoint_count = 0;
+	stop = STOP_NONE;
+}
+
+unsigned int Chip8Core::run_cycles_debug(unsigned int n)
+{
+	// bez superinstrukcji - pulapka moze stac na kazdej instrukcji
+	unsigned int executed = 0;
+
+	stop = STOP_NONE;
+
+	while (executed < n)
+	{
+		const WORD pc = st->program_counter & (ram_size - 1);
+
+		if (breakpoints[pc >> 6] >> (pc & 63) & 1)
+		{
+			stop = STOP_BREAKPOINT;
+			stop_address = pc;
+			break;
+		}
+
+		decode_opcode(fetch_opcode());
+		executed++;
+
+		// obserwowany adres zostal zapisany
+		if (stop != STOP_NONE)
+			break;
+	}
+
+	stats.instructions += executed;
+
+	return executed;
+}
+
+bool Chip8Core::single_step()
+{
+	stop = STOP_NONE;
+
+	if (timing == TIMING_VIP)
+	{
+		if (!vip_frame_open)
+		{
+			st->vip_cycles += vip_budget;
+			vip_frame_open = true;
+		}
+
+		exec_vip();
+
+		if (st->vip_cycles > 0)
+			return false;
+
+		vip_frame_open = false;
+		frame_cycle = 0;
+		decrement_timers();
+
+		return true;
+	}
+
+	decode_opcode(fetch_opcode());
+	stats.instructions++;
+
+	if (++frame_cycle < cycles_per_frame)
+		return false;
+
+	frame_cycle = 0;
+	decrement_timers();
+
+	return true;
+}
+
+void Chip8Core::poke(WORD addr, BYTE value)
+{
+	addr &= ram_size - 1;
+
+	store_byte(addr, value);
+	code_written(addr);
+}
+
+const char* Chip8Core::fault_name(int kind)
+{
+	switch (kind)
+	{
+	case FAULT_NONE: return "none";
+	case FAULT_MEMORY: return "memory access out of bounds";
+	case FAULT_STACK_UNDERFLOW: return "stack underflow";
+	case FAULT_STACK_OVERFLOW: return "stack overflow";
+	case FAULT_KEY_INDEX: return "key index out of range";
+	default: return "unknown";
+	}
+}
+
+void Chip8Core::raise_fault(int kind, WORD addr)
+{
+	if (fault_kind != FAULT_NONE)
+		return;
+
+	fault_kind = kind;
+	fault_address = addr;
+	fault_pc = st->program_counter;
+}
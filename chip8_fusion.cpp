@@ -0,0 +1,259 @@
+#include "chip8core.h"
+#include <cstring> // memset, memcpy
+
+// Superinstrukcje: najczestsze pary instrukcji sa rozpoznawane przy pierwszym
+// wykonaniu danego adresu i pozniej wykonywane jednym krokiem, bez ponownego
+// dekodowania drugiej instrukcji. Wynik jest identyczny jak przy zwyklym
+// wykonaniu - fuzja nie obejmuje drugiej instrukcji, jesli jest ona celem
+// skoku, a zapis do pamieci (Fx33, Fx55) uniewaznia przeanalizowany kod
+
+const char* Chip8Core::fusion_name(int kind)
+{
+	switch (kind)
+	{
+	case FUSE_ANNN_DXYN: return "Annn+Dxyn";
+	case FUSE_LD_RUN: return "6xkk run";
+	case FUSE_SKIP_JP: return "3xkk/4xkk+1nnn";
+	case FUSE_FX07_SKIP: return "Fx07+3xkk/4xkk";
+	default: return "none";
+	}
+}
+
+void Chip8Core::set_fusion(bool on)
+{
+	fusion_enabled = on;
+	memset(fusion, FUSE_UNKNOWN, ram_size);
+}
+
+void Chip8Core::invalidate_code()
+{
+	memset(fusion, FUSE_UNKNOWN, ram_size);
+	memset(jump_target, 0, ram_size);
+	st->dirty_pages = ~0ULL >> (64 - Chip8State::pages);
+}
+
+void Chip8Core::invalidate_pages(unsigned long long mask)
+{
+	// superinstrukcja zaczynajaca sie przed strona moze na nia zachodzic.
+	// Cele skokow zostaja - psuja tylko fuzje, nigdy poprawnosc
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		if (!(mask >> p & 1))
+			continue;
+
+		const int start = p * Chip8State::page_size;
+		const int first = start >= 2 * fusion_max_len ? start - 2 * fusion_max_len + 1 : 0;
+
+		memset(&fusion[first], FUSE_UNKNOWN, start + Chip8State::page_size - first);
+	}
+}
+
+WORD Chip8Core::read_word(WORD addr) const
+{
+	return (load_byte(addr & (ram_size - 1)) << 8) | load_byte((addr + 1) & (ram_size - 1));
+}
+
+BYTE Chip8Core::analyze_fusion(WORD pc)
+{
+	BYTE kind = FUSE_NONE;
+	BYTE len = 1;
+
+	// druga instrukcja musi lezec w pamieci i nie moze byc celem skoku
+	if (pc + 4 <= ram_size && !jump_target[pc + 2])
+	{
+		const WORD a = read_word(pc);
+		const WORD b = read_word(pc + 2);
+
+		if ((a & 0xF000) == 0xA000 && (b & 0xF000) == 0xD000)
+		{
+			kind = FUSE_ANNN_DXYN;
+			len = 2;
+		}
+		else if ((a & 0xF000) == 0x6000 && (b & 0xF000) == 0x6000)
+		{
+			kind = FUSE_LD_RUN;
+			len = 2;
+
+			while (len < fusion_max_len && pc + 2 * (len + 1) <= ram_size
+				&& !jump_target[pc + 2 * len] && (read_word(pc + 2 * len) & 0xF000) == 0x6000)
+			{
+				len++;
+			}
+		}
+		else if (((a & 0xF000) == 0x3000 || (a & 0xF000) == 0x4000) && (b & 0xF000) == 0x1000)
+		{
+			kind = FUSE_SKIP_JP;
+			len = 2;
+		}
+		else if ((a & 0xF0FF) == 0xF007 && ((b & 0xF000) == 0x3000 || (b & 0xF000) == 0x4000))
+		{
+			kind = FUSE_FX07_SKIP;
+			len = 2;
+		}
+	}
+
+	fusion[pc] = kind;
+	fusion_len[pc] = len;
+
+	return kind;
+}
+
+unsigned int Chip8Core::exec_fused(WORD pc, BYTE kind)
+{
+	const WORD a = read_word(pc);
+	const WORD b = read_word(pc + 2);
+	const WORD next = st->program_counter;
+	unsigned int executed = fusion_len[pc];
+
+	switch (kind)
+	{
+	case FUSE_ANNN_DXYN:
+		st->address_I = a & 0x0FFF;
+		st->program_counter = next + 4;
+		opcode_Dxyn(b);
+		break;
+	case FUSE_LD_RUN:
+		for (unsigned int i = 0; i < executed; i++)
+		{
+			const WORD op = read_word(pc + 2 * i);
+			st->registers[(op & 0x0F00) >> 8] = op & 0x00FF;
+		}
+
+		st->program_counter = next + 2 * executed;
+		break;
+	case FUSE_SKIP_JP:
+	{
+		const bool equal = st->registers[(a & 0x0F00) >> 8] == (a & 0x00FF);
+
+		if (equal == ((a & 0xF000) == 0x3000))
+		{
+			// warunek spelniony - skok jest pomijany, wykonana zostala tylko jedna instrukcja
+			st->program_counter = next + 4;
+			executed = 1;
+		}
+		else
+		{
+			st->program_counter = b & 0x0FFF;
+			mark_jump_target(st->program_counter);
+		}
+	}
+		break;
+	case FUSE_FX07_SKIP:
+		st->registers[(a & 0x0F00) >> 8] = st->delay_timer;
+		st->program_counter = next + 4;
+
+		if ((b & 0xF000) == 0x3000)
+			opcode_3xkk(b);
+		else
+			opcode_4xkk(b);
+		break;
+	default:
+		break;
+	}
+
+	stats.dispatches[kind]++;
+	stats.covered[kind] += executed;
+
+	return executed;
+}
+
+void Chip8Core::code_written(WORD addr)
+{
+	// zapis moze zmienic dowolna superinstrukcje, ktora obejmuje ten adres
+	const int first = addr >= 2 * fusion_max_len ? addr - 2 * fusion_max_len + 1 : 0;
+
+	memset(&fusion[first], FUSE_UNKNOWN, addr - first + 1);
+}
+
+void Chip8Core::mark_jump_target(WORD addr)
+{
+	addr &= ram_size - 1;
+
+	if (jump_target[addr])
+		return;
+
+	jump_target[addr] = 1;
+
+	// nowy cel skoku moze lezec w srodku juz rozpoznanej superinstrukcji
+	const int first = addr >= 2 * fusion_max_len ? addr - 2 * fusion_max_len + 1 : 0;
+
+	memset(&fusion[first], FUSE_UNKNOWN, addr - first);
+}
+
+void Chip8Core::predecode(WORD pc)
+{
+	pc &= ram_size - 1;
+
+	if (fusion[pc] == FUSE_UNKNOWN)
+		analyze_fusion(pc);
+}
+
+void Chip8Core::export_analysis(Chip8Analysis& out) const
+{
+	memset(&out, 0, sizeof(out));
+	memcpy(out.jump_target, jump_target, ram_size);
+
+	const unsigned long long dirty = st->dirty_pages;
+
+	for (int pc = 0; pc < ram_size; pc++)
+	{
+		if (fusion[pc] == FUSE_UNKNOWN)
+			continue;
+
+		// analiza czytala slowa od pc do pc + 2 * len + 2
+		const int end = pc + 2 * fusion_len[pc] + 2 < ram_size ? pc + 2 * fusion_len[pc] + 2 : ram_size;
+		bool written = false;
+
+		for (int p = pc / Chip8State::page_size; p <= (end - 1) / Chip8State::page_size; p++)
+			written |= (dirty >> p & 1) != 0;
+
+		if (written)
+		{
+			out.quirks |= QUIRK_SELF_MODIFYING;
+			continue;
+		}
+
+		out.fusion[pc] = fusion[pc];
+		out.fusion_len[pc] = fusion_len[pc];
+		out.code_count++;
+
+		const WORD op = (pristine[pc] << 8) | pristine[(pc + 1) & (ram_size - 1)];
+
+		if ((op & 0xF0FF) == 0xF055 || (op & 0xF0FF) == 0xF065)
+			out.quirks |= QUIRK_LOAD_STORE;
+		else if ((op & 0xF00F) == 0x8006 || (op & 0xF00F) == 0x800E)
+			out.quirks |= QUIRK_SHIFT;
+		else if ((op & 0xF000) == 0xB000)
+			out.quirks |= QUIRK_JUMP_V0;
+		else if ((op & 0xF00C) == 0x8000 && (op & 0x0003) != 0)
+			out.quirks |= QUIRK_LOGIC_VF;
+	}
+}
+
+bool Chip8Core::import_analysis(const Chip8Analysis& in)
+{
+	// wpisy opisuja obraz gry, wiec pamiec nie moze byc jeszcze zmieniona
+	if (st->dirty_pages)
+		return false;
+
+	for (int pc = 0; pc < ram_size; pc++)
+	{
+		const BYTE kind = in.fusion[pc];
+		const BYTE len = in.fusion_len[pc];
+
+		if (kind >= FUSE_KINDS || len > fusion_max_len || in.jump_target[pc] > 1)
+			return false;
+
+		if (kind != FUSE_UNKNOWN && len == 0)
+			return false;
+
+		if (kind > FUSE_NONE && pc + 2 * len > ram_size)
+			return false;
+	}
+
+	memcpy(fusion, in.fusion, ram_size);
+	memcpy(fusion_len, in.fusion_len, ram_size);
+	memcpy(jump_target, in.jump_target, ram_size);
+
+	return true;
+}
@@ -0,0 +1,119 @@
+#include "chip8core.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib> // abort
+#include <vector>
+
+// harness dla fuzzerow (libFuzzer, AFL++). Wejscie to obraz gry i plan klawiszy:
+//   bajt 0          - liczba klatek planu klawiszy K
+//   bajty 1..2K     - maski klawiszy na kolejne klatki (little endian), potem w kolko
+//   reszta          - ROM ladowany pod 0x200
+// Rdzen jest kompilowany z CHIP8_CHECKED, wiec kazdy wykryty blad programu
+// (pamiec, stos, numer klawisza) konczy sie abort() i fuzzer zapisuje przypadek.
+// Stan nie jest odtwarzany z pliku ani przez init(): na poczatku kazdego
+// wykonania odtwarzamy obraz stanu po starcie (czcionka, wyzerowane rejestry),
+// kopiujac tylko strony zmienione przez poprzednie wejscie, i wpisujemy ROM
+// prosto do pamieci
+
+static const unsigned int max_instructions = 20000;
+
+static Chip8Core* core = nullptr;
+static Chip8State snapshot;
+
+static void run_input(const uint8_t* data, size_t size)
+{
+	if (!core)
+	{
+		core = new Chip8Core;
+		snapshot = core->state();
+	}
+
+	const size_t keyframes = size ? data[0] : 0;
+	const size_t schedule_len = 1 + 2 * keyframes;
+
+	if (size < schedule_len)
+		return;
+
+	const uint8_t* schedule = data + 1;
+	const uint8_t* rom = data + schedule_len;
+	const size_t rom_len = size - schedule_len;
+
+	if (rom_len == 0 || rom_len > static_cast<size_t>(Chip8Core::ram_size - Chip8Core::game_start_addr))
+		return;
+
+	// szybki reset: obraz stanu po starcie + ROM, bez odczytu pliku
+	core->restore_state(snapshot);
+	core->write_memory(Chip8Core::game_start_addr, rom, rom_len);
+
+	const unsigned int frames = max_instructions / core->get_cycles_per_frame();
+
+	for (unsigned int frame = 0; frame < frames; frame++)
+	{
+		WORD mask = 0;
+
+		if (keyframes)
+		{
+			const size_t k = frame % keyframes;
+			mask = static_cast<WORD>(schedule[2 * k] | schedule[2 * k + 1] << 8);
+		}
+
+		core->set_keys(mask);
+		core->run_frame();
+
+		if (core->fault() != Chip8Core::FAULT_NONE)
+		{
+			fprintf(stderr, "CHIP-8 fault: %s (address/value 0x%X, PC 0x%03X, frame %u)\n",
+				Chip8Core::fault_name(core->fault()), core->fault_addr(), core->fault_pc_addr(), frame);
+			abort();
+		}
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	run_input(data, size);
+	return 0;
+}
+
+#ifdef CHIP8_FUZZ_STANDALONE
+
+// bez libFuzzera: wykonuje pliki podane w argumentach albo dane ze stdin
+// (tak uruchamia program AFL++, a przy okazji sluzy do odtwarzania znalezionych bledow)
+static void run_file(FILE* f)
+{
+	std::vector<uint8_t> buf;
+	uint8_t chunk[4096];
+	size_t n;
+
+	while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+		buf.insert(buf.end(), chunk, chunk + n);
+
+	run_input(buf.empty() ? nullptr : &buf[0], buf.size());
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		run_file(stdin);
+		return 0;
+	}
+
+	for (int i = 1; i < argc; i++)
+	{
+		FILE* f = fopen(argv[i], "rb");
+
+		if (!f)
+		{
+			fprintf(stderr, "Can't open %s\n", argv[i]);
+			return 1;
+		}
+
+		run_file(f);
+		fclose(f);
+	}
+
+	return 0;
+}
+
+#endif
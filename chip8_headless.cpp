@@ -0,0 +1,506 @@
+#include "chip8core.h"
+#include "config.h"
+#include "romfile.h"
+#include "capture.h"
+#include "movie.h"
+#include "regress.h"
+#include "gdbstub.h"
+#include "analysis.h"
+#include "chip8_profile.h"
+#include "runahead.h"
+#include "netplay.h"
+#include "shmexport.h"
+#include <chrono>
+#ifdef CHIP8_ALLOC_AUDIT
+	#include "alloc_audit.h"
+#endif
+#include <iostream>
+#include <cinttypes> // PRIx64
+#include <cstdio>
+#include <string>
+#include <cstdlib> // strtoul
+#include <thread>
+
+using namespace std;
+
+// emulator bez okna: wykonuje zadana liczbe klatek tak szybko, jak sie da
+
+static void usage()
+{
+	cerr << "Usage: chip8_headless [settings.ini] [options]\n"
+		"  --frames N     number of 60 Hz frames to run (default 600)\n"
+		"  --rom FILE     run FILE instead of rom_path from the settings\n"
+		"  --y4m FILE     record video to a Y4M file\n"
+		"  --gif FILE     record video to an animated GIF\n"
+		"  --movie FILE   play key masks from an input movie\n"
+		"  --hash-out F   write the per-frame hash stream to F (- = stdout)\n"
+		"  --regs         include registers in frame hashes\n"
+		"  --golden FILE  compare frame hashes with a golden stream\n"
+		"  --update       regenerate golden files instead of comparing\n"
+		"  --corpus DIR   check every DIR/NAME.ch8 against NAME.golden in parallel\n"
+		"  --jobs N       worker threads for --corpus (default: all cores)\n"
+		"  --stats        print superinstruction fusion hit rates\n"
+		"  --no-fusion    disable superinstruction fusion\n"
+		"  --timing T     timing model: fixed (cycles_per_frame) or vip\n"
+		"  --gdb ADDR     wait for GDB on a TCP port, host:port or unix:/path\n"
+		"  --cache DIR    load and save code analysis in DIR (see analysis_cache)\n"
+		"  --profile FILE write a host-time profile as collapsed stacks\n"
+		"  --runahead N   emulate N frames ahead for recorded video (see runahead)\n"
+		"  --shm NAME     publish the state in shared memory (see shm_export)\n"
+		"  --net-local A  netplay: our address (port, host:port or unix:/path)\n"
+		"  --net-peer A   netplay: the other player's address\n"
+		"  --net-latency MS  netplay: added send latency in ms\n";
+}
+
+// gra przez siec w tempie 60 klatek/s: nasze klawisze z filmu, hasze liczone
+// dopiero z potwierdzonych klatek, wiec obie strony daja ten sam strumien
+static bool run_netplay(Chip8Core& core, const Chip8Config& cfg, const InputMovie& movie,
+	unsigned long frames, bool with_regs, SharedExport& shm, vector<uint64_t>* hashes)
+{
+	Netplay net(core);
+
+	if (!net.open(cfg.netplay_local, cfg.netplay_peer, cfg.netplay_latency))
+		return false;
+
+	const auto period = chrono::microseconds(16667);
+	const auto timeout = chrono::seconds(10);
+	auto next = chrono::steady_clock::now();
+	auto progress = next;
+	unsigned long hashed = 0;
+
+	// konczymy, gdy wszystkie klatki sa potwierdzone u nas i u drugiego gracza
+	while (hashed < frames || net.acked_frames() < frames)
+	{
+		const unsigned int before = net.confirmed_frames() + net.acked_frames();
+
+		shm.begin_frame();
+
+		if (net.current_frame() < frames)
+			net.advance(movie.at(net.current_frame()));
+		else
+			net.poll();
+
+		shm.end_frame();
+
+		for (; hashed < net.confirmed_frames() && hashed < frames; hashed++)
+		{
+			if (hashes)
+				hashes->push_back(frame_hash(net.state_after(static_cast<unsigned int>(hashed)), with_regs));
+		}
+
+		const auto now = chrono::steady_clock::now();
+
+		if (net.confirmed_frames() + net.acked_frames() != before)
+			progress = now;
+		else if (now - progress > timeout)
+		{
+			cerr << "Netplay: peer not responding, giving up at frame " << hashed << endl;
+			return false;
+		}
+
+		next += period;
+
+		if (next > now)
+			this_thread::sleep_for(next - now);
+		else
+			next = now;
+	}
+
+	// drugi gracz moze jeszcze nie wiedziec, ze znamy cale jego wejscie:
+	// przez chwile dalej odpowiadamy na jego pakiety
+	const auto linger = chrono::steady_clock::now() + chrono::milliseconds(500 + 2 * cfg.netplay_latency);
+
+	while (chrono::steady_clock::now() < linger)
+	{
+		net.poll();
+		this_thread::sleep_for(period);
+	}
+
+	cout << net.report() << endl;
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	string cfg_path = "../settings.ini";
+	unsigned long frames = 600;
+	string y4m_path, gif_path;
+	bool y4m_set = false, gif_set = false;
+	string movie_path, hash_path, golden_path, corpus_dir, gdb_addr, timing_name, cache_dir, profile_path;
+	string net_local, net_peer, shm_name, rom_path;
+	bool cache_set = false, runahead_set = false, latency_set = false;
+	unsigned int runahead = 0, latency = 0;
+	bool with_regs = false, update = false, stats = false, no_fusion = false;
+	unsigned int jobs = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--frames" && i + 1 < argc)
+			frames = strtoul(argv[++i], nullptr, 0);
+		else if (arg == "--y4m" && i + 1 < argc)
+		{
+			y4m_path = argv[++i];
+			y4m_set = true;
+		}
+		else if (arg == "--gif" && i + 1 < argc)
+		{
+			gif_path = argv[++i];
+			gif_set = true;
+		}
+		else if (arg == "--rom" && i + 1 < argc)
+			rom_path = argv[++i];
+		else if (arg == "--movie" && i + 1 < argc)
+			movie_path = argv[++i];
+		else if (arg == "--hash-out" && i + 1 < argc)
+			hash_path = argv[++i];
+		else if (arg == "--golden" && i + 1 < argc)
+			golden_path = argv[++i];
+		else if (arg == "--corpus" && i + 1 < argc)
+			corpus_dir = argv[++i];
+		else if (arg == "--timing" && i + 1 < argc)
+			timing_name = argv[++i];
+		else if (arg == "--gdb" && i + 1 < argc)
+			gdb_addr = argv[++i];
+		else if (arg == "--cache" && i + 1 < argc)
+		{
+			cache_dir = argv[++i];
+			cache_set = true;
+		}
+		else if (arg == "--profile" && i + 1 < argc)
+			profile_path = argv[++i];
+		else if (arg == "--runahead" && i + 1 < argc)
+		{
+			runahead = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+			runahead_set = true;
+		}
+		else if (arg == "--shm" && i + 1 < argc)
+			shm_name = argv[++i];
+		else if (arg == "--net-local" && i + 1 < argc)
+			net_local = argv[++i];
+		else if (arg == "--net-peer" && i + 1 < argc)
+			net_peer = argv[++i];
+		else if (arg == "--net-latency" && i + 1 < argc)
+		{
+			latency = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+			latency_set = true;
+		}
+		else if (arg == "--jobs" && i + 1 < argc)
+			jobs = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+		else if (arg == "--regs")
+			with_regs = true;
+		else if (arg == "--update")
+			update = true;
+		else if (arg == "--stats")
+			stats = true;
+		else if (arg == "--no-fusion")
+			no_fusion = true;
+		else if (arg[0] != '-')
+			cfg_path = arg;
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+
+	Chip8Config cfg;
+
+	if (!load_config(cfg_path, cfg))
+		cerr << "Can't read settings file " << cfg_path << ", using defaults.\n";
+
+	if (!rom_path.empty())
+		cfg.rom_path = rom_path;
+
+	if (y4m_set)
+		cfg.capture_y4m = y4m_path;
+
+	if (gif_set)
+		cfg.capture_gif = gif_path;
+
+	if (no_fusion)
+		cfg.fusion = false;
+
+	if (!gdb_addr.empty())
+		cfg.gdb = gdb_addr;
+
+	if (cache_set)
+		cfg.analysis_cache = cache_dir;
+
+	if (!profile_path.empty())
+		cfg.profile = profile_path;
+
+	if (runahead_set)
+		cfg.runahead = runahead;
+
+	if (!shm_name.empty())
+		cfg.shm_export = shm_name;
+
+	if (!net_local.empty())
+		cfg.netplay_local = net_local;
+
+	if (!net_peer.empty())
+		cfg.netplay_peer = net_peer;
+
+	if (latency_set)
+		cfg.netplay_latency = latency;
+
+	log_set_level(cfg.log_level);
+
+	if (!timing_name.empty() && !parse_timing(timing_name, cfg.timing))
+	{
+		usage();
+		return -1;
+	}
+
+	if (!corpus_dir.empty())
+	{
+		CorpusOptions opt;
+		opt.update = update;
+		opt.default_frames = frames;
+		opt.with_regs = with_regs;
+		opt.cycles_per_frame = cfg.cycles_per_frame;
+		opt.timing = cfg.timing;
+		opt.seed = cfg.seed;
+		opt.jobs = jobs;
+		opt.fusion = cfg.fusion;
+		opt.stats = stats;
+		opt.analysis_cache = cfg.analysis_cache;
+
+		const int failed = run_corpus(corpus_dir, opt);
+		log_stop();
+
+		return failed ? 1 : 0;
+	}
+
+	Chip8Core core;
+	core.set_cycles_per_frame(cfg.cycles_per_frame);
+	core.set_timing(cfg.timing);
+	core.set_fusion(cfg.fusion);
+
+	// 0 zostawia stale ziarno rdzenia, zeby przebiegi byly powtarzalne
+	if (cfg.seed)
+		core.set_seed(cfg.seed);
+
+	if (!load_rom_file(cfg.rom_path, core))
+	{
+		cerr << "Game file not loaded! Quitting...\n";
+		return -1;
+	}
+
+	AnalysisCache cache(cfg.analysis_cache);
+	const bool cached = cache.load(core);
+
+	InputMovie movie;
+
+	if (!movie_path.empty() && !movie.load(movie_path))
+	{
+		cerr << "Can't read input movie " << movie_path << endl;
+		return -1;
+	}
+
+	GoldenStream golden;
+	const bool verify = !golden_path.empty() && !update;
+
+	if (verify)
+	{
+		if (!golden.load(golden_path))
+		{
+			cerr << "Can't read golden file " << golden_path << endl;
+			return -1;
+		}
+
+		// porownujemy w dokladnie tych samych warunkach, w jakich powstal wzorzec
+		frames = golden.hashes.size();
+		with_regs = golden.with_regs;
+		core.set_cycles_per_frame(golden.cycles_per_frame);
+		core.set_timing(golden.timing);
+		core.set_seed(golden.seed);
+	}
+
+	const bool hashing = verify || update || !hash_path.empty();
+	vector<uint64_t> hashes;
+
+	if (hashing)
+		hashes.reserve(frames);
+
+	FrameCapture capture;
+
+	if (!cfg.capture_y4m.empty() || !cfg.capture_gif.empty())
+		capture.open(cfg.capture_y4m, cfg.capture_gif, cfg.pixel_size, true);
+
+	Chip8Profile profile;
+	Chip8Profile* prof = cfg.profile.empty() ? nullptr : &profile;
+	core.set_profile(prof);
+
+	// hasze liczymy z prawdziwego przebiegu, nagrywamy to, co byloby pokazane
+	RunAhead ahead(cfg.runahead);
+
+	GdbStub gdb(core);
+
+	if (!cfg.gdb.empty() && !gdb.listen(cfg.gdb))
+		return -1;
+
+	SharedExport shm;
+
+	if (!cfg.shm_export.empty() && !shm.create(cfg.shm_export, core))
+		return -1;
+
+	// przy grze przez siec klatkami steruje Netplay (bez GDB i nagrywania)
+	if (!cfg.netplay_peer.empty())
+	{
+		if (!run_netplay(core, cfg, movie, frames, with_regs, shm, hashing ? &hashes : nullptr))
+			return -1;
+	}
+	else
+	{
+		for (unsigned long frame = 0; frame < frames; )
+		{
+			// klawisze klatki ustawiamy przed debuggerem - krokowanie tez ja wykonuje
+			core.set_keys(movie.at(frame));
+
+			bool stepped = false;
+
+			if (gdb.is_listening())
+			{
+				// zatrzymani czekamy na pakiety, zamiast krecic sie w petli
+				gdb.poll(gdb.is_halted() ? 100 : 0);
+				stepped = gdb.frame_done();
+
+				if (gdb.is_halted() && !stepped)
+					continue;
+			}
+
+			// klatka dokonczona krokowaniem w debuggerze liczy sie jak kazda inna
+			if (stepped)
+				ahead.clear_prediction();
+			else
+			{
+				bool done;
+
+				{
+					ProfileScope scope(prof, Chip8Profile::SUB_RUN_FRAME);
+					shm.begin_frame();
+					done = ahead.run_frame(core);
+					shm.end_frame();
+				}
+
+				// klatka przerwana pulapka jest dokonczona po wznowieniu
+				if (!done)
+				{
+					gdb.report_stop();
+					continue;
+				}
+			}
+
+			{
+				ProfileScope scope(prof, Chip8Profile::SUB_CAPTURE);
+				capture.push(ahead.framebuffer(core), static_cast<unsigned int>(frame));
+			}
+
+			if (hashing)
+				hashes.push_back(frame_hash(core, with_regs));
+
+			frame++;
+
+#ifdef CHIP8_ALLOC_AUDIT
+			// pierwsza klatka moze przygotowac bufory; dalej nic nie alokujemy
+			if (frame == 1)
+				alloc_audit_arm();
+#endif
+		}
+	}
+
+#ifdef CHIP8_ALLOC_AUDIT
+	alloc_audit_disarm();
+
+	const bool allocated = alloc_audit_count() != 0;
+	cout << "allocation audit: " << alloc_audit_count() << " allocations (" << alloc_audit_bytes() << " bytes) after the first frame\n";
+#else
+	const bool allocated = false;
+#endif
+
+	gdb.close();
+	shm.close();
+
+	capture.close(static_cast<unsigned int>(frames));
+
+	// powtorzone ostrzezenia trafiaja na wyjscie przed wynikami; emulacja sie
+	// skonczyla, wiec watek dziennika tez
+	log_stop();
+
+	cache.store(core);
+
+	core.set_profile(nullptr);
+
+	if (prof)
+	{
+		if (!profile.write_collapsed(cfg.profile))
+			cerr << "Can't write profile " << cfg.profile << endl;
+
+		cout << profile.report() << "\n";
+	}
+
+	if (cfg.runahead)
+		cout << ahead.report() << "\n";
+
+	if (stats)
+	{
+		cout << fusion_report(core) << "\n";
+
+		if (cache.enabled())
+			cout << "analysis cache: " << (cached ? "hit" : "miss") << " (" << cache.entry_path(core) << ")\n";
+	}
+
+	golden.cycles_per_frame = core.get_cycles_per_frame();
+	golden.timing = core.get_timing();
+	golden.seed = core.get_seed();
+	golden.with_regs = with_regs;
+
+	if (!hash_path.empty())
+	{
+		FILE* out = hash_path == "-" ? stdout : fopen(hash_path.c_str(), "w");
+
+		if (!out)
+		{
+			cerr << "Can't write " << hash_path << endl;
+			return -1;
+		}
+
+		for (size_t i = 0; i < hashes.size(); i++)
+			fprintf(out, "%016" PRIx64 "\n", hashes[i]);
+
+		if (out != stdout)
+			fclose(out);
+	}
+
+	if (update && !golden_path.empty())
+	{
+		golden.hashes.swap(hashes);
+
+		if (!golden.save(golden_path))
+		{
+			cerr << "Can't write golden file " << golden_path << endl;
+			return -1;
+		}
+
+		cout << "Golden file " << golden_path << " updated (" << golden.hashes.size() << " frames).\n";
+	}
+	else if (verify)
+	{
+		const long diverged = first_divergence(golden.hashes, hashes);
+
+		if (diverged >= 0)
+		{
+			fprintf(stderr, "FAIL: first divergence at frame %ld (expected %016" PRIx64 ", got %016" PRIx64 ")\n",
+				diverged, golden.hashes[diverged], hashes[diverged]);
+			return 1;
+		}
+
+		cout << "PASS (" << hashes.size() << " frames)\n";
+	}
+
+	return allocated ? 1 : 0;
+}
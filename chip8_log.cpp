@@ -0,0 +1,470 @@
+#include "chip8_log.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+// jak czesto watek wypisujacy sprawdza kolejke i podsumowuje powtorzenia
+static const chrono::milliseconds poll_interval(20);
+static const chrono::milliseconds repeat_interval(1000);
+
+static const char* const level_names[] = { "Debug", "Info", "Warning", "Error" };
+
+static const char* const message_formats[MSG_KINDS] =
+{
+	"unknown opcode 0x%04X at 0x%03X",		// MSG_UNKNOWN_OPCODE
+	"unexpected opcode 0x%04X at 0x%03X"	// MSG_UNEXPECTED_OPCODE
+};
+
+namespace
+{
+
+// ograniczona kolejka wielu producentow (kilka rdzeni w roznych watkach)
+// i jednego konsumenta. Kazda komorka ma numer sekwencyjny, ktory mowi, czy
+// jest wolna do zapisu, czy gotowa do odczytu (kolejka D. Vyukova)
+class LogQueue
+{
+private:
+	static const size_t		capacity		= 4096; // potega dwojki
+
+	struct Cell
+	{
+		atomic<size_t>		seq;
+		LogRecord			rec;
+	};
+
+	Cell					cells[capacity];
+	atomic<size_t>			head;	// nastepny zapis
+	size_t					tail	= 0;	// nastepny odczyt (tylko konsument)
+
+public:
+	LogQueue() : head(0)
+	{
+		for (size_t i = 0; i < capacity; i++)
+			cells[i].seq.store(i, memory_order_relaxed);
+	}
+
+	// filled = czy zapis zapelnil kolejna polowe kolejki
+	bool push(const LogRecord& rec, bool& filled)
+	{
+		size_t pos = head.load(memory_order_relaxed);
+
+		for (;;)
+		{
+			Cell& cell = cells[pos & (capacity - 1)];
+			const size_t seq = cell.seq.load(memory_order_acquire);
+			const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+			if (diff == 0)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+				{
+					cell.rec = rec;
+					cell.seq.store(pos + 1, memory_order_release);
+					filled = ((pos + 1) & (capacity / 2 - 1)) == 0;
+					return true;
+				}
+			}
+			else if (diff < 0)
+				return false; // pelna
+			else
+				pos = head.load(memory_order_relaxed);
+		}
+	}
+
+	bool pop(LogRecord& rec)
+	{
+		Cell& cell = cells[tail & (capacity - 1)];
+
+		if (cell.seq.load(memory_order_acquire) != tail + 1)
+			return false;
+
+		rec = cell.rec;
+		cell.seq.store(tail + capacity, memory_order_release);
+		tail++;
+
+		return true;
+	}
+};
+
+class Logger
+{
+private:
+	struct Repeat
+	{
+		uint64_t			key;		// empty_slot = wolne
+		unsigned long long	count;		// wszystkie wystapienia
+		unsigned long long	reported;	// wystapienia juz wypisane
+	};
+
+	// ostatnio widziane komunikaty: (klucz << 16) | powtorzenia jeszcze nie
+	// wyslane do kolejki. Klucz miesci sie w 48 bitach, bo poziom < 256
+	static const size_t		slot_count		= 1024;
+	static const uint64_t	empty_slot		= ~0ULL;
+
+	// tablica powtorzen ma staly rozmiar, zeby wypisywanie nie alokowalo;
+	// komunikaty ponad limit sa wypisywane bez zliczania
+	static const size_t		repeat_count	= 4096; // potega dwojki
+	static const size_t		repeat_limit	= repeat_count / 4 * 3;
+
+	LogQueue				queue;
+	atomic<uint64_t>		slots[slot_count];
+	atomic<int>				level;
+	atomic<unsigned long long> dropped;
+	atomic<bool>			kicked;		// kolejka zapelnia sie, nie czekac do nastepnego sprawdzenia
+
+	mutex					control;	// start/stop watku wypisujacego
+	thread					writer;
+	mutex					lock;
+	condition_variable		wake;
+	condition_variable		drained;
+	bool					quit			= false;
+	unsigned long long		flush_requests	= 0;
+	unsigned long long		flushes_done	= 0;
+
+	// tylko watek wypisujacy
+	Repeat					repeats[repeat_count];
+	size_t					repeats_used	= 0;
+	unsigned long long		reported_drops	= 0;
+
+public:
+	Logger() : level(LOG_WARNING), dropped(0), kicked(false)
+	{
+		for (size_t i = 0; i < slot_count; i++)
+			slots[i].store(empty_slot, memory_order_relaxed);
+
+		for (size_t i = 0; i < repeat_count; i++)
+			repeats[i].key = empty_slot;
+	}
+
+	// destruktor obiektu statycznego biblioteki dziala tez przy dlclose albo
+	// w DLL_PROCESS_DETACH (pod blokada loadera), gdzie czekanie na watek moze
+	// zawiesic proces. Watek konczy log_stop(); tutaj tylko go odlaczamy
+	~Logger()
+	{
+		if (!writer.joinable())
+			return;
+
+		{
+			lock_guard<mutex> guard(lock);
+			quit = true;
+		}
+
+		wake.notify_one();
+		writer.detach();
+	}
+
+	void set_level(int l)
+	{
+		level.store(l, memory_order_relaxed);
+
+		// watek startuje przy ustawianiu poziomu, a nie przy pierwszym komunikacie
+		// w trakcie gry - tworzenie watku alokuje. LOG_OFF go zatrzymuje
+		if (l < LOG_OFF)
+			start();
+		else
+			stop();
+	}
+
+	int get_level() const { return level.load(memory_order_relaxed); }
+	unsigned long long drops() const { return dropped.load(memory_order_relaxed); }
+
+	void start()
+	{
+		lock_guard<mutex> guard(control);
+
+		if (level.load(memory_order_relaxed) >= LOG_OFF || writer.joinable())
+			return;
+
+		quit = false;
+		writer = thread(&Logger::writer_loop, this);
+	}
+
+	// wypisuje wszystko z kolejki i liczniki powtorzen, potem konczy watek
+	void stop()
+	{
+		lock_guard<mutex> guard(control);
+
+		if (!writer.joinable())
+			return;
+
+		{
+			lock_guard<mutex> guard2(lock);
+			quit = true;
+		}
+
+		wake.notify_one();
+		writer.join();
+	}
+
+	void push(int l, int message, uint16_t pc, uint16_t arg)
+	{
+		if (l < level.load(memory_order_relaxed) || l >= LOG_OFF || message < 0 || message >= MSG_KINDS)
+			return;
+
+		const uint64_t k = static_cast<uint64_t>(l) << 40 | static_cast<uint64_t>(message) << 32
+			| static_cast<uint64_t>(pc) << 16 | arg;
+		atomic<uint64_t>& slot = slots[slot_index(k)];
+		uint64_t cur = slot.load(memory_order_relaxed);
+
+		for (;;)
+		{
+			if ((cur >> 16) == k)
+			{
+				// powtorzenie: tylko licznik, a pelny licznik idzie do kolejki
+				if ((cur & 0xFFFF) != 0xFFFF)
+				{
+					if (slot.compare_exchange_weak(cur, cur + 1, memory_order_relaxed))
+						return;
+				}
+				else if (slot.compare_exchange_weak(cur, k << 16 | 1, memory_order_relaxed))
+				{
+					enqueue(k, 0xFFFF);
+					return;
+				}
+			}
+			else if (slot.compare_exchange_weak(cur, k << 16, memory_order_relaxed))
+			{
+				// komunikat wypiera z komorki inny; jego licznik nie moze przepasc
+				if (cur != empty_slot && (cur & 0xFFFF) != 0)
+					enqueue(cur >> 16, static_cast<uint16_t>(cur & 0xFFFF));
+
+				enqueue(k, 1);
+				return;
+			}
+		}
+	}
+
+	void flush()
+	{
+		if (!writer.joinable())
+			return;
+
+		unique_lock<mutex> guard(lock);
+		const unsigned long long request = ++flush_requests;
+
+		wake.notify_one();
+		drained.wait(guard, [&]() { return flushes_done >= request || quit; });
+	}
+
+private:
+	static size_t slot_index(uint64_t k)
+	{
+		return static_cast<size_t>((k * 0x9E3779B97F4A7C15ULL) >> 54) & (slot_count - 1);
+	}
+
+	void enqueue(uint64_t k, uint16_t count)
+	{
+		LogRecord rec;
+		rec.level = static_cast<uint8_t>(k >> 40);
+		rec.message = static_cast<uint8_t>(k >> 32);
+		rec.pc = static_cast<uint16_t>(k >> 16);
+		rec.arg = static_cast<uint16_t>(k);
+		rec.count = count;
+
+		bool filled = false;
+
+		if (!queue.push(rec, filled))
+			dropped.fetch_add(count, memory_order_relaxed);
+		else if (filled)
+		{
+			kicked.store(true, memory_order_relaxed);
+			wake.notify_one();
+		}
+	}
+
+	static uint64_t key(const LogRecord& rec)
+	{
+		return static_cast<uint64_t>(rec.level) << 40 | static_cast<uint64_t>(rec.message) << 32
+			| static_cast<uint64_t>(rec.pc) << 16 | rec.arg;
+	}
+
+	static void print(const LogRecord& rec, unsigned long long repeated)
+	{
+		char text[128];
+		snprintf(text, sizeof(text), message_formats[rec.message], rec.arg, rec.pc);
+
+		if (repeated)
+			fprintf(stderr, "%s: %s (repeated %llu times)\n", level_names[rec.level], text, repeated);
+		else
+			fprintf(stderr, "%s: %s\n", level_names[rec.level], text);
+	}
+
+	Repeat* find_repeat(uint64_t k)
+	{
+		for (size_t i = static_cast<size_t>((k * 0x9E3779B97F4A7C15ULL) >> 52) & (repeat_count - 1); ; i = (i + 1) & (repeat_count - 1))
+		{
+			if (repeats[i].key == k)
+				return &repeats[i];
+
+			if (repeats[i].key == empty_slot)
+			{
+				if (repeats_used >= repeat_limit)
+					return nullptr;
+
+				repeats_used++;
+				repeats[i].key = k;
+				repeats[i].count = 0;
+				repeats[i].reported = 0;
+				return &repeats[i];
+			}
+		}
+	}
+
+	// pierwsze wystapienie wypisujemy od razu, kolejne tylko zliczamy
+	void handle(const LogRecord& rec)
+	{
+		Repeat* r = find_repeat(key(rec));
+
+		if (!r)
+		{
+			print(rec, rec.count - 1u);
+			return;
+		}
+
+		if (r->count == 0)
+		{
+			r->reported = 1;
+			print(rec, 0);
+		}
+
+		r->count += rec.count;
+	}
+
+	void report_repeats()
+	{
+		// zabieramy liczniki powtorzen z komorek producentow
+		for (size_t i = 0; i < slot_count; i++)
+		{
+			uint64_t cur = slots[i].load(memory_order_relaxed);
+
+			while (cur != empty_slot && (cur & 0xFFFF) != 0)
+			{
+				if (slots[i].compare_exchange_weak(cur, cur & ~0xFFFFULL, memory_order_relaxed))
+				{
+					LogRecord rec;
+					rec.level = static_cast<uint8_t>(cur >> 56);
+					rec.message = static_cast<uint8_t>(cur >> 48);
+					rec.pc = static_cast<uint16_t>(cur >> 32);
+					rec.arg = static_cast<uint16_t>(cur >> 16);
+					rec.count = static_cast<uint16_t>(cur & 0xFFFF);
+					handle(rec);
+					break;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < repeat_count; i++)
+		{
+			Repeat& r = repeats[i];
+
+			if (r.key == empty_slot || r.count == r.reported)
+				continue;
+
+			LogRecord rec;
+			rec.level = static_cast<uint8_t>(r.key >> 40);
+			rec.message = static_cast<uint8_t>(r.key >> 32);
+			rec.pc = static_cast<uint16_t>(r.key >> 16);
+			rec.arg = static_cast<uint16_t>(r.key);
+
+			print(rec, r.count - r.reported);
+			r.reported = r.count;
+		}
+
+		const unsigned long long d = dropped.load(memory_order_relaxed);
+
+		if (d != reported_drops)
+		{
+			fprintf(stderr, "Warning: log queue overflow, %llu messages dropped\n", d - reported_drops);
+			reported_drops = d;
+		}
+
+		fflush(stderr);
+	}
+
+	void writer_loop()
+	{
+		auto last_report = chrono::steady_clock::now();
+
+		for (;;)
+		{
+			bool stop;
+			unsigned long long request;
+
+			{
+				unique_lock<mutex> guard(lock);
+				wake.wait_for(guard, poll_interval, [&]() { return quit || flush_requests != flushes_done || kicked.load(memory_order_relaxed); });
+				kicked.store(false, memory_order_relaxed);
+				stop = quit;
+				request = flush_requests;
+			}
+
+			// rekordy wstawione przed log_flush() sa juz widoczne w kolejce
+			LogRecord rec;
+
+			while (queue.pop(rec))
+				handle(rec);
+
+			const auto now = chrono::steady_clock::now();
+
+			if (stop || request != flushes_done || now - last_report >= repeat_interval)
+			{
+				report_repeats();
+				last_report = now;
+			}
+
+			{
+				lock_guard<mutex> guard(lock);
+				flushes_done = request;
+			}
+
+			drained.notify_all();
+
+			if (stop)
+				return;
+		}
+	}
+};
+
+Logger logger;
+
+}
+
+void log_set_level(int level)
+{
+	logger.set_level(level);
+}
+
+int log_get_level()
+{
+	return logger.get_level();
+}
+
+void log_start()
+{
+	logger.start();
+}
+
+void log_stop()
+{
+	logger.stop();
+}
+
+void log_push(int level, int message, uint16_t pc, uint16_t arg)
+{
+	logger.push(level, message, pc, arg);
+}
+
+void log_flush()
+{
+	logger.flush();
+}
+
+unsigned long long log_dropped()
+{
+	return logger.drops();
+}
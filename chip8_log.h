@@ -0,0 +1,71 @@
+#ifndef CHIP8_LOG_H
+#define CHIP8_LOG_H
+
+#include <cstdint>
+
+// dziennik komunikatow emulatora. Watek emulacji wstawia tylko staly rekord
+// binarny (poziom, rodzaj komunikatu, PC, argument) do kolejki bez blokad;
+// formatowaniem i wypisywaniem zajmuje sie osobny watek. Powtorzenia tego
+// samego komunikatu z tego samego PC nie trafiaja do kolejki, tylko zwiekszaja
+// licznik, ktory jest wypisywany zbiorczo, wiec gra skaczaca w dane nie zalewa
+// terminala. Pelna kolejka gubi rekordy (i liczy zgubione), ale nigdy nie
+// zatrzymuje emulacji
+enum LogLevel
+{
+	LOG_DEBUG = 0,
+	LOG_INFO,
+	LOG_WARNING,
+	LOG_ERROR,
+	LOG_OFF
+};
+
+// najnizszy poziom wkompilowany w program; wywolania CHIP8_LOG ponizej
+// niego znikaja calkowicie (ustawiany w CMake przez CHIP8_LOG_LEVEL)
+#ifndef CHIP8_LOG_MIN_LEVEL
+	#define CHIP8_LOG_MIN_LEVEL LOG_DEBUG
+#endif
+
+enum LogMessage
+{
+	MSG_UNKNOWN_OPCODE = 0,		// arg = opcode
+	MSG_UNEXPECTED_OPCODE,		// arg = opcode
+	MSG_KINDS
+};
+
+struct LogRecord
+{
+	uint8_t				level;
+	uint8_t				message;
+	uint16_t			pc;
+	uint16_t			arg;
+	uint16_t			count;		// ile wystapien opisuje rekord
+};
+
+#define CHIP8_LOG(level, message, pc, arg) \
+	do { if ((level) >= CHIP8_LOG_MIN_LEVEL) log_push(level, message, pc, arg); } while (0)
+
+// poziom wybrany w czasie dzialania (domyslnie LOG_WARNING). Poziom ponizej
+// LOG_OFF od razu uruchamia watek wypisujacy, LOG_OFF go zatrzymuje
+void log_set_level(int level);
+int log_get_level();
+
+// uruchamia watek wypisujacy z biezacym poziomem (jesli jest ponizej LOG_OFF).
+// Program wola log_set_level() albo log_start() przed emulacja, zeby watek
+// (i jego alokacje) nie powstawal przy pierwszym komunikacie
+void log_start();
+
+// wypisuje zalegle komunikaty i czeka na koniec watku wypisujacego. Programy
+// wolaja to przed wyjsciem z main(); destruktor biblioteki watek tylko odlacza
+void log_stop();
+
+// nie blokuje, nie alokuje i nie uruchamia watku; bez watku wypisujacego
+// rekordy czekaja w kolejce (a po jej zapelnieniu sa gubione)
+void log_push(int level, int message, uint16_t pc, uint16_t arg);
+
+// czeka, az wszystkie dotychczasowe rekordy i liczniki powtorzen zostana wypisane
+void log_flush();
+
+// rekordy zgubione przez przepelnienie kolejki
+unsigned long long log_dropped();
+
+#endif
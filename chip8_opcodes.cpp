@@ -1,234 +1,243 @@
-#include "chip8.h"
-#include <cstdlib> // rand
+#include "chip8core.h"
+#include <cstring> // memset
 
-void Chip8::opcode_00E0()
+void Chip8Core::opcode_00E0()
 {
 	// wyczysc ekran (CLS)
 
-	clear_display();
+	memset(st->screen, 0, sizeof(st->screen));
 }
 
-void Chip8::opcode_00EE()
+void Chip8Core::opcode_00EE()
 {
 	// powrot z funkcji (RET)
 
-	program_counter = stack.top();
-	stack.pop();
+	CHIP8_CHECK(st->stack_ptr > 0, FAULT_STACK_UNDERFLOW, st->stack_ptr);
+
+	st->stack_ptr = (st->stack_ptr - 1) & (Chip8State::stack_size - 1);
+	st->program_counter = st->stack[st->stack_ptr];
+	mark_jump_target(st->program_counter);
 }
 
-void Chip8::opcode_1nnn(const WORD& opcode)
+void Chip8Core::opcode_1nnn(const WORD& opcode)
 {
 	// skocz do lokacji nnn (JP addr)
 
-	program_counter = opcode & 0x0FFF;
+	st->program_counter = opcode & 0x0FFF;
+	mark_jump_target(st->program_counter);
 }
 
-void Chip8::opcode_2nnn(const WORD& opcode)
+void Chip8Core::opcode_2nnn(const WORD& opcode)
 {
 	// wywolaj funkcje pod adresem nnn (CALL addr)
 
-	stack.push(program_counter);
-	program_counter = opcode & 0x0FFF;
+	CHIP8_CHECK(st->stack_ptr < Chip8State::stack_size - 1, FAULT_STACK_OVERFLOW, st->stack_ptr);
+
+	st->stack[st->stack_ptr] = st->program_counter;
+	st->stack_ptr = (st->stack_ptr + 1) & (Chip8State::stack_size - 1);
+	st->program_counter = opcode & 0x0FFF;
+	mark_jump_target(st->program_counter);
 }
 
-void Chip8::opcode_3xkk(const WORD& opcode)
+void Chip8Core::opcode_3xkk(const WORD& opcode)
 {
 	// omin nastepna instrukcje jesli Vx == kk (SE Vx, byte)
 
 	const int regx = (opcode & 0x0F00) >> 8; // wyluskujemy numer rejestru
 	const int kk = (opcode & 0x00FF); // wyluskujemy wartosc do porownania
 
-	if (registers[regx] == kk)
-		program_counter += sizeof(WORD);
+	if (st->registers[regx] == kk)
+		st->program_counter += sizeof(WORD);
 }
 
-void Chip8::opcode_4xkk(const WORD& opcode)
+void Chip8Core::opcode_4xkk(const WORD& opcode)
 {
 	// omin nastepna instrukcje jesli Vx != kk (SNE Vx, byte)
 
 	const int regx = (opcode & 0x0F00) >> 8; // wyluskujemy numer rejestru
 	const int kk = (opcode & 0x00FF); // wyluskujemy wartosc do porownania
 
-	if (registers[regx] != kk)
-		program_counter += sizeof(WORD);
+	if (st->registers[regx] != kk)
+		st->program_counter += sizeof(WORD);
 }
 
-void Chip8::opcode_5xy0(const WORD& opcode)
+void Chip8Core::opcode_5xy0(const WORD& opcode)
 {
 	// omin nastepna instrukcje jesli Vx == Vy (SE Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
 
-	if(registers[regx] == registers[regy])
-		program_counter += sizeof(WORD);
+	if(st->registers[regx] == st->registers[regy])
+		st->program_counter += sizeof(WORD);
 }
 
-void Chip8::opcode_6xkk(const WORD& opcode)
+void Chip8Core::opcode_6xkk(const WORD& opcode)
 {
 	// zapisz wartosc kk do rejestru Vx (LD Vx, byte)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int kk = (opcode & 0x00FF);
 
-	registers[regx] = kk;
+	st->registers[regx] = kk;
 }
 
-void Chip8::opcode_7xkk(const WORD& opcode)
+void Chip8Core::opcode_7xkk(const WORD& opcode)
 {
 	// dodaj wartosc kk do rejestru Vx (ADD Vx, byte)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int kk = (opcode & 0x00FF);
 
-	registers[regx] += kk;
+	st->registers[regx] += kk;
 }
 
-void Chip8::opcode_8xy0(const WORD& opcode)
+void Chip8Core::opcode_8xy0(const WORD& opcode)
 {
 	// zapisz do rejestru Vx wartosc rejestru Vy (LD Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
 
-	registers[regx] = registers[regy];
+	st->registers[regx] = st->registers[regy];
 }
 
-void Chip8::opcode_8xy1(const WORD& opcode)
+void Chip8Core::opcode_8xy1(const WORD& opcode)
 {
 	// zapisz do rejestru Vx wynik operacji Vx OR Vy (OR Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
 
-	registers[regx] |= registers[regy];
+	st->registers[regx] |= st->registers[regy];
 }
 
-void Chip8::opcode_8xy2(const WORD& opcode)
+void Chip8Core::opcode_8xy2(const WORD& opcode)
 {
 	// zapisz do rejestru Vx wynik operacji Vx AND Vy (AND Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
 
-	registers[regx] &= registers[regy];
+	st->registers[regx] &= st->registers[regy];
 }
 
-void Chip8::opcode_8xy3(const WORD& opcode)
+void Chip8Core::opcode_8xy3(const WORD& opcode)
 {
 	// zapisz do rejestru Vx wynik operacji Vx XOR Vy (XOR Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
 
-	registers[regx] ^= registers[regy];
+	st->registers[regx] ^= st->registers[regy];
 }
 
-void Chip8::opcode_8xy4(const WORD& opcode)
+void Chip8Core::opcode_8xy4(const WORD& opcode)
 {
 	// dodaj rejestry Vx i Vy a wynik zapisz w Vx. Ustaw flage VF gdy wynik > 255 (ADD Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
-	const int sum = registers[regx] + registers[regy];
+	const int sum = st->registers[regx] + st->registers[regy];
 
 	if (sum > 0xFF)
-		registers[0xF] = 1;
+		st->registers[0xF] = 1;
 	else
-		registers[0xF] = 0;
+		st->registers[0xF] = 0;
 
-	registers[regx] = sum & 0xFF;
+	st->registers[regx] = sum & 0xFF;
 }
 
-void Chip8::opcode_8xy5(const WORD& opcode)
+void Chip8Core::opcode_8xy5(const WORD& opcode)
 {
 	// odejmij od rejestru Vx rejestr Vy a wynik zapisz w Vx. Ustaw flage VF gdy Vx > Vy (SUB Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
-	const int diff = registers[regx] - registers[regy];
+	const int diff = st->registers[regx] - st->registers[regy];
 
-	if (registers[regx] > registers[regy])
-		registers[0xF] = 1;
+	if (st->registers[regx] > st->registers[regy])
+		st->registers[0xF] = 1;
 	else
-		registers[0xF] = 0;
+		st->registers[0xF] = 0;
 
-	registers[regx] = diff & 0xFF;
+	st->registers[regx] = diff & 0xFF;
 }
 
-void Chip8::opcode_8xy6(const WORD& opcode)
+void Chip8Core::opcode_8xy6(const WORD& opcode)
 {
 	// VF = najmniej znaczacy bit Vx, Vx >> 1
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	registers[0xF] = registers[regx] & 0x01;
-	registers[regx] >>= 1;
+	st->registers[0xF] = st->registers[regx] & 0x01;
+	st->registers[regx] >>= 1;
 }
 
-void Chip8::opcode_8xy7(const WORD& opcode)
+void Chip8Core::opcode_8xy7(const WORD& opcode)
 {
 	// odejmij od rejestru Vy rejestr Vx a wynik zapisz w Vx. Ustaw flage VF gdy Vy > Vx (SUBN Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
-	const int diff = registers[regy] - registers[regx];
+	const int diff = st->registers[regy] - st->registers[regx];
 
-	if (registers[regy] > registers[regx])
-		registers[0xF] = 1;
+	if (st->registers[regy] > st->registers[regx])
+		st->registers[0xF] = 1;
 	else
-		registers[0xF] = 0;
+		st->registers[0xF] = 0;
 
-	registers[regx] = diff & 0xFF;
+	st->registers[regx] = diff & 0xFF;
 }
 
-void Chip8::opcode_8xyE(const WORD& opcode)
+void Chip8Core::opcode_8xyE(const WORD& opcode)
 {
 	// VF = najbardziej znaczacy bit Vx, Vx << 1
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	registers[0xF] = registers[regx] & 0x80;
-	registers[regx] <<= 1;
+	st->registers[0xF] = st->registers[regx] & 0x80;
+	st->registers[regx] <<= 1;
 }
 
-void Chip8::opcode_9xy0(const WORD& opcode)
+void Chip8Core::opcode_9xy0(const WORD& opcode)
 {
 	// omin nastepna instrukcje gdy Vx != Vy (SNE Vx, Vy)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int regy = (opcode & 0x00F0) >> 4;
 
-	if (registers[regx] != registers[regy])
-		program_counter += sizeof(WORD);
+	if (st->registers[regx] != st->registers[regy])
+		st->program_counter += sizeof(WORD);
 }
 
-void Chip8::opcode_Annn(const WORD& opcode)
+void Chip8Core::opcode_Annn(const WORD& opcode)
 {
 	// zapisz nnn do rejestru I (LD I, addr)
 
-	address_I = opcode & 0x0FFF;
+	st->address_I = opcode & 0x0FFF;
 }
 
-void Chip8::opcode_Bnnn(const WORD& opcode)
+void Chip8Core::opcode_Bnnn(const WORD& opcode)
 {
 	// skocz do lokacji nnn + V0 (JP V0, addr)
 
-	program_counter = (opcode & 0x0FFF) + registers[0];
+	st->program_counter = (opcode & 0x0FFF) + st->registers[0];
+	mark_jump_target(st->program_counter);
 }
 
-void Chip8::opcode_Cxkk(const WORD& opcode)
+void Chip8Core::opcode_Cxkk(const WORD& opcode)
 {
 	// Vx = (random byte) AND kk
 
 	const int regx = (opcode & 0x0F00) >> 8;
 	const int kk = (opcode & 0x00FF);
-	const int rb = rand() % 256;
+	const int rb = next_random();
 
-	registers[regx] = (rb & kk) & 0xFF;
+	st->registers[regx] = (rb & kk) & 0xFF;
 }
 
-void Chip8::opcode_Dxyn(const WORD& opcode)
+void Chip8Core::opcode_Dxyn(const WORD& opcode)
 {
 	// wyswietl n-bajtowego sprite'a zaczynajac od pamieci wskazywanej przez rejestr I w punkcie (Vx, Vy). Ustaw VF, gdy jakis pixel zmienia stan z 1 na 0
 
@@ -236,117 +245,152 @@ void Chip8::opcode_Dxyn(const WORD& opcode)
 	const int regy = (opcode & 0x00F0) >> 4;
 	const int n = opcode & 0x000F;
 
-	registers[0xF] = 0;
+	st->registers[0xF] = 0;
+
+	CHIP8_CHECK(n == 0 || st->address_I + n <= ram_size, FAULT_MEMORY, st->address_I + n - 1);
 
 	for (int row = 0; row < n; row++)
 	{
-		const BYTE sprite = game_memory[address_I + row];
+		const BYTE sprite = load_byte((st->address_I + row) & (ram_size - 1));
 
 		for (int col = 0; col < 8; col++)
 		{
 			// XOR-ujemy tylko ustawione pixele sprite'a
 			if (sprite & (1 << (7 - col)))
 			{
-				const int x = (registers[regx] + col) % width;
-				const int y = (registers[regy] + row) % height;
+				const int x = (st->registers[regx] + col) % width;
+				const int y = (st->registers[regy] + row) % height;
 
 				// test na zmiane stanu z 1 na 0
-				if (screen[x][y])
-					registers[0xF] = 1;
+				if (st->screen[y][x])
+					st->registers[0xF] = 1;
 				
 				// zmiana stanu piksela ekranu
-				screen[x][y] ^= 1;
+				st->screen[y][x] ^= 1;
 			}
 		}
 	}
 }
 
-void Chip8::opcode_Ex9E(const WORD& opcode)
+void Chip8Core::opcode_Ex9E(const WORD& opcode)
 {
 	// omin nastepna instrukcje jesli klawisz o numerze Vx jest wcisniety (SKP Vx)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	if (key[registers[regx]])
-		program_counter += sizeof(WORD);
+	CHIP8_CHECK(st->registers[regx] < keys_number, FAULT_KEY_INDEX, st->registers[regx]);
+
+	const int k = st->registers[regx] & 0xF;
+
+	if (st->key[k])
+	{
+		observed_keys |= 1 << k;
+		st->program_counter += sizeof(WORD);
+	}
 }
 
-void Chip8::opcode_ExA1(const WORD& opcode)
+void Chip8Core::opcode_ExA1(const WORD& opcode)
 {
 	// omin nastepna instrukcje jesli klawisz o numerze Vx nie jest wcisniety (SKNP Vx)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	if (!key[registers[regx]])
-		program_counter += sizeof(WORD);
+	CHIP8_CHECK(st->registers[regx] < keys_number, FAULT_KEY_INDEX, st->registers[regx]);
+
+	const int k = st->registers[regx] & 0xF;
+
+	if (!st->key[k])
+		st->program_counter += sizeof(WORD);
+	else
+		observed_keys |= 1 << k;
 }
 
-void Chip8::opcode_Fx07(const WORD& opcode)
+void Chip8Core::opcode_Fx07(const WORD& opcode)
 {
 	// ustaw Vx = wartosc delay timera (LD Vx, DT)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	registers[regx] = delay_timer;
+	st->registers[regx] = st->delay_timer;
 }
 
-void Chip8::opcode_Fx0A(const WORD& opcode)
+void Chip8Core::opcode_Fx0A(const WORD& opcode)
 {
 	// czekaj az do wcisniecia klawisza, nastepnie ustaw Vx = numer wcisnietego klawisza (LD Vx, K)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	registers[regx] = wait_key();
+	for (BYTE i = 0; i < keys_number; i++)
+	{
+		if (st->key[i])
+		{
+			observed_keys |= 1 << i;
+			st->registers[regx] = i;
+			return;
+		}
+	}
+
+	// zaden klawisz nie jest wcisniety - powtarzamy instrukcje zamiast blokowac caly program
+	st->program_counter -= sizeof(WORD);
 }
 
-void Chip8::opcode_Fx15(const WORD& opcode)
+void Chip8Core::opcode_Fx15(const WORD& opcode)
 {
 	// ustaw wartosc delay timera = Vx (LD DT, Vx)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	delay_timer = registers[regx];
+	st->delay_timer = st->registers[regx];
 }
 
-void Chip8::opcode_Fx18(const WORD& opcode)
+void Chip8Core::opcode_Fx18(const WORD& opcode)
 {
 	// ustaw wartosc sound timera = Vx (LD ST, Vx)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	sound_timer = registers[regx];
+	st->sound_timer = st->registers[regx];
 }
 
-void Chip8::opcode_Fx1E(const WORD& opcode)
+void Chip8Core::opcode_Fx1E(const WORD& opcode)
 {
 	// zwieksz wartosc rejestru I o wartosc rejestru Vx (ADD I, Vx)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	address_I += registers[regx];
+	st->address_I += st->registers[regx];
 }
 
-void Chip8::opcode_Fx29(const WORD& opcode)
+void Chip8Core::opcode_Fx29(const WORD& opcode)
 {
 	// zapisz do rejestru I adres sprite'a dla cyfry wskazywanej przez wartosc Vx (LD F, Vx)
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	address_I = digit_sprite_addr[registers[regx]];
+	st->address_I = digit_sprite_addr[st->registers[regx] & 0xF];
 }
 
-void Chip8::opcode_Fx33(const WORD& opcode)
+void Chip8Core::opcode_Fx33(const WORD& opcode)
 {
 	// zapisz Vx za pomoca reprezentacji BCD w pamieci pod adresami I, I+1, I+2
 
 	const int regx = (opcode & 0x0F00) >> 8;
 
-	game_memory[address_I] = registers[regx] / 100;
-	game_memory[address_I + 1] = (registers[regx] / 10) % 10;
-	game_memory[address_I + 2] = registers[regx] % 10;
+	CHIP8_CHECK(st->address_I + 3 <= ram_size, FAULT_MEMORY, st->address_I + 2);
+
+	if (st->registers[regx] > observed_bcd)
+		observed_bcd = st->registers[regx];
+
+	store_byte(st->address_I & (ram_size - 1), st->registers[regx] / 100);
+	store_byte((st->address_I + 1) & (ram_size - 1), (st->registers[regx] / 10) % 10);
+	store_byte((st->address_I + 2) & (ram_size - 1), st->registers[regx] % 10);
+
+	memory_written(st->address_I & (ram_size - 1));
+	memory_written((st->address_I + 1) & (ram_size - 1));
+	memory_written((st->address_I + 2) & (ram_size - 1));
 }
 
-void Chip8::opcode_Fx55(const WORD& opcode)
+void Chip8Core::opcode_Fx55(const WORD& opcode)
 {
 	// kopiuj wartosci od V0 do Vx lacznie do pamieci zaczynajac od adresu I
 
@@ -354,12 +398,14 @@ void Chip8::opcode_Fx55(const WORD& opcode)
 
 	for (int i = 0; i <= regx; i++)
 	{
-		address_I += i;
-		game_memory[address_I] = registers[i];
+		st->address_I += i;
+		CHIP8_CHECK(st->address_I < ram_size, FAULT_MEMORY, st->address_I);
+		store_byte(st->address_I & (ram_size - 1), st->registers[i]);
+		memory_written(st->address_I & (ram_size - 1));
 	}
 }
 
-void Chip8::opcode_Fx65(const WORD& opcode)
+void Chip8Core::opcode_Fx65(const WORD& opcode)
 {
 	// wypelnij rejestry od V0 do Vx lacznie wartosciami zaczynajac od adresu I
 
@@ -367,7 +413,8 @@ void Chip8::opcode_Fx65(const WORD& opcode)
 
 	for (int i = 0; i <= regx; i++)
 	{
-		address_I += i;
-		registers[i] = game_memory[address_I];
+		st->address_I += i;
+		CHIP8_CHECK(st->address_I < ram_size, FAULT_MEMORY, st->address_I);
+		st->registers[i] = load_byte(st->address_I & (ram_size - 1));
 	}
 }
@@ -0,0 +1,159 @@
+#include "chip8core.h"
+#include "chip8_log.h"
+#include "romfile.h"
+#include "rombundle.h"
+#include <cinttypes> // PRIx64
+#include <cstdio>
+#include <cstdlib> // strtoul
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// pakuje wiele gier do jednej paczki *.c8b (patrz rombundle.h) albo wypisuje
+// zawartosc paczki. Profil dziwactw kazdej gry jest ustalany przez krotkie
+// uruchomienie z naciskanymi po kolei klawiszami
+
+static void usage()
+{
+	cerr << "Usage: chip8_pack OUT.c8b [options] ROM...\n"
+		"       chip8_pack --list BUNDLE.c8b\n"
+		"  --files LIST   read ROM paths from LIST, one per line (- = stdin)\n"
+		"  --frames N     frames to run each game for the quirk profile (default 600, 0 = skip)\n";
+}
+
+// nazwa gry w paczce: nazwa pliku bez katalogu i bez rozszerzenia .ch8
+static string rom_name(const string& path)
+{
+	const size_t slash = path.find_last_of("/\\");
+	string name = slash == string::npos ? path : path.substr(slash + 1);
+
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".ch8") == 0)
+		name.resize(name.size() - 4);
+
+	return name;
+}
+
+static unsigned int quirk_profile(const vector<BYTE>& rom, unsigned long frames)
+{
+	Chip8Core core;
+
+	if (!core.load_rom(rom.empty() ? nullptr : &rom[0], rom.size()))
+		return 0;
+
+	for (unsigned long f = 0; f < frames; f++)
+	{
+		// kazdy klawisz po kolei przez 8 klatek, zeby przejsc ekrany tytulowe
+		core.set_keys(static_cast<WORD>(1 << (f / 8 % Chip8Core::keys_number)));
+		core.run_frame();
+	}
+
+	static Chip8Analysis analysis;
+	core.export_analysis(analysis);
+
+	return analysis.quirks;
+}
+
+static int list_bundle(const string& path)
+{
+	RomBundle bundle;
+
+	if (!bundle.open(path))
+	{
+		cerr << "Can't read ROM bundle " << path << endl;
+		return -1;
+	}
+
+	for (size_t i = 0; i < bundle.size(); i++)
+	{
+		const BundleEntry& e = bundle.entry(i);
+		printf("%016" PRIx64 " %5u  quirks 0x%02X  %s\n", e.hash, e.length, e.quirks, bundle.name(e));
+	}
+
+	printf("%u games\n", static_cast<unsigned int>(bundle.size()));
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 3 && string(argv[1]) == "--list")
+		return list_bundle(argv[2]);
+
+	string out_path;
+	vector<string> paths;
+	unsigned long frames = 600;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--frames" && i + 1 < argc)
+			frames = strtoul(argv[++i], nullptr, 0);
+		else if (arg == "--files" && i + 1 < argc)
+		{
+			const string list = argv[++i];
+			ifstream file(list);
+			istream& in = list == "-" ? cin : file;
+
+			if (list != "-" && !file)
+			{
+				cerr << "Can't read " << list << endl;
+				return -1;
+			}
+
+			for (string line; getline(in, line); )
+			{
+				if (!line.empty() && line[line.size() - 1] == '\r')
+					line.resize(line.size() - 1);
+
+				if (!line.empty())
+					paths.push_back(line);
+			}
+		}
+		else if (arg[0] == '-')
+		{
+			usage();
+			return -1;
+		}
+		else if (out_path.empty())
+			out_path = arg;
+		else
+			paths.push_back(arg);
+	}
+
+	if (out_path.empty())
+	{
+		usage();
+		return -1;
+	}
+
+	// gry sa uruchamiane tylko dla profilu, ich ostrzezenia nikogo nie interesuja
+	log_set_level(LOG_OFF);
+
+	vector<BundleItem> items(paths.size());
+
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		if (!read_rom_file(paths[i], items[i].data))
+		{
+			cerr << "Can't read " << paths[i] << endl;
+			return -1;
+		}
+
+		items[i].name = rom_name(paths[i]);
+		items[i].quirks = frames ? quirk_profile(items[i].data, frames) : 0;
+	}
+
+	if (!RomBundle::write(out_path, items))
+	{
+		cerr << "Can't write " << out_path << " (duplicate game names?)\n";
+		return -1;
+	}
+
+	cout << "Packed " << items.size() << " games into " << out_path << ".\n";
+
+	return 0;
+}
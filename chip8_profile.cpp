@@ -0,0 +1,194 @@
+#include "chip8_profile.h"
+#include <algorithm> // sort, min
+#include <cstdio>
+#include <cstring> // memset
+
+using namespace std;
+
+// profil blokow kodu. Blok konczy sie, gdy PC po instrukcji (albo superinstrukcji)
+// nie wskazuje kolejnego slowa: skok, wywolanie, powrot albo pominiecie.
+// Czas jest odczytywany tylko na granicach blokow
+
+void Chip8Core::set_profile(Chip8Profile* p)
+{
+	profile = p;
+	profile_len = 0;
+}
+
+void Chip8Core::profile_begin()
+{
+	profile_block = st->program_counter & (ram_size - 1);
+	profile_len = 0;
+	profile_start = Chip8Profile::ticks();
+}
+
+void Chip8Core::profile_step(WORD pc, unsigned int executed)
+{
+	profile_len += executed;
+
+	if (st->program_counter == static_cast<WORD>(pc + 2 * executed))
+		return;
+
+	profile_end();
+	profile_begin();
+}
+
+void Chip8Core::profile_end()
+{
+	if (profile_len)
+		profile->add_block(profile_block, Chip8Profile::ticks() - profile_start, profile_len);
+
+	profile_len = 0;
+}
+
+unsigned int Chip8Core::run_cycles_profiled(unsigned int n)
+{
+	const unsigned int requested = n;
+	stats.instructions += n;
+
+	profile_begin();
+
+	while (n)
+	{
+		const WORD pc = st->program_counter & (ram_size - 1);
+		unsigned int executed = 1;
+
+		if (fusion_enabled)
+		{
+			BYTE kind = fusion[pc];
+
+			if (kind == FUSE_UNKNOWN)
+				kind = analyze_fusion(pc);
+
+			if (kind != FUSE_NONE && fusion_len[pc] <= n)
+				executed = exec_fused(pc, kind);
+			else
+				decode_opcode(fetch_opcode());
+		}
+		else
+			decode_opcode(fetch_opcode());
+
+		n -= executed;
+		profile_step(pc, executed);
+	}
+
+	profile_end();
+
+	return requested;
+}
+
+Chip8Profile::Chip8Profile()
+	: block_ticks(Chip8Core::ram_size), block_runs(Chip8Core::ram_size), block_instructions(Chip8Core::ram_size)
+{
+	clear();
+}
+
+void Chip8Profile::clear()
+{
+	fill(block_ticks.begin(), block_ticks.end(), 0);
+	fill(block_runs.begin(), block_runs.end(), 0);
+	fill(block_instructions.begin(), block_instructions.end(), 0);
+	memset(sub_ticks, 0, sizeof(sub_ticks));
+	memset(sub_calls, 0, sizeof(sub_calls));
+}
+
+const char* Chip8Profile::units()
+{
+#ifdef CHIP8_HAVE_RDTSC
+	return "TSC ticks";
+#else
+	return "ns";
+#endif
+}
+
+const char* Chip8Profile::subsystem_name(int sub)
+{
+	static const char* const names[SUB_KINDS] = { "run_frame", "draw", "read_keys", "sdl_events", "capture", "idle" };
+
+	return sub >= 0 && sub < SUB_KINDS ? names[sub] : "?";
+}
+
+bool Chip8Profile::write_collapsed(const std::string& path) const
+{
+	FILE* f = fopen(path.c_str(), "w");
+
+	if (!f)
+		return false;
+
+	unsigned long long blocks = 0;
+
+	for (int addr = 0; addr < Chip8Core::ram_size; addr++)
+	{
+		if (!block_ticks[addr])
+			continue;
+
+		fprintf(f, "chip8;run_frame;0x%03X %llu\n", addr, block_ticks[addr]);
+		blocks += block_ticks[addr];
+	}
+
+	// reszta czasu klatki poza blokami (timery, wywolania, pomiar)
+	if (sub_ticks[SUB_RUN_FRAME] > blocks)
+		fprintf(f, "chip8;run_frame %llu\n", sub_ticks[SUB_RUN_FRAME] - blocks);
+
+	for (int sub = SUB_RUN_FRAME + 1; sub < SUB_KINDS; sub++)
+	{
+		if (sub_ticks[sub])
+			fprintf(f, "chip8;%s %llu\n", subsystem_name(sub), sub_ticks[sub]);
+	}
+
+	return fclose(f) == 0;
+}
+
+std::string Chip8Profile::report(unsigned int top_blocks) const
+{
+	string out;
+	char buf[160];
+
+	unsigned long long total = 0;
+
+	for (int sub = 0; sub < SUB_KINDS; sub++)
+		total += sub_ticks[sub];
+
+	snprintf(buf, sizeof(buf), "host time (%s):", units());
+	out += buf;
+
+	for (int sub = 0; sub < SUB_KINDS; sub++)
+	{
+		if (!sub_calls[sub])
+			continue;
+
+		snprintf(buf, sizeof(buf), "\n  %-12s %5.1f%%  %12.0f per call", subsystem_name(sub),
+			total ? 100.0 * sub_ticks[sub] / total : 0.0, static_cast<double>(sub_ticks[sub]) / sub_calls[sub]);
+		out += buf;
+	}
+
+	vector<int> order;
+	unsigned long long blocks = 0;
+
+	for (int addr = 0; addr < Chip8Core::ram_size; addr++)
+	{
+		if (block_ticks[addr])
+		{
+			order.push_back(addr);
+			blocks += block_ticks[addr];
+		}
+	}
+
+	const size_t shown = min<size_t>(top_blocks, order.size());
+	partial_sort(order.begin(), order.begin() + shown, order.end(),
+		[this](int a, int b) { return block_ticks[a] > block_ticks[b]; });
+
+	if (shown)
+		out += "\nhottest blocks:";
+
+	for (size_t i = 0; i < shown; i++)
+	{
+		const int a = order[i];
+		snprintf(buf, sizeof(buf), "\n  0x%03X %5.1f%%  %llu runs, %.1f instructions/run, %.1f per instruction", a,
+			100.0 * block_ticks[a] / blocks, block_runs[a], static_cast<double>(block_instructions[a]) / block_runs[a],
+			static_cast<double>(block_ticks[a]) / block_instructions[a]);
+		out += buf;
+	}
+
+	return out;
+}
@@ -0,0 +1,103 @@
+#ifndef CHIP8_PROFILE_H
+#define CHIP8_PROFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chip8core.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <intrin.h> // __rdtsc
+	#define CHIP8_HAVE_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h> // __rdtsc
+	#define CHIP8_HAVE_RDTSC
+#else
+	#include <chrono>
+#endif
+
+// profil czasu hosta: ile taktow procesora (rdtsc, a bez niego nanosekund)
+// zabiera kazdy blok emulowanego kodu - ciag instrukcji od skoku do skoku,
+// liczony od adresu pierwszej instrukcji - oraz kazdy podsystem frontendu.
+// Rdzen mierzy bloki tylko z podpietym profilem (set_profile()), w osobnej
+// petli, wiec zwykle wykonanie nic nie traci
+class Chip8Profile
+{
+public:
+	enum Subsystem
+	{
+		SUB_RUN_FRAME = 0,	// cala emulacja klatki (bloki sa jej czescia)
+		SUB_DRAW,
+		SUB_READ_KEYS,
+		SUB_SDL_EVENTS,
+		SUB_CAPTURE,
+		SUB_IDLE,			// czekanie na nastepna klatke
+		SUB_KINDS
+	};
+
+	std::vector<unsigned long long>	block_ticks;
+	std::vector<unsigned long long>	block_runs;
+	std::vector<unsigned long long>	block_instructions;
+	unsigned long long				sub_ticks[SUB_KINDS];
+	unsigned long long				sub_calls[SUB_KINDS];
+
+	Chip8Profile();
+
+	void clear();
+
+	static uint64_t ticks()
+	{
+#ifdef CHIP8_HAVE_RDTSC
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+
+	static const char* units();
+	static const char* subsystem_name(int sub);
+
+	void add_block(WORD addr, uint64_t t, unsigned int instructions)
+	{
+		block_ticks[addr] += t;
+		block_runs[addr]++;
+		block_instructions[addr] += instructions;
+	}
+
+	void add(int sub, uint64_t t)
+	{
+		sub_ticks[sub] += t;
+		sub_calls[sub]++;
+	}
+
+	// plik "collapsed stacks" (jedna linia: ramki;rozdzielone;srednikiem wartosc),
+	// np. dla flamegraph.pl albo speedscope
+	bool write_collapsed(const std::string& path) const;
+	// krotkie podsumowanie: podsystemy i najdrozsze bloki
+	std::string report(unsigned int top_blocks = 10) const;
+};
+
+// mierzy czas do konca zakresu; z p == nullptr nic nie robi
+class ProfileScope
+{
+private:
+	Chip8Profile*		profile;
+	int					sub;
+	uint64_t			start;
+
+public:
+	ProfileScope(Chip8Profile* p, int subsystem)
+		: profile(p), sub(subsystem), start(p ? Chip8Profile::ticks() : 0) {}
+
+	~ProfileScope()
+	{
+		if (profile)
+			profile->add(sub, Chip8Profile::ticks() - start);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#endif
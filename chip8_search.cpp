@@ -0,0 +1,182 @@
+#include "chip8core.h"
+#include "config.h"
+#include "movie.h"
+#include "romfile.h"
+#include "search.h"
+#include <algorithm> // find
+#include <cstdlib> // strtoul, strtoull
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// automatyczne szukanie wejscia, ktore doprowadza gre do zadanego miejsca (do
+// testow): wynik to film wejscia od resetu, do odtworzenia w chip8_headless
+// albo w emulatorze z tymi samymi ustawieniami
+
+static void usage()
+{
+	cerr << "Usage: chip8_search [settings.ini] GOAL... [options]\n"
+		"Goals (any of them ends the search):\n"
+		"  --pc ADDR      the program reaches address ADDR\n"
+		"  --score N      the program converts a value >= N to BCD (Fx33)\n"
+		"  --screen HASH  the frame hash equals HASH (see chip8_headless --hash-out)\n"
+		"Options:\n"
+		"  --start MOVIE  search from the state after playing MOVIE from reset\n"
+		"  --keys LIST    keys to try, e.g. 456 (default: all); one key or none per step\n"
+		"  --step N       frames each choice is held (default 1)\n"
+		"  --depth N      longest input in frames after the start (default 600)\n"
+		"  --memory MB    memory limit (default 1024)\n"
+		"  --jobs N       worker threads (default: all cores)\n"
+		"  --best         best-first: highest BCD value first instead of breadth-first\n"
+		"  --out FILE     where to write the input movie (default search.movie)\n";
+}
+
+int main(int argc, char *argv[])
+{
+	string cfg_path = "../settings.ini";
+	string start_path, out_path = "search.movie", keys = "0123456789abcdef";
+	SearchOptions opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--pc" && i + 1 < argc)
+			opt.goal.pc = static_cast<int>(strtoul(argv[++i], nullptr, 0) & (Chip8Core::ram_size - 1));
+		else if (arg == "--score" && i + 1 < argc)
+			opt.goal.score = static_cast<int>(strtoul(argv[++i], nullptr, 0));
+		else if (arg == "--screen" && i + 1 < argc)
+		{
+			opt.goal.screen = true;
+			opt.goal.screen_hash = strtoull(argv[++i], nullptr, 16);
+		}
+		else if (arg == "--start" && i + 1 < argc)
+			start_path = argv[++i];
+		else if (arg == "--keys" && i + 1 < argc)
+			keys = argv[++i];
+		else if (arg == "--step" && i + 1 < argc)
+			opt.frames_per_step = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+		else if (arg == "--depth" && i + 1 < argc)
+			opt.max_depth = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+		else if (arg == "--memory" && i + 1 < argc)
+			opt.memory_limit = static_cast<size_t>(strtoul(argv[++i], nullptr, 0)) << 20;
+		else if (arg == "--jobs" && i + 1 < argc)
+			opt.jobs = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+		else if (arg == "--best")
+			opt.best_first = true;
+		else if (arg == "--out" && i + 1 < argc)
+			out_path = argv[++i];
+		else if (arg[0] != '-')
+			cfg_path = arg;
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+
+	// "brak klawisza" i kazdy klawisz z listy osobno
+	opt.actions.push_back(0);
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		const char c = keys[i];
+		int k = -1;
+
+		if (c >= '0' && c <= '9')
+			k = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			k = c - 'a' + 0xA;
+		else if (c >= 'A' && c <= 'F')
+			k = c - 'A' + 0xA;
+
+		if (k < 0)
+		{
+			usage();
+			return -1;
+		}
+
+		const WORD mask = static_cast<WORD>(1 << k);
+
+		if (find(opt.actions.begin(), opt.actions.end(), mask) == opt.actions.end())
+			opt.actions.push_back(mask);
+	}
+
+	if (!opt.goal.any() || opt.frames_per_step == 0 || opt.memory_limit == 0)
+	{
+		usage();
+		return -1;
+	}
+
+	Chip8Config cfg;
+
+	if (!load_config(cfg_path, cfg))
+		cerr << "Can't read settings file " << cfg_path << ", using defaults.\n";
+
+	log_set_level(cfg.log_level);
+
+	// tak samo jak chip8_headless, zeby film dalo sie tam odtworzyc
+	Chip8Core core;
+	core.set_cycles_per_frame(cfg.cycles_per_frame);
+	core.set_timing(cfg.timing);
+	core.set_fusion(cfg.fusion);
+
+	if (cfg.seed)
+		core.set_seed(cfg.seed);
+
+	if (!load_rom_file(cfg.rom_path, core))
+	{
+		cerr << "Game file not loaded! Quitting...\n";
+		return -1;
+	}
+
+	InputMovie movie;
+
+	if (!start_path.empty())
+	{
+		if (!movie.load(start_path))
+		{
+			cerr << "Can't read input movie " << start_path << endl;
+			return -1;
+		}
+
+		for (size_t f = 0; f < movie.size(); f++)
+		{
+			core.set_keys(movie.at(f));
+			core.run_frame();
+		}
+	}
+
+	StateSearch search;
+	const bool found = search.run(core, opt);
+	log_stop();
+
+	cerr << search.report() << endl;
+
+	if (!found)
+	{
+		if (search.complete())
+			cout << "Goal not reachable within " << opt.max_depth << " frames.\n";
+		else
+			cout << "Goal not found; the memory limit cut the search short (try --memory, --step or --keys).\n";
+
+		return 1;
+	}
+
+	const vector<WORD>& path = search.path();
+
+	for (size_t f = 0; f < path.size(); f++)
+		movie.push(path[f]);
+
+	if (!movie.save(out_path))
+	{
+		cerr << "Can't write " << out_path << endl;
+		return -1;
+	}
+
+	cout << "Goal reached after " << path.size() << " frames (" << movie.size() << " from reset); input movie written to "
+		<< out_path << ".\n";
+
+	return 0;
+}
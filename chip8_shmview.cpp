@@ -0,0 +1,126 @@
+#include "shmexport.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // strtoul
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// przykladowy podglad stanu publikowanego przez emulator (shm_export / --shm):
+// podlacza sie do segmentu po nazwie i rysuje obraz oraz rejestry w terminalu
+
+static void usage()
+{
+	cerr << "Usage: chip8_shmview NAME [options]\n"
+		"  --once         print one frame and exit\n"
+		"  --fps N        refresh rate (default 10)\n";
+}
+
+static void print_state(const Chip8State& s, uint64_t frame)
+{
+	string out;
+	out.reserve((Chip8State::width + 1) * Chip8State::height / 2 * 3 + 256);
+
+	// dwa wiersze obrazu na jeden wiersz tekstu (polowki bloku)
+	for (int y = 0; y < Chip8State::height; y += 2)
+	{
+		for (int x = 0; x < Chip8State::width; x++)
+		{
+			const bool top = s.screen[y][x] != 0;
+			const bool bottom = s.screen[y + 1][x] != 0;
+
+			out += top ? (bottom ? "\xE2\x96\x88" : "\xE2\x96\x80") : (bottom ? "\xE2\x96\x84" : " ");
+		}
+
+		out += '\n';
+	}
+
+	char line[160];
+	snprintf(line, sizeof(line), "frame %llu  PC %03X  I %03X  SP %u  DT %u  ST %u\n",
+		static_cast<unsigned long long>(frame), s.program_counter, s.address_I, s.stack_ptr, s.delay_timer, s.sound_timer);
+	out += line;
+
+	for (int i = 0; i < Chip8State::reg_size; i++)
+	{
+		snprintf(line, sizeof(line), "V%X=%02X%c", i, s.registers[i], i + 1 < Chip8State::reg_size ? ' ' : '\n');
+		out += line;
+	}
+
+	fputs(out.c_str(), stdout);
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	string name;
+	bool once = false;
+	unsigned long fps = 10;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--fps" && i + 1 < argc)
+			fps = strtoul(argv[++i], nullptr, 0);
+		else if (arg == "--once")
+			once = true;
+		else if (arg[0] != '-' && name.empty())
+			name = arg;
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+
+	if (name.empty() || !fps)
+	{
+		usage();
+		return -1;
+	}
+
+	SharedExport shm;
+
+	if (!shm.attach(name))
+	{
+		cerr << "Can't attach to shared memory segment " << name << endl;
+		return -1;
+	}
+
+	const auto period = chrono::microseconds(1000000 / fps);
+	const auto timeout = chrono::seconds(5);
+	auto last_frame = chrono::steady_clock::now();
+	uint64_t shown = ~0ULL;
+	Chip8State s;
+
+	for (;;)
+	{
+		uint64_t frame;
+
+		if (shm.read(s, frame))
+		{
+			last_frame = chrono::steady_clock::now();
+
+			if (frame != shown)
+			{
+				if (!once)
+					fputs("\x1B[H\x1B[2J", stdout);
+
+				print_state(s, frame);
+				shown = frame;
+
+				if (once)
+					return 0;
+			}
+		}
+		else if (chrono::steady_clock::now() - last_frame > timeout)
+		{
+			cerr << "No new frames from " << name << " for 5 s\n";
+			return 1;
+		}
+
+		this_thread::sleep_for(period);
+	}
+}
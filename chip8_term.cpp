@@ -0,0 +1,379 @@
+#include "chip8core.h"
+#include "config.h"
+#include "romfile.h"
+#include "runahead.h"
+#include "session.h"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib> // strtoul
+#include <ctime> // time
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <conio.h> // _kbhit, _getch
+#else
+	#include <poll.h>
+	#include <termios.h>
+	#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+// emulator w terminalu (np. przez SSH, bez ekranu): obraz 64x32 rysowany
+// znakami Braille'a (2x4 piksele na znak, czyli 32x8 znakow), klawisze
+// z stdin w trybie surowym. Wysylane sa tylko znaki zmienione od poprzedniej
+// klatki, wiec przy malo ruchliwych grach to kilkadziesiat bajtow na klatke
+
+static const int	cell_w			= 2;
+static const int	cell_h			= 4;
+static const int	cols			= Chip8Core::width / cell_w;
+static const int	rows			= Chip8Core::height / cell_h;
+static const int	top				= 1;	// pierwszy wiersz terminala z obrazem (od 1)
+
+static volatile sig_atomic_t quit_signal = 0;
+
+static void on_signal(int)
+{
+	quit_signal = 1;
+}
+
+static void usage()
+{
+	cerr << "Usage: chip8_term [settings.ini] [options]\n"
+		"  --frames N     stop after N frames (default: run until Esc or q)\n"
+		"  --hold N       frames a key stays pressed after its last repeat (default 15)\n"
+		"  --timing T     timing model: fixed (cycles_per_frame) or vip\n";
+}
+
+// terminal nie zglasza puszczenia klawisza - klawisz jest wcisniety przez
+// hold klatek od ostatniego znaku (autorepeat przedluza wcisniecie)
+static int key_index(int c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 0xA;
+
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 0xA;
+
+	return -1;
+}
+
+class Terminal
+{
+private:
+#ifdef _WIN32
+	DWORD				out_mode		= 0;
+	UINT				out_cp			= 0;
+#else
+	struct termios		saved;
+	bool				raw				= false;
+	bool				input_eof		= false;
+#endif
+
+public:
+	void open()
+	{
+#ifdef _WIN32
+		HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+
+		GetConsoleMode(out, &out_mode);
+		SetConsoleMode(out, out_mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+		out_cp = GetConsoleOutputCP();
+		SetConsoleOutputCP(CP_UTF8);
+#else
+		if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved) == 0)
+		{
+			struct termios t = saved;
+
+			// bez echa, bez buforowania linii i bez sygnalow z klawiatury (Ctrl+C to znak)
+			t.c_iflag &= ~(ICRNL | IXON | ISTRIP | INLCR | IGNCR);
+			t.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+			t.c_cc[VMIN] = 0;
+			t.c_cc[VTIME] = 0;
+
+			raw = tcsetattr(STDIN_FILENO, TCSANOW, &t) == 0;
+		}
+#endif
+		// drugi ekran terminala, ukryty kursor
+		fputs("\x1B[?1049h\x1B[?25l\x1B[2J", stdout);
+		fflush(stdout);
+	}
+
+	void close()
+	{
+		fputs("\x1B[?25h\x1B[?1049l", stdout);
+		fflush(stdout);
+
+#ifdef _WIN32
+		SetConsoleMode(GetStdHandle(STD_OUTPUT_HANDLE), out_mode);
+		SetConsoleOutputCP(out_cp);
+#else
+		if (raw)
+			tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+
+		raw = false;
+#endif
+	}
+
+	// nastepny znak z klawiatury bez czekania; -1 = brak
+	int read_char()
+	{
+#ifdef _WIN32
+		return _kbhit() ? _getch() : -1;
+#else
+		if (input_eof)
+			return -1;
+
+		struct pollfd p;
+		p.fd = STDIN_FILENO;
+		p.events = POLLIN;
+		p.revents = 0;
+
+		if (poll(&p, 1, 0) <= 0)
+			return -1;
+
+		unsigned char c;
+		const ssize_t n = ::read(STDIN_FILENO, &c, 1);
+
+		// koniec potoku (stdin nie z terminala) - dalej bez klawiatury
+		if (n == 0 && !raw)
+			input_eof = true;
+
+		return n == 1 ? c : -1;
+#endif
+	}
+};
+
+// obraz jako znaki Braille'a; out dostaje tylko sekwencje dla zmienionych znakow
+class BrailleScreen
+{
+private:
+	WORD				shown[rows][cols];	// > 0xFF = jeszcze nie narysowany
+
+public:
+	BrailleScreen() { invalidate(); }
+
+	void invalidate()
+	{
+		for (int r = 0; r < rows; r++)
+			for (int c = 0; c < cols; c++)
+				shown[r][c] = 0x100;
+	}
+
+	void render(const BYTE* fb, string& out)
+	{
+		// bity kropek U+2800: 1 4 / 2 5 / 3 6 / 7 8
+		static const BYTE dot[cell_h][cell_w] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+
+		for (int r = 0; r < rows; r++)
+		{
+			int cursor = -1;	// kolumna kursora w tym wierszu, -1 = nieznana
+
+			for (int c = 0; c < cols; c++)
+			{
+				BYTE bits = 0;
+
+				for (int dy = 0; dy < cell_h; dy++)
+				{
+					const BYTE* line = fb + (r * cell_h + dy) * Chip8Core::pitch() + c * cell_w;
+
+					if (line[0])
+						bits |= dot[dy][0];
+
+					if (line[1])
+						bits |= dot[dy][1];
+				}
+
+				if (shown[r][c] == bits)
+					continue;
+
+				shown[r][c] = bits;
+
+				if (cursor != c)
+				{
+					char move[16];
+					snprintf(move, sizeof(move), "\x1B[%d;%dH", top + r, c + 1);
+					out += move;
+				}
+
+				// pusty znak jako spacja - 1 bajt zamiast 3
+				if (!bits)
+					out += ' ';
+				else
+				{
+					out += static_cast<char>(0xE2);
+					out += static_cast<char>(0xA0 | (bits >> 6));
+					out += static_cast<char>(0x80 | (bits & 0x3F));
+				}
+
+				cursor = c + 1;
+			}
+		}
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	string cfg_path = "../settings.ini";
+	string timing_name;
+	unsigned long frames = 0;
+	unsigned int hold = 15;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const string arg = argv[i];
+
+		if (arg == "--frames" && i + 1 < argc)
+			frames = strtoul(argv[++i], nullptr, 0);
+		else if (arg == "--hold" && i + 1 < argc)
+			hold = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 0));
+		else if (arg == "--timing" && i + 1 < argc)
+			timing_name = argv[++i];
+		else if (arg[0] != '-')
+			cfg_path = arg;
+		else
+		{
+			usage();
+			return -1;
+		}
+	}
+
+	Chip8Config cfg;
+
+	if (!load_config(cfg_path, cfg))
+		cerr << "Can't read settings file " << cfg_path << ", using defaults.\n";
+
+	if (!timing_name.empty() && !parse_timing(timing_name, cfg.timing))
+	{
+		usage();
+		return -1;
+	}
+
+	log_set_level(cfg.log_level);
+
+	Chip8Core core;
+	core.set_cycles_per_frame(cfg.cycles_per_frame);
+	core.set_timing(cfg.timing);
+	core.set_fusion(cfg.fusion);
+	core.set_seed(cfg.seed ? cfg.seed : static_cast<unsigned int>(time(nullptr)));
+
+	if (!load_rom_file(cfg.rom_path, core))
+	{
+		cerr << "Game file not loaded! Quitting...\n";
+		return -1;
+	}
+
+	RunAhead ahead(cfg.runahead);
+
+	SessionFile session;
+	bool resumed = false;
+	session.set_interval(cfg.session_checkpoint);
+
+	if (!cfg.session_file.empty())
+		session.open(cfg.session_file, core, resumed);
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	Terminal term;
+	term.open();
+
+	BrailleScreen screen;
+	string out;
+	out.reserve(rows * cols * 12 + 64);
+
+	// pomoc pod obrazem, raz
+	char help[64];
+	snprintf(help, sizeof(help), "\x1B[%d;1Hkeys 0-9 a-f, Esc or q quits", top + rows + 1);
+	fputs(help, stdout);
+
+	unsigned int key_left[Chip8Core::keys_number] = {};
+	unsigned long long bytes = 0;
+	unsigned long frame = 0;
+	bool alive = true;
+
+	const auto period = microseconds(1000000 / 60);
+	auto next = steady_clock::now();
+
+	while (alive && !quit_signal && (!frames || frame < frames))
+	{
+		// wszystkie znaki, ktore przyszly od poprzedniej klatki
+		for (int c; (c = term.read_char()) >= 0; )
+		{
+			if (c == 'q' || c == 'Q' || c == 0x03)
+				alive = false;
+			else if (c == 0x1B)
+			{
+				// sam Esc konczy gre, sekwencje klawiszy specjalnych (strzalki itp.) sa pomijane
+				const int n = term.read_char();
+
+				if (n < 0)
+					alive = false;
+				else
+					while (term.read_char() >= 0) {}
+			}
+			else
+			{
+				const int k = key_index(c);
+
+				if (k >= 0)
+					key_left[k] = hold;
+			}
+		}
+
+		WORD mask = 0;
+
+		for (int k = 0; k < Chip8Core::keys_number; k++)
+		{
+			if (key_left[k])
+			{
+				mask |= 1 << k;
+				key_left[k]--;
+			}
+		}
+
+		core.set_keys(mask);
+		ahead.run_frame(core);
+		session.frame_done();
+		frame++;
+
+		out.clear();
+		screen.render(ahead.framebuffer(core), out);
+
+		if (!out.empty())
+		{
+			fwrite(out.data(), 1, out.size(), stdout);
+			fflush(stdout);
+			bytes += out.size();
+		}
+
+		// wolny terminal nie spowalnia gry, ale po dluzszym zastoju nie nadrabiamy klatek
+		next += period;
+		const auto now = steady_clock::now();
+
+		if (next < now - milliseconds(100))
+			next = now;
+		else
+			this_thread::sleep_until(next);
+	}
+
+	term.close();
+	session.close();
+	log_stop();
+
+	if (resumed)
+		cout << "Resumed session from frame " << session.frame_number() - frame << ".\n";
+
+	cout << frame << " frames, " << bytes << " bytes of output (" << (frame ? bytes / frame : 0) << " bytes/frame)\n";
+
+	return 0;
+}
@@ -0,0 +1,151 @@
+#include "chip8core.h"
+
+// model czasu COSMAC VIP. Kazda instrukcja kosztuje tyle cykli maszynowych
+// (8 taktow zegara 1.7609 MHz), ile w przyblizeniu zajmuje jej procedura
+// w oryginalnym interpreterze, lacznie z pobraniem i dekodowaniem. Klatka
+// 60 Hz dostaje staly przydzial cykli; nadwyzka przechodzi na nastepna klatke
+
+int Chip8Core::vip_cost(WORD opcode, bool skipped) const
+{
+	const int x = (opcode & 0x0F00) >> 8;
+	const int skip = skipped ? 4 : 0;
+
+	switch (opcode & 0xF000)
+	{
+	case 0x0000:
+		if (opcode == 0x00E0)
+			return 684; // czyszczenie calych 256 bajtow pamieci obrazu
+		return 22;
+	case 0x1000:
+		return 22;
+	case 0x2000:
+		return 32;
+	case 0x3000:
+	case 0x4000:
+		return 20 + skip;
+	case 0x5000:
+	case 0x9000:
+		return 28 + skip;
+	case 0x6000:
+		return 12;
+	case 0x7000:
+		return 20;
+	case 0x8000:
+		return 88; // operacje arytmetyczne ida przez samomodyfikujacy sie kod
+	case 0xA000:
+		return 24;
+	case 0xB000:
+		return 44;
+	case 0xC000:
+		return 72;
+	case 0xD000:
+	{
+		// kazdy wiersz sprite'a jest przesuwany o Vx mod 8 bitow i XOR-owany z dwoma bajtami obrazu
+		const int rows = opcode & 0x000F;
+		return 170 + rows * (46 + 4 * (st->registers[x] & 7));
+	}
+	case 0xE000:
+		return 28 + skip;
+	case 0xF000:
+		switch (opcode & 0x00FF)
+		{
+		case 0x07: return 20;
+		case 0x0A: return 38; // jedno sprawdzenie klawiatury
+		case 0x15: return 20;
+		case 0x18: return 20;
+		case 0x1E: return 32;
+		case 0x29: return 40;
+		case 0x33:
+		{
+			// BCD liczone odejmowaniem, wiec koszt rosnie z suma cyfr
+			const int v = st->registers[x];
+			return 80 + 8 * (v / 100 + (v / 10) % 10 + v % 10);
+		}
+		case 0x55:
+		case 0x65:
+			return 28 + 28 * (x + 1);
+		default:
+			return 22;
+		}
+	default:
+		return 22;
+	}
+}
+
+void Chip8Core::exec_vip()
+{
+	const WORD pc = st->program_counter;
+	const WORD opcode = fetch_opcode();
+
+	decode_opcode(opcode);
+
+	st->vip_cycles -= vip_cost(opcode, st->program_counter == static_cast<WORD>(pc + 2 * sizeof(WORD)));
+
+	// DRW czeka na przerwanie obrazu, wiec reszta klatki przepada
+	if ((opcode & 0xF000) == 0xD000 && st->vip_cycles > 0)
+		st->vip_cycles = 0;
+
+	stats.instructions++;
+	frame_cycle++;
+}
+
+bool Chip8Core::run_frame_vip()
+{
+	// nowa klatka: dokladamy przydzial cykli (ewentualny dlug z poprzedniej zostaje)
+	if (!vip_frame_open)
+	{
+		st->vip_cycles += vip_budget;
+		vip_frame_open = true;
+	}
+
+	stop = STOP_NONE;
+
+	if (profile)
+		profile_begin();
+
+	while (st->vip_cycles > 0)
+	{
+		if (debugging())
+		{
+			const WORD pc = st->program_counter & (ram_size - 1);
+
+			if (breakpoints[pc >> 6] >> (pc & 63) & 1)
+			{
+				stop = STOP_BREAKPOINT;
+				stop_address = pc;
+
+				if (profile)
+					profile_end();
+
+				return false;
+			}
+		}
+
+		if (profile)
+		{
+			const WORD pc = st->program_counter;
+			exec_vip();
+			profile_step(pc, 1);
+		}
+		else
+			exec_vip();
+
+		// obserwowany adres zostal zapisany
+		if (stop != STOP_NONE)
+		{
+			if (profile)
+				profile_end();
+
+			return false;
+		}
+	}
+
+	if (profile)
+		profile_end();
+
+	vip_frame_open = false;
+	frame_cycle = 0;
+	decrement_timers();
+
+	return true;
+}
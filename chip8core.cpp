@@ -0,0 +1,573 @@
+#include "chip8core.h"
+#include "chip8_log.h"
+#include <cstring> // memset, memcpy
+
+using namespace std;
+
+Chip8Core::Chip8Core()
+{
+	own_image = new BYTE[ram_size];
+	pristine = own_image;
+
+	memset(own_image, 0, ram_size);
+	memset(&stats, 0, sizeof(stats));
+	memset(breakpoints, 0, sizeof(breakpoints));
+	memset(watchpoints, 0, sizeof(watchpoints));
+	init_digit_sprites();
+	invalidate_code();
+	reset();
+}
+
+Chip8Core::~Chip8Core()
+{
+	delete[] own_image;
+}
+
+bool Chip8Core::load_rom(const BYTE* data, size_t len)
+{
+	if (len > static_cast<size_t>(ram_size - game_start_addr))
+	{
+		loaded = false;
+		return false;
+	}
+
+	// wspolny obraz zostawiamy wlascicielowi, a czcionke bierzemy z niego
+	if (!own_image)
+	{
+		own_image = new BYTE[ram_size];
+		memcpy(own_image, pristine, game_start_addr);
+		pristine = own_image;
+	}
+
+	// obraz pamieci: czcionka zostaje, reszta to gra
+	memset(&own_image[game_start_addr], 0, ram_size - game_start_addr);
+	if (len)
+		memcpy(&own_image[game_start_addr], data, len);
+
+	// statystyki fuzji liczymy osobno dla kazdej gry
+	memset(&stats, 0, sizeof(stats));
+
+	loaded = true;
+	synced_pages = 0;
+	invalidate_code();
+	reset();
+
+	return true;
+}
+
+void Chip8Core::share_image(const Chip8Core& owner)
+{
+	if (&owner == this)
+		return;
+
+	delete[] own_image;
+	own_image = nullptr;
+	pristine = owner.pristine;
+	memcpy(digit_sprite_addr, owner.digit_sprite_addr, sizeof(digit_sprite_addr));
+
+	memset(&stats, 0, sizeof(stats));
+
+	loaded = owner.loaded;
+	synced_pages = 0;
+	invalidate_code();
+	reset();
+}
+
+void Chip8Core::reset()
+{
+	// pamiec gry wraca do obrazu (czcionka + ROM) bez kopiowania: wystarczy
+	// zapomniec strony zapisane przez program
+	const unsigned long long dirty = st->dirty_pages;
+
+	st->dirty_pages = 0;
+	synced_pages &= ~dirty;
+
+	// wyzerowanie rejestrow
+	memset(st->registers, 0, Chip8State::reg_size);
+
+	// wyzerowanie rejestru I
+	st->address_I = 0;
+
+	// ustawienie zmiennej program_counter na adres poczatku gry
+	st->program_counter = game_start_addr;
+	fault_kind = FAULT_NONE;
+
+	// czyscimy stos
+	memset(st->stack, 0, sizeof(st->stack));
+	st->stack_ptr = 0;
+
+	// czyscimy ekran
+	memset(st->screen, 0, sizeof(st->screen));
+
+	// resetujemy stan klawiatury
+	memset(st->key, 0, keys_number);
+
+	// zerujemy timery
+	st->delay_timer = 0;
+	st->sound_timer = 0;
+
+	st->rng_state = seed;
+	st->vip_cycles = 0;
+
+	frame_cycle = 0;
+	vip_frame_open = false;
+	invalidate_pages(dirty);
+}
+
+void Chip8Core::set_seed(unsigned int s)
+{
+	// xorshift nie moze startowac od zera
+	seed = s ? s : 1;
+	st->rng_state = seed;
+}
+
+void Chip8Core::step()
+{
+	decode_opcode(fetch_opcode());
+}
+
+unsigned int Chip8Core::run_cycles(unsigned int n)
+{
+	// z ustawionymi pulapkami wykonujemy wolniejsza, sprawdzajaca wersje
+	if (debugging())
+		return run_cycles_debug(n);
+
+	if (profile)
+		return run_cycles_profiled(n);
+
+	const unsigned int requested = n;
+	stats.instructions += n;
+
+	while (n)
+	{
+		if (fusion_enabled)
+		{
+			const WORD pc = st->program_counter & (ram_size - 1);
+			BYTE kind = fusion[pc];
+
+			if (kind == FUSE_UNKNOWN)
+				kind = analyze_fusion(pc);
+
+			// superinstrukcja tylko wtedy, gdy zmiesci sie w pozostalym limicie instrukcji
+			if (kind != FUSE_NONE && fusion_len[pc] <= n)
+			{
+				CHIP8_CHECK(st->program_counter == pc, FAULT_MEMORY, st->program_counter);
+				n -= exec_fused(pc, kind);
+				continue;
+			}
+		}
+
+		decode_opcode(fetch_opcode());
+		n--;
+	}
+
+	return requested;
+}
+
+bool Chip8Core::run_frame()
+{
+	if (timing == TIMING_VIP)
+		return run_frame_vip();
+
+	if (frame_cycle < cycles_per_frame)
+		frame_cycle += run_cycles(cycles_per_frame - frame_cycle);
+
+	if (frame_cycle < cycles_per_frame)
+		return false;
+
+	frame_cycle = 0;
+	decrement_timers();
+
+	return true;
+}
+
+void Chip8Core::load_state(const Chip8State& s)
+{
+	*st = s;
+	fault_kind = FAULT_NONE;
+	invalidate_code();
+
+	unsigned long long dirty = 0;
+
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		const size_t off = p * Chip8State::page_size;
+
+		if (memcmp(&st->game_memory[off], &pristine[off], Chip8State::page_size) != 0)
+			dirty |= 1ULL << p;
+	}
+
+	st->dirty_pages = dirty;
+	synced_pages = ~dirty & (~0ULL >> (64 - Chip8State::pages));
+}
+
+void Chip8Core::full_state(Chip8State& out) const
+{
+	out = *st;
+
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		const size_t off = p * Chip8State::page_size;
+
+		if (!(st->dirty_pages >> p & 1))
+			memcpy(&out.game_memory[off], &pristine[off], Chip8State::page_size);
+	}
+}
+
+void Chip8Core::sync_memory()
+{
+	const unsigned long long need = ~(st->dirty_pages | synced_pages) & (~0ULL >> (64 - Chip8State::pages));
+
+	if (!need)
+		return;
+
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		const size_t off = p * Chip8State::page_size;
+
+		if (need >> p & 1)
+			memcpy(&st->game_memory[off], &pristine[off], Chip8State::page_size);
+	}
+
+	synced_pages |= need;
+}
+
+void Chip8Core::copy_page(int p)
+{
+	const size_t off = p * Chip8State::page_size;
+
+	memcpy(&st->game_memory[off], &pristine[off], Chip8State::page_size);
+	st->dirty_pages |= 1ULL << p;
+}
+
+void Chip8Core::attach_state(Chip8State* storage)
+{
+	if (!storage)
+		storage = &own_state;
+
+	if (storage == st)
+		return;
+
+	*storage = *st;
+	st = storage;
+}
+
+void Chip8Core::restore_state(const Chip8State& s)
+{
+	// strony zmienione w zapisanym stanie kopiujemy z niego; zmienione tylko
+	// w biezacym stanie wystarczy zapomniec - znow czytamy je z obrazu gry.
+	// Przeanalizowany kod tracimy tylko na stronach o innej zawartosci, bo
+	// run-ahead i netplay odtwarzaja stan co klatke
+	const unsigned long long own = st->dirty_pages & ~s.dirty_pages;
+	unsigned long long changed = own;
+
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		if (!(s.dirty_pages >> p & 1))
+			continue;
+
+		const size_t off = p * Chip8State::page_size;
+		const bool dirty_now = (st->dirty_pages >> p & 1) != 0;
+		const BYTE* cur = dirty_now ? &st->game_memory[off] : &pristine[off];
+
+		if (memcmp(cur, &s.game_memory[off], Chip8State::page_size) != 0)
+			changed |= 1ULL << p;
+		else if (dirty_now)
+			continue; // ta sama zawartosc juz jest w game_memory
+
+		memcpy(&st->game_memory[off], &s.game_memory[off], Chip8State::page_size);
+	}
+
+	invalidate_pages(changed);
+	synced_pages &= ~own;
+
+	// wszystko poza pamiecia jest male i kopiujemy to w calosci
+	const size_t rest = sizeof(Chip8State) - offsetof(Chip8State, registers);
+	memcpy(&st->registers, &s.registers, rest);
+
+	fault_kind = FAULT_NONE;
+	frame_cycle = 0;
+	vip_frame_open = false;
+}
+
+void Chip8Core::write_memory(WORD addr, const BYTE* data, size_t len)
+{
+	unsigned long long written = 0;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		const WORD a = (addr + i) & (ram_size - 1);
+
+		store_byte(a, data[i]);
+		written |= 1ULL << (a / Chip8State::page_size);
+	}
+
+	invalidate_pages(written);
+}
+
+void Chip8Core::decrement_timers()
+{
+	if (st->delay_timer > 0)
+		st->delay_timer--;
+
+	if (st->sound_timer > 0)
+		st->sound_timer--;
+}
+
+void Chip8Core::set_keys(WORD mask)
+{
+	for (int i = 0; i < keys_number; i++)
+		st->key[i] = (mask >> i) & 1;
+}
+
+WORD Chip8Core::get_keys() const
+{
+	WORD mask = 0;
+
+	for (int i = 0; i < keys_number; i++)
+	{
+		if (st->key[i])
+			mask |= 1 << i;
+	}
+
+	return mask;
+}
+
+BYTE Chip8Core::next_random()
+{
+	// xorshift32 - deterministyczny i osobny dla kazdej instancji, w przeciwienstwie do rand()
+	unsigned int x = st->rng_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	st->rng_state = x;
+
+	return static_cast<BYTE>(x >> 24);
+}
+
+void Chip8Core::init_digit_sprites()
+{
+	int cur_addr = 0; // wypelniamy obraz pamieci od samego poczatku
+
+	// "0"
+	digit_sprite_addr[0] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+
+	// "1"
+	digit_sprite_addr[1] = cur_addr;
+	own_image[cur_addr++] = 0x20;
+	own_image[cur_addr++] = 0x60;
+	own_image[cur_addr++] = 0x20;
+	own_image[cur_addr++] = 0x20;
+	own_image[cur_addr++] = 0x70;
+
+	// "2"
+	digit_sprite_addr[2] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+
+	// "3"
+	digit_sprite_addr[3] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0xF0;
+
+	// "4"
+	digit_sprite_addr[4] = cur_addr;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0x10;
+
+	// "5"
+	digit_sprite_addr[5] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0xF0;
+
+	// "6"
+	digit_sprite_addr[6] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+
+	// "7"
+	digit_sprite_addr[7] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0x20;
+	own_image[cur_addr++] = 0x40;
+	own_image[cur_addr++] = 0x40;
+
+	// "8"
+	digit_sprite_addr[8] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+
+	// "9"
+	digit_sprite_addr[9] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x10;
+	own_image[cur_addr++] = 0xF0;
+
+	// "A"
+	digit_sprite_addr[0xA] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0x90;
+
+	// "B"
+	digit_sprite_addr[0xB] = cur_addr;
+	own_image[cur_addr++] = 0xE0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xE0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xE0;
+
+	// "C"
+	digit_sprite_addr[0xC] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+
+	// "D"
+	digit_sprite_addr[0xD] = cur_addr;
+	own_image[cur_addr++] = 0xE0;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0x90;
+	own_image[cur_addr++] = 0xE0;
+
+	// "E"
+	digit_sprite_addr[0xE] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+
+	// "F"
+	digit_sprite_addr[0xF] = cur_addr;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0xF0;
+	own_image[cur_addr++] = 0x80;
+	own_image[cur_addr++] = 0x80;
+}
+
+WORD Chip8Core::fetch_opcode()
+{
+	CHIP8_CHECK(st->program_counter <= ram_size - 2, FAULT_MEMORY, st->program_counter);
+
+	WORD ret = load_byte(st->program_counter++ & (ram_size - 1)) << 8;
+	ret |= load_byte(st->program_counter++ & (ram_size - 1));
+
+	return ret;
+}
+
+void Chip8Core::decode_opcode(const WORD& opcode)
+{
+	switch (opcode & 0xF000)
+	{
+	case 0x0000:
+	{
+		switch (opcode & 0x00FF)
+		{
+		case 0x00E0: opcode_00E0(); break;
+		case 0x00EE: opcode_00EE(); break;
+		default:
+			CHIP8_LOG(LOG_WARNING, MSG_UNEXPECTED_OPCODE, opcode_pc(), opcode);
+			break;
+		}
+	}
+		break;
+	case 0x1000: opcode_1nnn(opcode); break;
+	case 0x2000: opcode_2nnn(opcode); break;
+	case 0x3000: opcode_3xkk(opcode); break;
+	case 0x4000: opcode_4xkk(opcode); break;
+	case 0x5000: opcode_5xy0(opcode); break;
+	case 0x6000: opcode_6xkk(opcode); break;
+	case 0x7000: opcode_7xkk(opcode); break;
+	case 0x8000:
+	{
+		switch (opcode & 0x000F)
+		{
+		case 0x0000: opcode_8xy0(opcode); break;
+		case 0x0001: opcode_8xy1(opcode); break;
+		case 0x0002: opcode_8xy2(opcode); break;
+		case 0x0003: opcode_8xy3(opcode); break;
+		case 0x0004: opcode_8xy4(opcode); break;
+		case 0x0005: opcode_8xy5(opcode); break;
+		case 0x0006: opcode_8xy6(opcode); break;
+		case 0x0007: opcode_8xy7(opcode); break;
+		case 0x000E: opcode_8xyE(opcode); break;
+		default:
+			CHIP8_LOG(LOG_WARNING, MSG_UNEXPECTED_OPCODE, opcode_pc(), opcode);
+			break;
+		}
+	}
+		break;
+	case 0x9000: opcode_9xy0(opcode); break;
+	case 0xA000: opcode_Annn(opcode); break;
+	case 0xB000: opcode_Bnnn(opcode); break;
+	case 0xC000: opcode_Cxkk(opcode); break;
+	case 0xD000: opcode_Dxyn(opcode); break;
+	case 0xE000:
+	{
+		switch (opcode & 0x00FF)
+		{
+		case 0x009E: opcode_Ex9E(opcode); break;
+		case 0x00A1: opcode_ExA1(opcode); break;
+		default:
+			CHIP8_LOG(LOG_WARNING, MSG_UNEXPECTED_OPCODE, opcode_pc(), opcode);
+			break;
+		}
+	}
+		break;
+	case 0xF000:
+	{
+		switch (opcode & 0x00FF)
+		{
+		case 0x0007: opcode_Fx07(opcode); break;
+		case 0x000A: opcode_Fx0A(opcode); break;
+		case 0x0015: opcode_Fx15(opcode); break;
+		case 0x0018: opcode_Fx18(opcode); break;
+		case 0x001E: opcode_Fx1E(opcode); break;
+		case 0x0029: opcode_Fx29(opcode); break;
+		case 0x0033: opcode_Fx33(opcode); break;
+		case 0x0055: opcode_Fx55(opcode); break;
+		case 0x0065: opcode_Fx65(opcode); break;
+		default:
+			CHIP8_LOG(LOG_WARNING, MSG_UNEXPECTED_OPCODE, opcode_pc(), opcode);
+			break;
+		}
+	}
+		break;
+	default:
+		CHIP8_LOG(LOG_WARNING, MSG_UNKNOWN_OPCODE, opcode_pc(), opcode);
+		break; // nieobslugiwany opcode
+	}
+}
@@ -0,0 +1,401 @@
+#ifndef CHIP8CORE_H
+#define CHIP8CORE_H
+
+#include <cstddef>
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+
+// kontrola bledow programu CHIP-8 (wyjscie poza pamiec, stos, numer klawisza).
+// Wlaczana definicja CHIP8_CHECKED, np. w harnessie fuzzera; w zwyklej
+// kompilacji nie kosztuje nic, a rdzen po prostu zawija adresy
+#ifdef CHIP8_CHECKED
+	#define CHIP8_CHECK(cond, kind, addr) do { if (!(cond)) raise_fault(kind, addr); } while (0)
+#else
+	#define CHIP8_CHECK(cond, kind, addr) ((void)0)
+#endif
+
+// stan maszyny CHIP-8 - plaska struktura bez wskaznikow, wiec zapis
+// i odczyt stanu to zwykly memcpy
+struct Chip8State
+{
+	static const WORD	ram_size		= 0x1000;
+	static const BYTE	reg_size		= 16;
+	static const BYTE	stack_size		= 16;
+	static const int	width			= 64;
+	static const int	height			= 32;
+	static const int	keys_number		= 16;
+
+	// pamiec jest podzielona na strony. Strony niezmienione przez program sa
+	// czytane z obrazu gry (wspolnego dla instancji z ta sama gra), a do
+	// game_memory trafiaja dopiero przy pierwszym zapisie; zapisane strony
+	// zaznaczamy w dirty_pages. Zawartosc game_memory poza nimi jest nieokreslona
+	static const WORD	page_size		= 64;
+	static const int	pages			= ram_size / page_size;
+
+	BYTE				game_memory[ram_size];
+	BYTE				registers[reg_size];
+	WORD				address_I;
+	WORD				program_counter;
+	WORD				stack[stack_size];
+	BYTE				stack_ptr;
+	BYTE				delay_timer;
+	BYTE				sound_timer;
+	BYTE				key[keys_number];
+	BYTE				screen[height][width]; // wiersz po wierszu, 1 bajt na piksel
+	unsigned int		rng_state;
+
+	// strony pamieci rozniace sie od obrazu gry (bit na strone)
+	unsigned long long	dirty_pages;
+
+	// model VIP: cykle maszynowe pozostale w biezacej klatce (ujemne = dlug na nastepna)
+	int					vip_cycles;
+};
+
+static_assert(Chip8State::pages <= 64, "dirty page mask must fit in 64 bits");
+
+// wynik analizy kodu gry, ktory mozna zachowac miedzy uruchomieniami:
+// superinstrukcje rozpoznane pod kazdym adresem (adres z wpisem = znaleziony
+// kod), cele skokow (poczatki blokow) i profil uzywanych instrukcji
+struct Chip8Analysis
+{
+	unsigned int		quirks;
+	unsigned int		code_count;
+	BYTE				fusion[Chip8State::ram_size];
+	BYTE				fusion_len[Chip8State::ram_size];
+	BYTE				jump_target[Chip8State::ram_size];
+};
+
+// interpreter CHIP-8 bez zaleznosci od SDLa. Kazda instancja ma wlasny stan,
+// wiec wiele instancji moze dzialac rownolegle w roznych watkach
+class Chip8Profile;
+
+class Chip8Core
+{
+public:
+	static const WORD	ram_size		= Chip8State::ram_size;
+	static const WORD	game_start_addr = 0x200;
+	static const int	width			= Chip8State::width;
+	static const int	height			= Chip8State::height;
+	static const int	keys_number		= Chip8State::keys_number;
+
+	// superinstrukcje - czeste pary (ciagi) instrukcji wykonywane w jednym kroku
+	enum FusionKind
+	{
+		FUSE_UNKNOWN = 0,	// adres jeszcze nie analizowany
+		FUSE_NONE,			// zwykle wykonanie
+		FUSE_ANNN_DXYN,		// LD I, addr + DRW
+		FUSE_LD_RUN,		// ciag LD Vx, byte
+		FUSE_SKIP_JP,		// SE/SNE Vx, byte + JP addr
+		FUSE_FX07_SKIP,		// LD Vx, DT + SE/SNE Vy, byte
+		FUSE_KINDS
+	};
+
+	static const int	fusion_max_len	= 8;
+
+	struct FusionStats
+	{
+		unsigned long long	instructions;			// wszystkie wykonane instrukcje
+		unsigned long long	dispatches[FUSE_KINDS];	// wykonania danej superinstrukcji
+		unsigned long long	covered[FUSE_KINDS];	// instrukcje wykonane w ramach fuzji
+	};
+
+	static const char* fusion_name(int kind);
+
+	// profil gry: instrukcje, ktorych zachowanie rozni sie miedzy interpreterami
+	enum Quirk
+	{
+		QUIRK_LOAD_STORE	= 1 << 0,	// Fx55/Fx65 (zmiana I)
+		QUIRK_SHIFT			= 1 << 1,	// 8xy6/8xyE (przesuwany Vx czy Vy)
+		QUIRK_JUMP_V0		= 1 << 2,	// Bnnn (V0 czy Vx)
+		QUIRK_LOGIC_VF		= 1 << 3,	// 8xy1/8xy2/8xy3 (zerowanie VF)
+		QUIRK_SELF_MODIFYING = 1 << 4	// gra nadpisuje wlasny kod
+	};
+
+	// wersja formatu Chip8Analysis - zmienia sie razem z rodzajami superinstrukcji
+	static const unsigned int analysis_version = 1;
+
+	// powod zatrzymania wykonania przez debugger
+	enum StopReason
+	{
+		STOP_NONE = 0,
+		STOP_BREAKPOINT,	// PC trafil na pulapke, instrukcja jeszcze nie wykonana
+		STOP_WATCHPOINT		// instrukcja zapisala obserwowany adres
+	};
+
+	// bledy wykrywane w kompilacji z CHIP8_CHECKED (zapamietywany jest pierwszy)
+	enum Fault
+	{
+		FAULT_NONE = 0,
+		FAULT_MEMORY,			// dostep do pamieci poza 0x000-0xFFF
+		FAULT_STACK_UNDERFLOW,	// RET przy pustym stosie
+		FAULT_STACK_OVERFLOW,	// CALL przy pelnym stosie
+		FAULT_KEY_INDEX			// SKP/SKNP z Vx > 15
+	};
+
+	static const char* fault_name(int kind);
+
+	// model czasu: stala liczba instrukcji na klatke albo koszt kazdej instrukcji
+	// w cyklach maszynowych interpretera CHIP-8 na COSMAC VIP
+	enum Timing
+	{
+		TIMING_FIXED = 0,
+		TIMING_VIP
+	};
+
+	// COSMAC VIP: 1.7609 MHz / 8 taktow = 3668 cykli maszynowych na klatke 60 Hz,
+	// z czego DMA obrazu (128 linii po 8 bajtow) i przerwanie zabieraja 1076
+	static const int	vip_frame_cycles = 3668;
+	static const int	vip_display_cycles = 1076;
+	static const int	vip_budget		= vip_frame_cycles - vip_display_cycles;
+
+private:
+	Chip8State			own_state;
+	Chip8State*			st				= &own_state;
+
+	// obraz pamieci po wczytaniu gry (czcionka + ROM), z ktorego czytamy strony
+	// niezmienione przez program. Moze nalezec do innej instancji (share_image)
+	BYTE*				own_image		= nullptr;
+	const BYTE*			pristine		= nullptr;
+	// niezmienione strony, ktore w game_memory juz maja zawartosc obrazu gry
+	// (sync_memory); strona wracajaca do obrazu traci ten bit
+	unsigned long long	synced_pages	= 0;
+	BYTE				digit_sprite_addr[0xF + 1];
+	bool				loaded			= false;
+	unsigned int		seed			= 1;
+	unsigned int		cycles_per_frame = 8;
+
+	// tablice dla fuzji instrukcji, indeksowane adresem instrukcji
+	BYTE				fusion[ram_size];
+	BYTE				fusion_len[ram_size];
+	BYTE				jump_target[ram_size];
+	bool				fusion_enabled	= true;
+	FusionStats			stats;
+
+	// ile instrukcji biezacej klatki juz wykonano (klatka przerwana przez debugger)
+	unsigned int		frame_cycle		= 0;
+
+	int					timing			= TIMING_FIXED;
+	bool				vip_frame_open	= false;
+
+	// pulapki i obserwowane adresy - po jednym bicie na adres. Sprawdzane tylko,
+	// gdy ktorys jest ustawiony, wiec zwykle wykonanie nic na nich nie traci
+	unsigned long long	breakpoints[ram_size / 64];
+	unsigned long long	watchpoints[ram_size / 64];
+	unsigned int		breakpoint_count = 0;
+	unsigned int		watchpoint_count = 0;
+	int					stop			= STOP_NONE;
+	WORD				stop_address	= 0;
+
+	int					fault_kind		= FAULT_NONE;
+	WORD				fault_address	= 0;
+	WORD				fault_pc		= 0;
+
+	// wcisniete klawisze, ktore program sprawdzil (SKP, SKNP, LD Vx, K) od
+	// ostatniego take_observed_keys() - do pomiaru opoznienia wejscia
+	WORD				observed_keys	= 0;
+	// najwieksza wartosc zamieniona na BCD (Fx33) od ostatniego take_observed_bcd(),
+	// -1 = zadna - gry tak zwykle wypisuja wynik
+	int					observed_bcd	= -1;
+
+	// profil czasu hosta dla blokow kodu (nullptr = wylaczony)
+	Chip8Profile*		profile			= nullptr;
+	WORD				profile_block	= 0;
+	unsigned int		profile_len		= 0;
+	unsigned long long	profile_start	= 0;
+
+public:
+	Chip8Core();
+	~Chip8Core();
+
+	Chip8Core(const Chip8Core&) = delete;
+	Chip8Core& operator=(const Chip8Core&) = delete;
+
+	bool load_rom(const BYTE* data, size_t len);
+	// uzywa obrazu gry innej instancji zamiast wlasnej kopii (jak load_rom tej
+	// samej gry). owner musi zyc dluzej i nie wczytywac w tym czasie innej gry
+	void share_image(const Chip8Core& owner);
+	void reset();
+	void set_seed(unsigned int s);
+	unsigned int get_seed() const { return seed; }
+	void set_cycles_per_frame(unsigned int n) { cycles_per_frame = n; }
+	unsigned int get_cycles_per_frame() const { return cycles_per_frame; }
+	// w modelu VIP cycles_per_frame nie jest uzywane, a superinstrukcje sa pomijane
+	void set_timing(int model) { timing = model; vip_frame_open = false; }
+	int get_timing() const { return timing; }
+	bool is_loaded() const { return loaded; }
+
+	void step();
+	unsigned int run_cycles(unsigned int n);
+	bool run_frame();
+	void decrement_timers();
+
+	void set_fusion(bool on);
+	bool get_fusion() const { return fusion_enabled; }
+	const FusionStats& fusion_stats() const { return stats; }
+
+	// analiza kodu waznego dla niezmienionego obrazu gry (wpisy dotykajace stron
+	// zapisanych przez program sa pomijane). Import tylko tuz po load_rom()/reset()
+	// i tylko dla tej samej gry; niespojne dane sa odrzucane w calosci
+	void export_analysis(Chip8Analysis& out) const;
+	bool import_analysis(const Chip8Analysis& in);
+	// obraz pamieci po wczytaniu gry (czcionka + ROM) - klucz dla pamieci podrecznej
+	const BYTE* image() const { return pristine; }
+
+	// wyniki analizy statycznej (np. chip8_analyze): cele skokow trzeba podac przed
+	// adresami kodu, bo superinstrukcja nie moze obejmowac celu skoku. predecode()
+	// rozpoznaje superinstrukcje pod pc z gory, zamiast przy pierwszym wykonaniu
+	void add_jump_target(WORD addr) { mark_jump_target(addr); }
+	void predecode(WORD pc);
+	// po zmianie pamieci z zewnatrz (np. przez state()) trzeba zapomniec przeanalizowany kod;
+	// cala pamiec jest wtedy traktowana jako zmieniona (game_memory musi byc pelna)
+	void invalidate_code();
+	// stan z pelna pamiecia (np. z full_state()); strony zgodne z obrazem gry
+	// znow sa czytane z obrazu
+	void load_state(const Chip8State& s);
+	// kopia stanu z cala pamiecia - niezmienione strony uzupelnione z obrazu gry
+	void full_state(Chip8State& out) const;
+	// szybkie odtworzenie stanu zapisanego z tej samej gry: kopiuje tylko strony
+	// zmienione w s albo w biezacym stanie, a analize kodu traci tylko na
+	// stronach, ktorych zawartosc sie rozni
+	void restore_state(const Chip8State& s);
+	// zapis bloku pamieci z zewnatrz (zaznacza strony i uniewaznia kod)
+	void write_memory(WORD addr, const BYTE* data, size_t len);
+	BYTE read_memory(WORD addr) const { return load_byte(addr & (ram_size - 1)); }
+	// niezmienione strony dostaja w game_memory zawartosc z obrazu gry, wiec
+	// state().game_memory mozna czytac bezposrednio (np. w funkcji nagrody).
+	// Kopiowane sa tylko strony, ktore wrocily do obrazu od poprzedniego wywolania
+	void sync_memory();
+
+	// debugowanie: po zatrzymaniu run_cycles() zwraca mniej instrukcji niz zadano,
+	// a run_frame() zwraca false i przy nastepnym wywolaniu dokancza te sama klatke
+	void set_breakpoint(WORD addr, bool on);
+	void set_watchpoint(WORD addr, WORD len, bool on);
+	void clear_debug();
+	bool debugging() const { return breakpoint_count || watchpoint_count; }
+	int stop_reason() const { return stop; }
+	WORD stop_addr() const { return stop_address; }
+	// jedna instrukcja (z pominieciem pulapki pod PC) liczona do biezacej klatki; true = koniec klatki
+	bool single_step();
+	// zapis do pamieci z zewnatrz z uniewaznieniem przeanalizowanego kodu
+	void poke(WORD addr, BYTE value);
+
+	// pomiar czasu hosta na blok kodu; profil musi zyc dluzej niz podpiecie
+	void set_profile(Chip8Profile* p);
+	Chip8Profile* get_profile() const { return profile; }
+
+	// pierwszy wykryty blad programu (tylko z CHIP8_CHECKED); kasowany przez reset()
+	int fault() const { return fault_kind; }
+	WORD fault_addr() const { return fault_address; }
+	WORD fault_pc_addr() const { return fault_pc; }
+
+	void set_keys(WORD mask);
+	WORD get_keys() const;
+	// maska wcisnietych klawiszy odczytanych przez program od poprzedniego wywolania
+	WORD take_observed_keys() { const WORD k = observed_keys; observed_keys = 0; return k; }
+	int take_observed_bcd() { const int v = observed_bcd; observed_bcd = -1; return v; }
+
+	const BYTE* framebuffer() const { return &st->screen[0][0]; }
+	static int pitch() { return width; }
+
+	Chip8State& state() { return *st; }
+	const Chip8State& state() const { return *st; }
+
+	// przenosi stan do pamieci poza obiektem (np. ciagla tablica wielu instancji);
+	// biezacy stan jest tam kopiowany. nullptr wraca do wlasnego stanu
+	void attach_state(Chip8State* storage);
+
+private:
+	void init_digit_sprites();
+	WORD fetch_opcode();
+	void decode_opcode(const WORD& opcode);
+	// adres dekodowanej instrukcji (fetch_opcode przesunal juz PC)
+	WORD opcode_pc() const { return static_cast<WORD>((st->program_counter - 2) & (ram_size - 1)); }
+	BYTE next_random();
+
+	BYTE analyze_fusion(WORD pc);
+	unsigned int exec_fused(WORD pc, BYTE kind);
+	void code_written(WORD addr);
+	void mark_jump_target(WORD addr);
+	WORD read_word(WORD addr) const;
+	unsigned int run_cycles_debug(unsigned int n);
+	unsigned int run_cycles_profiled(unsigned int n);
+	void profile_begin();
+	void profile_step(WORD pc, unsigned int executed);
+	void profile_end();
+	void invalidate_pages(unsigned long long mask);
+	bool run_frame_vip();
+	void exec_vip();
+	int vip_cost(WORD opcode, bool skipped) const;
+	void raise_fault(int kind, WORD addr);
+
+	// addr juz obciety do ram_size
+	BYTE load_byte(WORD addr) const
+	{
+		return (st->dirty_pages >> (addr / Chip8State::page_size) & 1 ? st->game_memory : pristine)[addr];
+	}
+
+	// kopia przy zapisie: pierwsza zmiana strony przenosi ja z obrazu gry do stanu
+	void store_byte(WORD addr, BYTE value)
+	{
+		const int p = addr / Chip8State::page_size;
+
+		if (!(st->dirty_pages >> p & 1))
+			copy_page(p);
+
+		st->game_memory[addr] = value;
+	}
+
+	void copy_page(int p);
+
+	void memory_written(WORD addr)
+	{
+		st->dirty_pages |= 1ULL << (addr / Chip8State::page_size);
+		code_written(addr);
+
+		if (watchpoint_count && (watchpoints[addr >> 6] >> (addr & 63) & 1))
+		{
+			stop = STOP_WATCHPOINT;
+			stop_address = addr;
+		}
+	}
+
+	// opcody
+
+	void opcode_00E0();
+	void opcode_00EE();
+	void opcode_1nnn(const WORD& opcode);
+	void opcode_2nnn(const WORD& opcode);
+	void opcode_3xkk(const WORD& opcode);
+	void opcode_4xkk(const WORD& opcode);
+	void opcode_5xy0(const WORD& opcode);
+	void opcode_6xkk(const WORD& opcode);
+	void opcode_7xkk(const WORD& opcode);
+	void opcode_8xy0(const WORD& opcode);
+	void opcode_8xy1(const WORD& opcode);
+	void opcode_8xy2(const WORD& opcode);
+	void opcode_8xy3(const WORD& opcode);
+	void opcode_8xy4(const WORD& opcode);
+	void opcode_8xy5(const WORD& opcode);
+	void opcode_8xy6(const WORD& opcode);
+	void opcode_8xy7(const WORD& opcode);
+	void opcode_8xyE(const WORD& opcode);
+	void opcode_9xy0(const WORD& opcode);
+	void opcode_Annn(const WORD& opcode);
+	void opcode_Bnnn(const WORD& opcode);
+	void opcode_Cxkk(const WORD& opcode);
+	void opcode_Dxyn(const WORD& opcode);
+	void opcode_Ex9E(const WORD& opcode);
+	void opcode_ExA1(const WORD& opcode);
+	void opcode_Fx07(const WORD& opcode);
+	void opcode_Fx0A(const WORD& opcode);
+	void opcode_Fx15(const WORD& opcode);
+	void opcode_Fx18(const WORD& opcode);
+	void opcode_Fx1E(const WORD& opcode);
+	void opcode_Fx29(const WORD& opcode);
+	void opcode_Fx33(const WORD& opcode);
+	void opcode_Fx55(const WORD& opcode);
+	void opcode_Fx65(const WORD& opcode);
+};
+
+#endif
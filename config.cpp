@@ -0,0 +1,67 @@
+#include "config.h"
+#include "INIReader.h"
+
+bool load_config(const std::string& path, Chip8Config& cfg)
+{
+	INIReader ini(path);
+
+	if (ini.ParseError() != 0)
+		return false;
+
+	// tutaj mamy poprawnie wczytany plik konfiguracyjny
+
+	cfg.rom_path = ini.Get("", "rom_path", cfg.rom_path);
+	cfg.pixel_size = static_cast<int>(ini.GetInteger("", "pixel_size", cfg.pixel_size));
+	cfg.cycles_per_frame = static_cast<unsigned int>(ini.GetInteger("", "cycles_per_frame", cfg.cycles_per_frame));
+	parse_timing(ini.Get("", "timing", "fixed"), cfg.timing);
+	cfg.fusion = ini.GetBoolean("", "fusion", cfg.fusion);
+	cfg.runahead = static_cast<unsigned int>(ini.GetInteger("", "runahead", cfg.runahead));
+	cfg.phosphor_decay = static_cast<unsigned int>(ini.GetInteger("", "phosphor_decay", cfg.phosphor_decay));
+	cfg.wall = static_cast<unsigned int>(ini.GetInteger("", "wall", cfg.wall));
+	cfg.wall_columns = static_cast<unsigned int>(ini.GetInteger("", "wall_columns", cfg.wall_columns));
+	parse_log_level(ini.Get("", "log_level", "warning"), cfg.log_level);
+	cfg.capture_y4m = ini.Get("", "capture_y4m", cfg.capture_y4m);
+	cfg.capture_gif = ini.Get("", "capture_gif", cfg.capture_gif);
+	cfg.gdb = ini.Get("", "gdb", cfg.gdb);
+	cfg.shm_export = ini.Get("", "shm_export", cfg.shm_export);
+	cfg.analysis_cache = ini.Get("", "analysis_cache", cfg.analysis_cache);
+	cfg.session_file = ini.Get("", "session_file", cfg.session_file);
+	cfg.session_checkpoint = static_cast<unsigned int>(ini.GetInteger("", "session_checkpoint", cfg.session_checkpoint));
+	cfg.profile = ini.Get("", "profile", cfg.profile);
+	cfg.frame_stats = ini.GetBoolean("", "frame_stats", cfg.frame_stats);
+	cfg.frame_overlay = ini.GetBoolean("", "frame_overlay", cfg.frame_overlay);
+	cfg.seed = static_cast<unsigned int>(ini.GetInteger("", "seed", cfg.seed));
+	cfg.netplay_local = ini.Get("", "netplay_local", cfg.netplay_local);
+	cfg.netplay_peer = ini.Get("", "netplay_peer", cfg.netplay_peer);
+	cfg.netplay_latency = static_cast<unsigned int>(ini.GetInteger("", "netplay_latency", cfg.netplay_latency));
+
+	return true;
+}
+
+bool parse_timing(const std::string& name, int& timing)
+{
+	if (name == "fixed")
+		timing = Chip8Core::TIMING_FIXED;
+	else if (name == "vip")
+		timing = Chip8Core::TIMING_VIP;
+	else
+		return false;
+
+	return true;
+}
+
+bool parse_log_level(const std::string& name, int& level)
+{
+	static const char* const names[] = { "debug", "info", "warning", "error", "off" };
+
+	for (int i = LOG_DEBUG; i <= LOG_OFF; i++)
+	{
+		if (name == names[i])
+		{
+			level = i;
+			return true;
+		}
+	}
+
+	return false;
+}
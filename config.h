@@ -0,0 +1,70 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include "chip8core.h"
+#include "chip8_log.h"
+
+// ustawienia z pliku settings.ini, wspolne dla wszystkich frontendow
+struct Chip8Config
+{
+	std::string			rom_path;
+	int					pixel_size			= 20;
+	unsigned int		cycles_per_frame	= 8;
+	int					timing				= Chip8Core::TIMING_FIXED;
+	int					log_level			= LOG_WARNING;
+	bool				fusion				= true;
+	unsigned int		runahead			= 0;	// klatki przewidywane naprzod
+	unsigned int		phosphor_decay		= 0;	// poswiata: % jasnosci po klatce (0 = wylaczona)
+
+	// sciana wielu instancji w jednym oknie (0 = zwykly emulator)
+	unsigned int		wall				= 0;
+	unsigned int		wall_columns		= 0;	// 0 = mniej wiecej kwadrat
+
+	// nagrywanie obrazu (puste = wylaczone)
+	std::string			capture_y4m;
+	std::string			capture_gif;
+
+	// adres serwera GDB (puste = wylaczony)
+	std::string			gdb;
+
+	// nazwa segmentu pamieci wspoldzielonej ze stanem gry (puste = wylaczone)
+	std::string			shm_export;
+
+	// plik sesji odpornej na awarie: stan gry zyje w nim i jest wznawiany
+	// przy nastepnym uruchomieniu (puste = wylaczone)
+	std::string			session_file;
+	unsigned int		session_checkpoint	= 30;	// klatki miedzy checkpointami
+
+	// katalog z zapisana analiza kodu gier (puste = wylaczone)
+	std::string			analysis_cache;
+
+	// ziarno generatora liczb losowych (0 = z zegara, poza gra przez siec)
+	unsigned int		seed				= 0;
+
+	// gra we dwoje przez siec: nasz adres i adres drugiego gracza
+	// ("port", "host:port", "unix:/sciezka"); puste = wylaczona
+	std::string			netplay_local;
+	std::string			netplay_peer;
+	unsigned int		netplay_latency		= 0;	// sztuczne opoznienie wysylania w ms
+
+	// plik z profilem czasu hosta w formacie collapsed stacks (puste = wylaczone)
+	std::string			profile;
+
+	// pomiar plynnosci obrazu i opoznienia klawiszy: histogramy na koniec gry
+	// i wykres ostatnich klatek na obrazie
+	bool				frame_stats			= false;
+	bool				frame_overlay		= false;
+};
+
+// wczytuje ustawienia z pliku ini. Brakujace klucze zostaja z wartosciami
+// domyslnymi; zwraca false, jesli pliku nie udalo sie sparsowac
+bool load_config(const std::string& path, Chip8Config& cfg);
+
+// "fixed" albo "vip" -> Chip8Core::TIMING_*; false dla nieznanej nazwy
+bool parse_timing(const std::string& name, int& timing);
+
+// "debug", "info", "warning", "error" albo "off" -> LOG_*; false dla nieznanej nazwy
+bool parse_log_level(const std::string& name, int& level);
+
+#endif
@@ -0,0 +1,197 @@
+#include "framestats.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+void LatencyHistogram::clear()
+{
+	memset(counts, 0, sizeof(counts));
+	total = 0;
+	sum = 0;
+	min_us = ~0u;
+	max_us = 0;
+}
+
+int LatencyHistogram::bucket(uint32_t us)
+{
+	int msb = 0;
+
+	while (msb < 31 && (us >> (msb + 1)))
+		msb++;
+
+	// ponizej 2 * sub_count wartosci sa dokladne, wyzej co potege dwojki
+	// kubelki sa dwa razy szersze
+	const int shift = msb > sub_bits ? msb - sub_bits : 0;
+
+	return shift * sub_count + static_cast<int>(us >> shift);
+}
+
+uint32_t LatencyHistogram::bucket_high(int index)
+{
+	if (index < 2 * sub_count)
+		return static_cast<uint32_t>(index);
+
+	const int shift = index / sub_count - 1;
+	const uint64_t mantissa = static_cast<uint64_t>(index - shift * sub_count);
+
+	return static_cast<uint32_t>(((mantissa + 1) << shift) - 1);
+}
+
+void LatencyHistogram::add(uint32_t us)
+{
+	counts[bucket(us)]++;
+	total++;
+	sum += us;
+
+	if (us < min_us)
+		min_us = us;
+
+	if (us > max_us)
+		max_us = us;
+}
+
+uint32_t LatencyHistogram::percentile(double p) const
+{
+	if (!total)
+		return 0;
+
+	uint64_t target = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+
+	if (target < 1)
+		target = 1;
+
+	uint64_t seen = 0;
+
+	for (int i = 0; i < buckets; i++)
+	{
+		seen += counts[i];
+
+		if (seen >= target)
+		{
+			const uint32_t v = bucket_high(i);
+			return v < max_us ? v : max_us;
+		}
+	}
+
+	return max_us;
+}
+
+FrameStats::FrameStats()
+{
+	clear();
+}
+
+void FrameStats::clear()
+{
+	for (int m = 0; m < METRICS; m++)
+		hist[m].clear();
+
+	memset(recent, 0, sizeof(recent));
+	memset(&current, 0, sizeof(current));
+	frames = 0;
+	presented_once = false;
+	pending = 0;
+	held = 0;
+}
+
+uint32_t FrameStats::to_us(clock::duration d)
+{
+	const long long us = chrono::duration_cast<chrono::microseconds>(d).count();
+
+	return us < 0 ? 0 : us > 0xFFFFFFFFLL ? 0xFFFFFFFFu : static_cast<uint32_t>(us);
+}
+
+void FrameStats::add(int metric, clock::duration d)
+{
+	const uint32_t us = to_us(d);
+
+	hist[metric].add(us);
+
+	if (metric < INTERVAL)
+		current.us[metric] = us;
+}
+
+void FrameStats::presented(clock::time_point t, WORD observed)
+{
+	if (presented_once)
+	{
+		current.us[INTERVAL] = to_us(t - last_present);
+		hist[INTERVAL].add(current.us[INTERVAL]);
+	}
+
+	last_present = t;
+	presented_once = true;
+
+	recent[frames % history] = current;
+	frames++;
+	memset(&current, 0, sizeof(current));
+
+	// klawisze odczytane w tej klatce - od wcisniecia do jej wyswietlenia
+	for (WORD done = observed & pending; done; done &= done - 1)
+	{
+		int k = 0;
+
+		while (!(done & (1 << k)))
+			k++;
+
+		hist[INPUT_LATENCY].add(to_us(t - pressed_at[k]));
+	}
+
+	pending &= ~observed;
+}
+
+void FrameStats::keys(WORD mask, clock::time_point t)
+{
+	// kolejne wcisniecie tego samego klawisza zaczyna pomiar od nowa
+	for (WORD down = mask & ~held; down; down &= down - 1)
+	{
+		int k = 0;
+
+		while (!(down & (1 << k)))
+			k++;
+
+		pressed_at[k] = t;
+		pending |= 1 << k;
+	}
+
+	held = mask;
+}
+
+const char* FrameStats::metric_name(int metric)
+{
+	static const char* const names[METRICS] = { "emulate", "render", "present", "present interval", "key to present" };
+
+	return metric >= 0 && metric < METRICS ? names[metric] : "?";
+}
+
+std::string FrameStats::report() const
+{
+	string out = "frame timing (ms):        count     mean      p50      p90      p99    p99.9      max";
+	char buf[160];
+
+	for (int m = 0; m < METRICS; m++)
+	{
+		const LatencyHistogram& h = hist[m];
+
+		if (!h.count())
+			continue;
+
+		snprintf(buf, sizeof(buf), "\n  %-20s %9llu %8.3f %8.3f %8.3f %8.3f %8.3f %8.3f", metric_name(m),
+			static_cast<unsigned long long>(h.count()), h.mean() / 1000.0, h.percentile(50) / 1000.0,
+			h.percentile(90) / 1000.0, h.percentile(99) / 1000.0, h.percentile(99.9) / 1000.0, h.max() / 1000.0);
+		out += buf;
+	}
+
+	// rozrzut odstepow miedzy klatkami wzgledem 1/60 s
+	const LatencyHistogram& iv = hist[INTERVAL];
+
+	if (iv.count())
+	{
+		snprintf(buf, sizeof(buf), "\n  jitter: p99 - p50 interval %.3f ms, max %.3f ms over 16.667 ms",
+			(iv.percentile(99) - iv.percentile(50)) / 1000.0, iv.max() > 16667 ? (iv.max() - 16667) / 1000.0 : 0.0);
+		out += buf;
+	}
+
+	return out;
+}
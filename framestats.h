@@ -0,0 +1,134 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "chip8core.h"
+
+// histogram czasow w mikrosekundach w stylu HdrHistogram: 32 kubelki na kazda
+// potege dwojki, wiec blad wzgledny to najwyzej ~3% w calym zakresie
+// (do ~71 minut). Staly rozmiar - dodanie probki niczego nie alokuje
+class LatencyHistogram
+{
+public:
+	static const int		sub_bits		= 5;
+	static const int		sub_count		= 1 << sub_bits;
+	static const int		buckets			= (32 - sub_bits + 1) * sub_count;
+
+private:
+	uint32_t				counts[buckets];
+	uint64_t				total;
+	uint64_t				sum;
+	uint32_t				min_us;
+	uint32_t				max_us;
+
+public:
+	LatencyHistogram() { clear(); }
+
+	void clear();
+	void add(uint32_t us);
+
+	uint64_t count() const { return total; }
+	uint32_t min() const { return total ? min_us : 0; }
+	uint32_t max() const { return max_us; }
+	double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+	// najwieksza wartosc rownowazna kubelkowi, w ktorym wypada percentyl p (0-100)
+	uint32_t percentile(double p) const;
+
+	static int bucket(uint32_t us);
+	static uint32_t bucket_high(int index);
+};
+
+// pomiar plynnosci obrazu we frontendzie: czas emulacji, rysowania
+// i wyswietlenia klatki, odstep miedzy kolejnymi wyswietleniami oraz opoznienie
+// od wcisniecia klawisza do pierwszej wyswietlonej klatki, w ktorej program
+// ten klawisz odczytal (Chip8Core::take_observed_keys)
+class FrameStats
+{
+public:
+	typedef std::chrono::steady_clock	clock;
+
+	enum Metric
+	{
+		EMULATE = 0,
+		RENDER,
+		PRESENT,
+		INTERVAL,
+		INPUT_LATENCY,
+		METRICS
+	};
+
+	// ostatnie klatki dla nakladki na obraz
+	struct Sample
+	{
+		uint32_t			us[INTERVAL + 1];
+	};
+
+	static const int		history			= 64;
+
+private:
+	LatencyHistogram		hist[METRICS];
+	Sample					recent[history];
+	unsigned int			frames			= 0;
+	Sample					current;
+
+	clock::time_point		last_present;
+	bool					presented_once	= false;
+
+	// czas ostatniego wcisniecia klawisza, jeszcze nieodczytanego przez program
+	clock::time_point		pressed_at[Chip8Core::keys_number];
+	WORD					pending			= 0;
+	WORD					held			= 0;
+
+public:
+	FrameStats();
+
+	void clear();
+
+	static uint32_t to_us(clock::duration d);
+
+	// czas jednego etapu biezacej klatki
+	void add(int metric, clock::duration d);
+	// koniec wyswietlania klatki; odczytane przez nia klawisze (maska od rdzenia)
+	// zamykaja pomiary opoznienia
+	void presented(clock::time_point t, WORD observed);
+	// stan klawiatury CHIP-8; nowe wcisniecia zaczynaja pomiar opoznienia
+	void keys(WORD mask, clock::time_point t);
+
+	const LatencyHistogram& histogram(int metric) const { return hist[metric]; }
+	// back = 0 - ostatnia wyswietlona klatka
+	const Sample& sample(unsigned int back) const { return recent[(frames - 1 - back) % history]; }
+	unsigned int frame_count() const { return frames; }
+
+	static const char* metric_name(int metric);
+	std::string report() const;
+};
+
+// mierzy czas do konca zakresu jako jeden etap klatki; z s == nullptr nic nie robi
+class TimingScope
+{
+private:
+	FrameStats*				stats;
+	int						metric;
+	FrameStats::clock::time_point	start;
+
+public:
+	TimingScope(FrameStats* s, int m)
+		: stats(s), metric(m)
+	{
+		if (stats)
+			start = FrameStats::clock::now();
+	}
+
+	~TimingScope()
+	{
+		if (stats)
+			stats->add(metric, FrameStats::clock::now() - start);
+	}
+
+	TimingScope(const TimingScope&) = delete;
+	TimingScope& operator=(const TimingScope&) = delete;
+};
+
+#endif
@@ -0,0 +1,737 @@
+#include "gdbstub.h"
+#include <iostream>
+#include <cstdio> // snprintf
+#include <cstdlib> // strtoul
+#include <cstring>
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	typedef int socklen_t;
+	#define close_socket closesocket
+#else
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <arpa/inet.h>
+	#include <poll.h>
+	#include <unistd.h>
+	#define close_socket ::close
+#endif
+
+// klient rozlaczony w trakcie odpowiedzi nie moze zabic emulatora sygnalem
+// SIGPIPE; na macOS sluzy do tego opcja gniazda SO_NOSIGPIPE (accept_client)
+#ifdef MSG_NOSIGNAL
+	#define SEND_FLAGS MSG_NOSIGNAL
+#else
+	#define SEND_FLAGS 0
+#endif
+
+using namespace std;
+
+static const unsigned int reg_count = 21; // V0-VF, I, PC, SP, DT, ST
+
+static const char target_xml[] =
+	"<?xml version=\"1.0\"?>"
+	"<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+	"<target version=\"1.0\"><feature name=\"org.chip8.core\">"
+	"<reg name=\"v0\" bitsize=\"8\" type=\"uint8\" regnum=\"0\"/>"
+	"<reg name=\"v1\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v2\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v3\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v4\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v5\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v6\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v7\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v8\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"v9\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"va\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"vb\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"vc\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"vd\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"ve\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"vf\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"i\" bitsize=\"16\" type=\"data_ptr\"/>"
+	"<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+	"<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>"
+	"<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>"
+	"</feature></target>";
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+// false = blad gniazda; send() moze wyslac tylko czesc danych
+static bool send_all(int fd, const char* data, size_t len)
+{
+	while (len)
+	{
+		const int n = static_cast<int>(send(fd, data, static_cast<int>(len), SEND_FLAGS));
+
+		if (n <= 0)
+			return false;
+
+		data += n;
+		len -= n;
+	}
+
+	return true;
+}
+
+static void append_hex(string& out, unsigned int value, unsigned int bytes)
+{
+	// GDB oczekuje wartosci rejestrow w kolejnosci little endian
+	static const char digits[] = "0123456789abcdef";
+
+	for (unsigned int i = 0; i < bytes; i++)
+	{
+		const unsigned int b = (value >> (8 * i)) & 0xFF;
+		out += digits[b >> 4];
+		out += digits[b & 0xF];
+	}
+}
+
+static unsigned int parse_hex_le(const char* p, unsigned int bytes)
+{
+	unsigned int value = 0;
+
+	for (unsigned int i = 0; i < bytes; i++)
+	{
+		// na koncu napisu konczymy przed odczytem za terminatorem
+		const int hi = hex_digit(p[2 * i]);
+
+		if (hi < 0)
+			break;
+
+		const int lo = hex_digit(p[2 * i + 1]);
+
+		if (lo < 0)
+			break;
+
+		value |= static_cast<unsigned int>(hi << 4 | lo) << (8 * i);
+	}
+
+	return value;
+}
+
+GdbStub::GdbStub(Chip8Core& c8)
+	: core(c8)
+{
+}
+
+GdbStub::~GdbStub()
+{
+	close();
+}
+
+bool GdbStub::listen(const std::string& address)
+{
+	close();
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+	int fd = -1;
+
+#ifndef _WIN32
+	if (address.compare(0, 5, "unix:") == 0)
+	{
+		sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+		unix_path = address.substr(5);
+		strncpy(sa.sun_path, unix_path.c_str(), sizeof(sa.sun_path) - 1);
+		unlink(unix_path.c_str());
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (fd < 0 || ::bind(fd, (sockaddr*)&sa, sizeof(sa)) != 0)
+		{
+			cerr << "GDB: can't bind " << address << endl;
+
+			if (fd >= 0)
+				close_socket(fd);
+
+			return false;
+		}
+	}
+	else
+#endif
+	{
+		// domyslnie nasluchujemy tylko lokalnie
+		string host = "127.0.0.1";
+		string port = address;
+		const size_t colon = address.rfind(':');
+
+		if (colon != string::npos)
+		{
+			host = address.substr(0, colon);
+			port = address.substr(colon + 1);
+		}
+
+		sockaddr_in sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sin_family = AF_INET;
+		sa.sin_port = htons(static_cast<unsigned short>(strtoul(port.c_str(), nullptr, 10)));
+		sa.sin_addr.s_addr = inet_addr(host.c_str());
+
+		fd = static_cast<int>(socket(AF_INET, SOCK_STREAM, 0));
+
+		const int yes = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+		if (fd < 0 || ::bind(fd, (sockaddr*)&sa, sizeof(sa)) != 0)
+		{
+			cerr << "GDB: can't bind " << address << endl;
+
+			if (fd >= 0)
+				close_socket(fd);
+
+			return false;
+		}
+	}
+
+	if (::listen(fd, 1) != 0)
+	{
+		cerr << "GDB: can't listen on " << address << endl;
+		close_socket(fd);
+		return false;
+	}
+
+	listen_fd = fd;
+	halted = true;
+
+	cout << "GDB: waiting for connection on " << address << endl;
+
+	return true;
+}
+
+void GdbStub::close()
+{
+	drop_client();
+
+	if (listen_fd >= 0)
+	{
+		close_socket(listen_fd);
+		listen_fd = -1;
+	}
+
+#ifndef _WIN32
+	if (!unix_path.empty())
+	{
+		unlink(unix_path.c_str());
+		unix_path.clear();
+	}
+#endif
+
+	halted = false;
+}
+
+void GdbStub::poll(int timeout_ms)
+{
+	if (listen_fd < 0)
+		return;
+
+	frame_finished = false;
+
+	// pakiety zostawione po klatce dokonczonej krokowaniem obslugujemy bez czekania
+	if (client_fd >= 0 && !in_buf.empty())
+	{
+		process_input();
+
+		if (frame_finished || client_fd < 0)
+			return;
+	}
+
+	const int fd = client_fd >= 0 ? client_fd : listen_fd;
+
+#ifdef _WIN32
+	fd_set set;
+	FD_ZERO(&set);
+	FD_SET(fd, &set);
+	timeval tv = { timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+
+	if (select(fd + 1, &set, nullptr, nullptr, &tv) <= 0)
+		return;
+#else
+	pollfd pfd = { fd, POLLIN, 0 };
+
+	if (::poll(&pfd, 1, timeout_ms) <= 0)
+		return;
+#endif
+
+	if (client_fd < 0)
+	{
+		accept_client();
+		return;
+	}
+
+	char buf[4096];
+	const int n = static_cast<int>(recv(client_fd, buf, sizeof(buf), 0));
+
+	if (n <= 0)
+	{
+		cout << "GDB: client disconnected\n";
+		drop_client();
+		return;
+	}
+
+	in_buf.append(buf, n);
+	process_input();
+}
+
+void GdbStub::process_input()
+{
+	// rozbieramy bufor na pakiety $dane#suma; 0x03 to przerwanie (Ctrl-C)
+	size_t pos = 0;
+
+	while (pos < in_buf.size())
+	{
+		const char c = in_buf[pos];
+
+		if (c == 0x03)
+		{
+			halted = true;
+			send_packet("S02");
+			pos++;
+
+			if (client_fd < 0)
+				return;
+		}
+		else if (c == '$')
+		{
+			const size_t hash = in_buf.find('#', pos);
+
+			if (hash == string::npos || hash + 2 >= in_buf.size())
+				break; // niepelny pakiet
+
+			const string packet = in_buf.substr(pos + 1, hash - pos - 1);
+			const int hi = hex_digit(in_buf[hash + 1]);
+			const int lo = hex_digit(in_buf[hash + 2]);
+			unsigned int sum = 0;
+
+			for (size_t i = 0; i < packet.size(); i++)
+				sum += static_cast<unsigned char>(packet[i]);
+
+			// bez potwierdzen (QStartNoAckMode) suma nie jest sprawdzana
+			const bool valid = no_ack || (hi >= 0 && lo >= 0 && static_cast<unsigned int>(hi << 4 | lo) == (sum & 0xFF));
+
+			pos = hash + 3;
+
+			if (!no_ack && !send_all(client_fd, valid ? "+" : "-", 1))
+			{
+				cout << "GDB: client disconnected\n";
+				drop_client();
+				return;
+			}
+
+			// uszkodzony pakiet klient wysle jeszcze raz
+			if (!valid)
+				continue;
+
+			handle_packet(packet);
+
+			if (client_fd < 0)
+				return;
+
+			// petla emulacji musi policzyc klatke, zanim wykonamy kolejne polecenia
+			if (frame_finished)
+				break;
+		}
+		else if (c == '-' && !no_ack && !last_packet.empty())
+		{
+			// klient nie odebral poprawnie ostatniej odpowiedzi
+			pos++;
+
+			if (!send_all(client_fd, last_packet.c_str(), last_packet.size()))
+			{
+				cout << "GDB: client disconnected\n";
+				drop_client();
+				return;
+			}
+		}
+		else
+		{
+			pos++; // potwierdzenia '+' i smieci
+		}
+	}
+
+	in_buf.erase(0, pos);
+}
+
+void GdbStub::report_stop()
+{
+	if (core.stop_reason() == Chip8Core::STOP_NONE)
+		return;
+
+	halted = true;
+
+	if (client_fd >= 0)
+		send_packet(stop_reply());
+}
+
+void GdbStub::accept_client()
+{
+	const int fd = static_cast<int>(accept(listen_fd, nullptr, nullptr));
+
+	if (fd < 0)
+		return;
+
+	const int yes = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&yes, sizeof(yes));
+#ifdef SO_NOSIGPIPE
+	setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&yes, sizeof(yes));
+#endif
+
+	client_fd = fd;
+	no_ack = false;
+	in_buf.clear();
+	last_packet.clear();
+	halted = true;
+
+	cout << "GDB: client connected\n";
+}
+
+void GdbStub::drop_client()
+{
+	if (client_fd >= 0)
+	{
+		close_socket(client_fd);
+		client_fd = -1;
+	}
+
+	// po odlaczeniu gra dziala dalej bez pulapek
+	core.clear_debug();
+	halted = false;
+}
+
+void GdbStub::send_packet(const std::string& data)
+{
+	if (client_fd < 0)
+		return;
+
+	unsigned int sum = 0;
+
+	for (size_t i = 0; i < data.size(); i++)
+		sum += static_cast<unsigned char>(data[i]);
+
+	char tail[4];
+	snprintf(tail, sizeof(tail), "#%02x", sum & 0xFF);
+
+	last_packet = "$" + data + tail;
+
+	if (!send_all(client_fd, last_packet.c_str(), last_packet.size()))
+	{
+		cout << "GDB: client disconnected\n";
+		drop_client();
+	}
+}
+
+std::string GdbStub::stop_reply() const
+{
+	if (core.stop_reason() == Chip8Core::STOP_WATCHPOINT)
+	{
+		char buf[32];
+		snprintf(buf, sizeof(buf), "T05watch:%x;", core.stop_addr());
+		return buf;
+	}
+
+	return "S05";
+}
+
+unsigned int GdbStub::register_size(unsigned int n) const
+{
+	return (n == 16 || n == 17) ? 2 : 1;
+}
+
+unsigned int GdbStub::register_value(unsigned int n) const
+{
+	const Chip8State& s = core.state();
+
+	if (n < 16)
+		return s.registers[n];
+
+	switch (n)
+	{
+	case 16: return s.address_I;
+	case 17: return s.program_counter;
+	case 18: return s.stack_ptr;
+	case 19: return s.delay_timer;
+	case 20: return s.sound_timer;
+	default: return 0;
+	}
+}
+
+std::string GdbStub::read_registers() const
+{
+	string out;
+
+	for (unsigned int n = 0; n < reg_count; n++)
+		append_hex(out, register_value(n), register_size(n));
+
+	return out;
+}
+
+bool GdbStub::write_register(unsigned int n, unsigned int value)
+{
+	Chip8State& s = core.state();
+
+	if (n < 16)
+		s.registers[n] = value & 0xFF;
+	else if (n == 16)
+		s.address_I = value & 0xFFFF;
+	else if (n == 17)
+		s.program_counter = value & 0xFFFF;
+	else if (n == 18)
+		s.stack_ptr = value & (Chip8State::stack_size - 1);
+	else if (n == 19)
+		s.delay_timer = value & 0xFF;
+	else if (n == 20)
+		s.sound_timer = value & 0xFF;
+	else
+		return false;
+
+	return true;
+}
+
+void GdbStub::handle_packet(const std::string& packet)
+{
+	if (packet.empty())
+	{
+		send_packet("");
+		return;
+	}
+
+	const char* args = packet.c_str() + 1;
+
+	switch (packet[0])
+	{
+	case '?':
+		send_packet("S05");
+		break;
+	case 'g':
+		send_packet(read_registers());
+		break;
+	case 'G':
+	{
+		const char* p = args;
+
+		for (unsigned int n = 0; n < reg_count && strlen(p) >= 2 * register_size(n); n++)
+		{
+			write_register(n, parse_hex_le(p, register_size(n)));
+			p += 2 * register_size(n);
+		}
+
+		send_packet("OK");
+	}
+		break;
+	case 'p':
+	{
+		const unsigned int n = static_cast<unsigned int>(strtoul(args, nullptr, 16));
+
+		if (n >= reg_count)
+		{
+			send_packet("E01");
+			break;
+		}
+
+		string out;
+		append_hex(out, register_value(n), register_size(n));
+		send_packet(out);
+	}
+		break;
+	case 'P':
+	{
+		char* eq = nullptr;
+		const unsigned int n = static_cast<unsigned int>(strtoul(args, &eq, 16));
+
+		if (*eq != '=' || n >= reg_count)
+			send_packet("E01");
+		else
+			send_packet(write_register(n, parse_hex_le(eq + 1, register_size(n))) ? "OK" : "E01");
+	}
+		break;
+	case 'm':
+	{
+		char* comma = nullptr;
+		const unsigned long addr = strtoul(args, &comma, 16);
+
+		if (comma == args || *comma != ',' || addr >= Chip8Core::ram_size)
+		{
+			send_packet("E01");
+			break;
+		}
+
+		const unsigned long len = strtoul(comma + 1, nullptr, 16);
+
+		string out;
+
+		for (unsigned long a = addr; a < addr + len && a < Chip8Core::ram_size; a++)
+			append_hex(out, core.read_memory(static_cast<WORD>(a)), 1);
+
+		send_packet(out);
+	}
+		break;
+	case 'M':
+	{
+		char* comma = nullptr;
+		char* colon = nullptr;
+		const unsigned long addr = strtoul(args, &comma, 16);
+
+		if (comma == args || *comma != ',')
+		{
+			send_packet("E01");
+			break;
+		}
+
+		const unsigned long len = strtoul(comma + 1, &colon, 16);
+
+		if (colon == comma + 1 || *colon != ':' || addr + len > Chip8Core::ram_size || strlen(colon + 1) < 2 * len)
+		{
+			send_packet("E01");
+			break;
+		}
+
+		for (unsigned long i = 0; i < len; i++)
+			core.poke(static_cast<WORD>(addr + i), static_cast<BYTE>(parse_hex_le(colon + 1 + 2 * i, 1)));
+
+		send_packet("OK");
+	}
+		break;
+	case 's':
+		frame_finished = core.single_step();
+		send_packet("S05");
+		break;
+	case 'c':
+		// najpierw wykonujemy instrukcje pod PC, zeby nie zatrzymac sie od razu na tej samej pulapce
+		frame_finished = core.single_step();
+
+		if (core.stop_reason() != Chip8Core::STOP_NONE)
+			send_packet(stop_reply());
+		else
+			halted = false;
+		break;
+	case 'Z':
+	case 'z':
+	{
+		const bool on = packet[0] == 'Z';
+		// Z typ,adres,rozmiar
+		char* end = nullptr;
+		const unsigned long type = strtoul(args, &end, 10);
+
+		if (end == args || *end != ',')
+		{
+			send_packet("E01");
+			break;
+		}
+
+		const char* p = end + 1;
+		const unsigned long addr = strtoul(p, &end, 16);
+
+		if (end == p || *end != ',')
+		{
+			send_packet("E01");
+			break;
+		}
+
+		p = end + 1;
+		const unsigned long kind = strtoul(p, &end, 16);
+
+		if (end == p || addr >= Chip8Core::ram_size)
+		{
+			send_packet("E01");
+			break;
+		}
+
+		if (type == 0 || type == 1)
+		{
+			core.set_breakpoint(static_cast<WORD>(addr), on);
+			send_packet("OK");
+		}
+		else if (type == 2)
+		{
+			core.set_watchpoint(static_cast<WORD>(addr), static_cast<WORD>(kind ? kind : 1), on);
+			send_packet("OK");
+		}
+		else
+		{
+			send_packet(""); // obserwowanie odczytow nie jest obslugiwane
+		}
+	}
+		break;
+	case 'q':
+		if (packet.compare(0, 10, "qSupported") == 0)
+			send_packet("PacketSize=1000;qXfer:features:read+;QStartNoAckMode+");
+		else if (packet == "qAttached")
+			send_packet("1");
+		else if (packet == "qC")
+			send_packet("QC1");
+		else if (packet == "qfThreadInfo")
+			send_packet("m1");
+		else if (packet == "qsThreadInfo")
+			send_packet("l");
+		else if (packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0)
+		{
+			// qXfer:features:read:target.xml:offset,length
+			const char* p = packet.c_str() + 31;
+			char* comma = nullptr;
+			const unsigned long off = strtoul(p, &comma, 16);
+			const string xml = target_xml;
+
+			if (comma == p || *comma != ',' || comma[1] == '\0')
+			{
+				send_packet("E01");
+				break;
+			}
+
+			const unsigned long len = strtoul(comma + 1, nullptr, 16);
+
+			if (off >= xml.size())
+				send_packet("l");
+			else
+			{
+				const string part = xml.substr(off, len);
+				send_packet((off + part.size() >= xml.size() ? "l" : "m") + part);
+			}
+		}
+		else
+			send_packet("");
+		break;
+	case 'Q':
+		if (packet == "QStartNoAckMode")
+		{
+			send_packet("OK");
+			no_ack = true;
+		}
+		else
+			send_packet("");
+		break;
+	case 'H':
+		send_packet("OK");
+		break;
+	case 'D':
+		send_packet("OK");
+		drop_client();
+		break;
+	case 'k':
+		drop_client();
+		break;
+	default:
+		send_packet("");
+		break;
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include <string>
+#include "chip8core.h"
+
+// serwer protokolu GDB Remote Serial Protocol dla jednej instancji rdzenia.
+// Obsluguje odczyt/zapis rejestrow i pamieci, krokowanie, kontynuacje,
+// pulapki (Z0/Z1) i obserwowanie zapisow (Z2). Rejestry: V0-VF, I, PC, SP, DT, ST.
+// Petla emulacji wola poll() raz na klatke i nie wykonuje rdzenia, dopoki
+// is_halted() zwraca true
+class GdbStub
+{
+private:
+	Chip8Core&			core;
+	int					listen_fd		= -1;
+	int					client_fd		= -1;
+	bool				halted			= false;
+	bool				no_ack			= false;
+	bool				frame_finished	= false;
+	std::string			in_buf;
+	std::string			last_packet;	// do ponownego wyslania po '-'
+	std::string			unix_path;
+
+public:
+	explicit GdbStub(Chip8Core& c8);
+	~GdbStub();
+
+	// "1234" albo "host:1234" (TCP), "unix:/sciezka" (gniazdo uniksowe).
+	// Cel jest zatrzymany do czasu polaczenia sie klienta
+	bool listen(const std::string& address);
+	void close();
+
+	// obsluguje polaczenie i przychodzace pakiety; gdy timeout_ms > 0, czeka na dane
+	void poll(int timeout_ms);
+
+	bool is_listening() const { return listen_fd >= 0; }
+	bool is_connected() const { return client_fd >= 0; }
+	bool is_halted() const { return halted; }
+	// krokowanie (s, c) w ostatnim poll() dokonczylo klatke: petla emulacji liczy
+	// ja tak jak klatke z run_frame(). poll() zatrzymuje sie wtedy po tym pakiecie
+	bool frame_done() const { return frame_finished; }
+
+	// rdzen zatrzymal sie na pulapce albo obserwowanym adresie (run_frame() zwrocil false)
+	void report_stop();
+
+private:
+	void accept_client();
+	void drop_client();
+	void process_input();
+	void handle_packet(const std::string& packet);
+	void send_packet(const std::string& data);
+	std::string stop_reply() const;
+	std::string read_registers() const;
+	bool write_register(unsigned int n, unsigned int value);
+	unsigned int register_size(unsigned int n) const;
+	unsigned int register_value(unsigned int n) const;
+};
+
+#endif
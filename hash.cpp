@@ -0,0 +1,67 @@
+#include "hash.h"
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+// odczyt little endian niezalezny od platformy; kompilator sklada to do jednego odczytu
+static inline uint64_t load64(const unsigned char* p)
+{
+	return static_cast<uint64_t>(p[0])
+		| (static_cast<uint64_t>(p[1]) << 8)
+		| (static_cast<uint64_t>(p[2]) << 16)
+		| (static_cast<uint64_t>(p[3]) << 24)
+		| (static_cast<uint64_t>(p[4]) << 32)
+		| (static_cast<uint64_t>(p[5]) << 40)
+		| (static_cast<uint64_t>(p[6]) << 48)
+		| (static_cast<uint64_t>(p[7]) << 56);
+}
+
+static inline uint64_t fmix64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xFF51AFD7ED558CCDULL;
+	k ^= k >> 33;
+	k *= 0xC4CEB9FE1A85EC53ULL;
+	k ^= k >> 33;
+	return k;
+}
+
+uint64_t hash64(const void* data, size_t len, uint64_t seed)
+{
+	const uint64_t c1 = 0x87C37B91114253D5ULL;
+	const uint64_t c2 = 0x4CF5AD432745937FULL;
+
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	uint64_t h = seed ^ (len * c1);
+
+	size_t i = 0;
+
+	for (; i + 8 <= len; i += 8)
+	{
+		uint64_t k = load64(p + i);
+
+		k *= c1;
+		k = rotl64(k, 31);
+		k *= c2;
+
+		h ^= k;
+		h = rotl64(h, 27) * 5 + 0x52DCE729;
+	}
+
+	uint64_t tail = 0;
+
+	for (size_t b = len; b > i; b--)
+		tail = (tail << 8) | p[b - 1];
+
+	if (len > i)
+	{
+		tail *= c1;
+		tail = rotl64(tail, 31);
+		tail *= c2;
+		h ^= tail;
+	}
+
+	return fmix64(h ^ len);
+}
@@ -0,0 +1,11 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// szybki 64-bitowy hasz niekryptograficzny (8 bajtow na krok, w stylu MurmurHash3).
+// Wynik nie zalezy od platformy, wiec nadaje sie do plikow zapisywanych na dysku
+uint64_t hash64(const void* data, size_t len, uint64_t seed = 0);
+
+#endif
@@ -1,9 +1,31 @@
 #include "chip8.h"
+#include "chip8_log.h"
+#include "config.h"
+#include "wall.h"
+#ifdef HAVE_VLD
 #include "vld.h"
+#endif
 
 int main(int argc, char *argv[])
 {
-	Chip8 emu("../settings.ini");
+	Chip8Config cfg;
+	load_config("../settings.ini", cfg);
 
-	return emu.game_loop();
+	int result;
+
+	if (cfg.wall)
+	{
+		Chip8Wall wall(cfg);
+		result = wall.game_loop();
+	}
+	else
+	{
+		Chip8 emu("../settings.ini");
+		result = emu.game_loop();
+	}
+
+	// watek dziennika konczymy jawnie, a nie w destruktorze biblioteki
+	log_stop();
+
+	return result;
 }
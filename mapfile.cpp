@@ -0,0 +1,206 @@
+#include "mapfile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+static bool map_file(HANDLE file, size_t size, bool writable, void*& mapping, unsigned char*& ptr)
+{
+	const unsigned long long size64 = size;
+
+	mapping = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+		static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64), nullptr);
+
+	if (!mapping)
+		return false;
+
+	ptr = static_cast<unsigned char*>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size));
+
+	return ptr != nullptr;
+}
+
+bool MappedFile::open_read(const std::string& path)
+{
+	close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || !map_file(file, static_cast<size_t>(size.QuadPart), false, mapping, ptr))
+	{
+		close();
+		return false;
+	}
+
+	len = static_cast<size_t>(size.QuadPart);
+	writable = false;
+
+	return true;
+}
+
+bool MappedFile::open_write(const std::string& path, size_t size)
+{
+	close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		file = nullptr;
+		return false;
+	}
+
+	if (size == 0 || !map_file(file, size, true, mapping, ptr))
+	{
+		close();
+		return false;
+	}
+
+	len = size;
+	writable = true;
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (ptr)
+		UnmapViewOfFile(ptr);
+
+	if (mapping)
+		CloseHandle(mapping);
+
+	if (file)
+		CloseHandle(file);
+
+	ptr = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	len = 0;
+}
+
+bool MappedFile::sync(bool wait, size_t offset, size_t length)
+{
+	if (!ptr || !writable || offset >= len)
+		return false;
+
+	if (!length || length > len - offset)
+		length = len - offset;
+
+	if (!FlushViewOfFile(ptr + offset, length))
+		return false;
+
+	return !wait || FlushFileBuffers(file);
+}
+
+#else
+
+bool MappedFile::open_read(const std::string& path)
+{
+	close();
+
+	fd = ::open(path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat sb;
+
+	if (fstat(fd, &sb) != 0 || sb.st_size <= 0)
+	{
+		close();
+		return false;
+	}
+
+	void* p = mmap(nullptr, static_cast<size_t>(sb.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+	if (p == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	ptr = static_cast<unsigned char*>(p);
+	len = static_cast<size_t>(sb.st_size);
+	writable = false;
+
+	return true;
+}
+
+bool MappedFile::open_write(const std::string& path, size_t size)
+{
+	close();
+
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+	if (fd < 0)
+		return false;
+
+	struct stat sb;
+
+	if (size == 0 || fstat(fd, &sb) != 0 || (static_cast<size_t>(sb.st_size) < size && ftruncate(fd, size) != 0))
+	{
+		close();
+		return false;
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+	if (p == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	ptr = static_cast<unsigned char*>(p);
+	len = size;
+	writable = true;
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (ptr)
+		munmap(ptr, len);
+
+	if (fd >= 0)
+		::close(fd);
+
+	ptr = nullptr;
+	len = 0;
+	fd = -1;
+}
+
+bool MappedFile::sync(bool wait, size_t offset, size_t length)
+{
+	if (!ptr || !writable || offset >= len)
+		return false;
+
+	if (!length || length > len - offset)
+		length = len - offset;
+
+	return msync(ptr + offset, length, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <cstddef>
+#include <string>
+
+// plik zmapowany w pamieci (mmap / MapViewOfFile). Do odczytu albo do zapisu
+// z ustalonym rozmiarem; zamykany w destruktorze
+class MappedFile
+{
+private:
+	unsigned char*		ptr			= nullptr;
+	size_t				len			= 0;
+	bool				writable	= false;
+#ifdef _WIN32
+	void*				file		= nullptr;
+	void*				mapping		= nullptr;
+#else
+	int					fd			= -1;
+#endif
+
+public:
+	MappedFile() {}
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// caly plik tylko do odczytu
+	bool open_read(const std::string& path);
+	// plik do odczytu i zapisu o rozmiarze size (tworzony albo powiekszany)
+	bool open_write(const std::string& path, size_t size);
+	void close();
+
+	bool is_open() const { return ptr != nullptr; }
+	unsigned char* data() { return ptr; }
+	const unsigned char* data() const { return ptr; }
+	size_t size() const { return len; }
+
+	// zleca zapis zmienionych stron na dysk; wait = false nie czeka na zakonczenie.
+	// length = 0 - do konca pliku; offset musi byc wielokrotnoscia rozmiaru strony
+	bool sync(bool wait, size_t offset = 0, size_t length = 0);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include "movie.h"
+#include <fstream>
+#include <cstdio> // snprintf
+#include <cstdlib> // strtoul
+
+using namespace std;
+
+bool InputMovie::load(const std::string& path)
+{
+	ifstream file(path);
+
+	if (!file)
+		return false;
+
+	masks.clear();
+
+	string line;
+
+	while (getline(file, line))
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		char* end = nullptr;
+		const unsigned long mask = strtoul(line.c_str(), &end, 16);
+
+		if (end == line.c_str() || mask > 0xFFFF)
+			return false;
+
+		unsigned long repeat = 1;
+
+		if (*end == '*')
+			repeat = strtoul(end + 1, nullptr, 10);
+
+		masks.insert(masks.end(), repeat, static_cast<WORD>(mask));
+	}
+
+	return true;
+}
+
+bool InputMovie::save(const std::string& path) const
+{
+	ofstream file(path);
+
+	if (!file)
+		return false;
+
+	file << "# chip8 input movie, " << masks.size() << " frames\n";
+
+	char buf[32];
+
+	for (size_t i = 0; i < masks.size();)
+	{
+		// kolejne jednakowe klatki zapisujemy jako jedna linie z powtorzeniem
+		size_t run = 1;
+
+		while (i + run < masks.size() && masks[i + run] == masks[i])
+			run++;
+
+		if (run > 1)
+			snprintf(buf, sizeof(buf), "%04X*%u\n", masks[i], static_cast<unsigned int>(run));
+		else
+			snprintf(buf, sizeof(buf), "%04X\n", masks[i]);
+
+		file << buf;
+		i += run;
+	}
+
+	return static_cast<bool>(file);
+}
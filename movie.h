@@ -0,0 +1,28 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <string>
+#include <vector>
+#include "chip8core.h"
+
+// nagranie wejscia: maska wcisnietych klawiszy (bit i = klawisz i) dla kolejnych klatek.
+// Plik tekstowy, jedna klatka na linie w hex, np. "0010", opcjonalnie z powtorzeniem
+// "0010*30"; linie zaczynajace sie od '#' sa komentarzami
+class InputMovie
+{
+private:
+	std::vector<WORD>	masks;
+
+public:
+	bool load(const std::string& path);
+	bool save(const std::string& path) const;
+
+	void clear() { masks.clear(); }
+	void push(WORD mask) { masks.push_back(mask); }
+	size_t size() const { return masks.size(); }
+
+	// po koncu nagrania wszystkie klawisze sa puszczone
+	WORD at(size_t frame) const { return frame < masks.size() ? masks[frame] : 0; }
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include "netplay.h"
+#include "hash.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib> // strtoul
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#define close_socket closesocket
+#else
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#define close_socket ::close
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+static const char net_magic[4] = { 'C', '8', 'N', 'P' };
+static const unsigned int max_inputs = 64;
+static const unsigned int no_rollback = ~0u;
+
+// pakiet: wszystkie nasze klawisze, ktorych druga strona jeszcze nie potwierdzila,
+// wiec zgubiony pakiet nie wymaga ponawiania (liczby little endian)
+struct NetPacket
+{
+	char				magic[4];
+	uint32_t			session;
+	uint32_t			ack;		// znamy wejscie nadawcy dla klatek < ack
+	uint32_t			first;		// klatka inputs[0]
+	uint16_t			count;
+	uint16_t			reserved;
+	uint16_t			inputs[max_inputs];
+};
+
+static const size_t packet_header = offsetof(NetPacket, inputs);
+
+static unsigned long long now_ns()
+{
+	return static_cast<unsigned long long>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+// "port", "host:port" albo "unix:/sciezka" -> sockaddr
+static bool parse_address(const std::string& address, vector<char>& out, int& family)
+{
+#ifndef _WIN32
+	if (address.compare(0, 5, "unix:") == 0)
+	{
+		sockaddr_un sa;
+		memset(&sa, 0, sizeof(sa));
+		sa.sun_family = AF_UNIX;
+
+		if (address.size() - 5 >= sizeof(sa.sun_path))
+			return false;
+
+		strncpy(sa.sun_path, address.c_str() + 5, sizeof(sa.sun_path) - 1);
+		out.assign(reinterpret_cast<char*>(&sa), reinterpret_cast<char*>(&sa) + sizeof(sa));
+		family = AF_UNIX;
+
+		return true;
+	}
+#endif
+
+	string host = "127.0.0.1";
+	string port = address;
+	const size_t colon = address.rfind(':');
+
+	if (colon != string::npos)
+	{
+		host = address.substr(0, colon);
+		port = address.substr(colon + 1);
+	}
+
+	sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(static_cast<unsigned short>(strtoul(port.c_str(), nullptr, 10)));
+	sa.sin_addr.s_addr = inet_addr(host.c_str());
+
+	if (sa.sin_port == 0 || sa.sin_addr.s_addr == INADDR_NONE)
+		return false;
+
+	out.assign(reinterpret_cast<char*>(&sa), reinterpret_cast<char*>(&sa) + sizeof(sa));
+	family = AF_INET;
+
+	return true;
+}
+
+Netplay::Netplay(Chip8Core& c8)
+	: core(c8), snapshots(window), rollback_from(no_rollback)
+{
+	memset(local_input, 0, sizeof(local_input));
+	memset(remote_input, 0, sizeof(remote_input));
+	memset(used_input, 0, sizeof(used_input));
+}
+
+Netplay::~Netplay()
+{
+	close();
+}
+
+bool Netplay::open(const std::string& local, const std::string& peer, unsigned int latency_ms)
+{
+	close();
+
+#ifdef _WIN32
+	WSADATA wsa;
+	WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+
+	vector<char> local_addr;
+	int local_family = 0, peer_family = 0;
+
+	if (!parse_address(local, local_addr, local_family) || !parse_address(peer, peer_addr, peer_family) || local_family != peer_family)
+	{
+		cerr << "Netplay: bad address " << local << " / " << peer << endl;
+		return false;
+	}
+
+#ifndef _WIN32
+	if (local_family == AF_UNIX)
+	{
+		unix_path = local.substr(5);
+		unlink(unix_path.c_str());
+	}
+#endif
+
+	fd = static_cast<int>(socket(local_family, SOCK_DGRAM, 0));
+
+	if (fd < 0 || ::bind(fd, reinterpret_cast<const sockaddr*>(&local_addr[0]), static_cast<int>(local_addr.size())) != 0)
+	{
+		cerr << "Netplay: can't bind " << local << endl;
+		close();
+		return false;
+	}
+
+#ifdef _WIN32
+	u_long nonblocking = 1;
+	ioctlsocket(fd, FIONBIO, &nonblocking);
+#else
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	// obie strony musza miec te sama gre, ziarno i model czasu
+	const uint64_t image = hash64(core.image(), Chip8Core::ram_size);
+	const uint32_t params[] = { static_cast<uint32_t>(image), static_cast<uint32_t>(image >> 32),
+		core.get_seed(), core.get_cycles_per_frame(), static_cast<uint32_t>(core.get_timing()) };
+	session = static_cast<uint32_t>(hash64(params, sizeof(params)));
+
+	delay_ms = latency_ms;
+	frame = 0;
+	remote_known = 0;
+	peer_ack = 0;
+	rollback_from = no_rollback;
+
+	cout << "Netplay: " << local << " <-> " << peer << ", session " << hex << session << dec;
+
+	if (delay_ms)
+		cout << ", " << delay_ms << " ms added latency";
+
+	cout << endl;
+
+	return true;
+}
+
+void Netplay::close()
+{
+	if (fd >= 0)
+		close_socket(fd);
+
+#ifndef _WIN32
+	if (!unix_path.empty())
+		unlink(unix_path.c_str());
+#endif
+
+	fd = -1;
+	unix_path.clear();
+	outgoing.clear();
+}
+
+WORD Netplay::remote_for(unsigned int f) const
+{
+	if (f < remote_known)
+		return remote_input[f % window];
+
+	// przewidywanie: drugi gracz trzyma te same klawisze co ostatnio
+	return remote_known ? remote_input[(remote_known - 1) % window] : 0;
+}
+
+void Netplay::simulate(unsigned int f)
+{
+	snapshots[f % window] = core.state();
+	used_input[f % window] = remote_for(f);
+
+	core.set_keys(local_input[f % window] | used_input[f % window]);
+	core.run_frame();
+}
+
+void Netplay::receive()
+{
+	NetPacket pkt;
+
+	for (;;)
+	{
+		const int len = static_cast<int>(recv(fd, reinterpret_cast<char*>(&pkt), sizeof(pkt), 0));
+
+		if (len < static_cast<int>(packet_header))
+			return; // brak danych (albo smiec)
+
+		if (memcmp(pkt.magic, net_magic, sizeof(net_magic)) != 0 || pkt.count > max_inputs
+			|| static_cast<size_t>(len) < packet_header + pkt.count * sizeof(uint16_t))
+		{
+			continue;
+		}
+
+		if (pkt.session != session)
+		{
+			if (!session_warned)
+				cerr << "Netplay: peer runs a different game, seed or timing model\n";
+
+			session_warned = true;
+			continue;
+		}
+
+		if (pkt.ack > peer_ack && pkt.ack <= frame)
+			peer_ack = pkt.ack;
+
+		// przyjmujemy tylko ciagle przedluzenie znanego wejscia
+		for (unsigned int i = 0; i < pkt.count; i++)
+		{
+			const unsigned int f = pkt.first + i;
+
+			if (f < remote_known)
+				continue;
+
+			if (f > remote_known || f >= frame + window / 2)
+				break;
+
+			remote_input[f % window] = pkt.inputs[i];
+			remote_known++;
+
+			if (f < frame && pkt.inputs[i] != used_input[f % window] && f < rollback_from)
+				rollback_from = f;
+		}
+	}
+}
+
+void Netplay::send_inputs()
+{
+	NetPacket pkt;
+	memcpy(pkt.magic, net_magic, sizeof(net_magic));
+	pkt.session = session;
+	pkt.ack = remote_known;
+	pkt.first = frame > peer_ack + max_inputs ? frame - max_inputs : peer_ack;
+	pkt.count = static_cast<uint16_t>(frame - pkt.first);
+	pkt.reserved = 0;
+
+	for (unsigned int i = 0; i < pkt.count; i++)
+		pkt.inputs[i] = local_input[(pkt.first + i) % window];
+
+	const char* data = reinterpret_cast<const char*>(&pkt);
+	const size_t len = packet_header + pkt.count * sizeof(uint16_t);
+
+	if (delay_ms)
+	{
+		Delayed d;
+		d.due_ns = now_ns() + delay_ms * 1000000ULL;
+		d.data.assign(data, data + len);
+		outgoing.push_back(d);
+	}
+	else
+		sendto(fd, data, static_cast<int>(len), 0, reinterpret_cast<const sockaddr*>(&peer_addr[0]), static_cast<int>(peer_addr.size()));
+}
+
+void Netplay::flush_outgoing()
+{
+	const unsigned long long now = now_ns();
+
+	while (!outgoing.empty() && outgoing.front().due_ns <= now)
+	{
+		const vector<char>& d = outgoing.front().data;
+		sendto(fd, &d[0], static_cast<int>(d.size()), 0, reinterpret_cast<const sockaddr*>(&peer_addr[0]), static_cast<int>(peer_addr.size()));
+		outgoing.pop_front();
+	}
+}
+
+void Netplay::roll_back()
+{
+	if (rollback_from >= frame)
+	{
+		rollback_from = no_rollback;
+		return;
+	}
+
+	const auto t0 = steady_clock::now();
+	const unsigned int depth = frame - rollback_from;
+
+	core.restore_state(snapshots[rollback_from % window]);
+
+	for (unsigned int f = rollback_from; f < frame; f++)
+		simulate(f);
+
+	resim_ns += duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+	rollbacks++;
+	rollback_frames += depth;
+
+	if (depth > max_depth)
+		max_depth = depth;
+
+	rollback_from = no_rollback;
+}
+
+void Netplay::poll()
+{
+	if (fd < 0)
+		return;
+
+	flush_outgoing();
+	receive();
+	roll_back();
+	send_inputs();
+}
+
+bool Netplay::advance(WORD local_mask)
+{
+	if (fd < 0)
+		return false;
+
+	flush_outgoing();
+	receive();
+	roll_back();
+
+	// za daleko przed drugim graczem - czekamy, az dojdzie jego wejscie
+	if (frame >= remote_known + max_prediction)
+	{
+		stalls++;
+		send_inputs();
+		return false;
+	}
+
+	local_input[frame % window] = local_mask;
+	simulate(frame);
+	frame++;
+	frames_run++;
+
+	send_inputs();
+
+	return true;
+}
+
+const Chip8State& Netplay::state_after(unsigned int f) const
+{
+	return f + 1 < frame ? snapshots[(f + 1) % window] : core.state();
+}
+
+std::string Netplay::report() const
+{
+	char buf[192];
+
+	snprintf(buf, sizeof(buf), "netplay: %llu frames, %llu rollbacks (avg depth %.1f, max %u), resim %.2f us/frame, %llu stalls",
+		frames_run, rollbacks, rollbacks ? static_cast<double>(rollback_frames) / rollbacks : 0.0, max_depth,
+		frames_run ? resim_ns * 1e-3 / frames_run : 0.0, stalls);
+
+	return buf;
+}
@@ -0,0 +1,100 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "chip8core.h"
+
+// gra we dwoje przez siec z cofaniem (rollback). Oba procesy wykonuja te sama
+// gre z tym samym ziarnem; co klatke wysylaja swoja 16-bitowa maske klawiszy
+// (przez UDP albo uniksowe gniazdo datagramowe), a klawiatura gry to suma
+// masek obu graczy. Brakujace wejscie drugiego gracza jest przewidywane
+// (powtarzamy ostatnie znane); gdy prawdziwe okaze sie inne, wracamy do stanu
+// z tamtej klatki i wykonujemy klatki od nowa. Stany sa plaskimi kopiami
+// Chip8State, a odtworzenie przepisuje tylko zmienione strony pamieci
+class Netplay
+{
+public:
+	// na tyle klatek mozemy wyprzedzic ostatnie potwierdzone wejscie; potem czekamy
+	static const unsigned int	max_prediction	= 15;
+
+private:
+	static const unsigned int	window			= 64; // potega dwojki, > 2 * max_prediction
+
+	struct Delayed
+	{
+		unsigned long long		due_ns;
+		std::vector<char>		data;
+	};
+
+	Chip8Core&					core;
+	int							fd				= -1;
+	std::vector<char>			peer_addr;		// sockaddr drugiej strony
+	std::string					unix_path;
+	uint32_t					session			= 0;
+	unsigned int				delay_ms		= 0;
+	std::deque<Delayed>			outgoing;		// pakiety wstrzymane sztucznym opoznieniem
+
+	// klatka f uzywa indeksu f % window
+	std::vector<Chip8State>		snapshots;			// stan na poczatku klatki
+	WORD						local_input[window];
+	WORD						remote_input[window];
+	WORD						used_input[window];	// wejscie drugiego gracza uzyte przy symulacji
+	unsigned int				frame			= 0;	// nastepna klatka do wykonania
+	unsigned int				remote_known	= 0;	// znamy wejscie drugiego gracza dla klatek < remote_known
+	unsigned int				peer_ack		= 0;	// drugi gracz zna nasze wejscie dla klatek < peer_ack
+	unsigned int				rollback_from;			// najwczesniejsza klatka z blednym przewidywaniem
+	bool						session_warned	= false;
+
+	// statystyka
+	unsigned long long			frames_run		= 0;
+	unsigned long long			rollbacks		= 0;
+	unsigned long long			rollback_frames	= 0;
+	unsigned int				max_depth		= 0;
+	unsigned long long			resim_ns		= 0;
+	unsigned long long			stalls			= 0;
+
+public:
+	explicit Netplay(Chip8Core& c8);
+	~Netplay();
+
+	Netplay(const Netplay&) = delete;
+	Netplay& operator=(const Netplay&) = delete;
+
+	// local: "port", "host:port" albo "unix:/sciezka" (nasze gniazdo), peer: adres drugiej
+	// strony w tej samej postaci. Gra musi byc juz wczytana, a ziarno i model czasu
+	// ustawione - z nich liczony jest identyfikator sesji, ktory musi sie zgadzac
+	bool open(const std::string& local, const std::string& peer, unsigned int latency_ms);
+	void close();
+	bool is_open() const { return fd >= 0; }
+
+	// wysyla/odbiera pakiety i ewentualnie cofa gre; potem wykonuje jedna klatke
+	// z podanymi klawiszami tego gracza. false = czekamy na drugiego gracza
+	// (za duzo niepotwierdzonych klatek), klatka nie zostala wykonana
+	bool advance(WORD local_mask);
+	// wymiana pakietow i ewentualne cofniecie, bez nowej klatki (np. przy zakonczeniu)
+	void poll();
+
+	unsigned int current_frame() const { return frame; }
+	// klatki < confirmed_frames() maja juz ostateczny przebieg
+	unsigned int confirmed_frames() const { return remote_known < frame ? remote_known : frame; }
+	// drugi gracz zna wszystkie nasze klatki < acked_frames()
+	unsigned int acked_frames() const { return peer_ack; }
+	// stan po klatce f (f < current_frame(), najwyzej window klatek wstecz)
+	const Chip8State& state_after(unsigned int f) const;
+
+	// np. "netplay: 600 frames, 12 rollbacks (avg depth 3.1, max 5), resim 4.1 us/frame, 0 stalls"
+	std::string report() const;
+
+private:
+	void receive();
+	void send_inputs();
+	void flush_outgoing();
+	void roll_back();
+	WORD remote_for(unsigned int f) const;
+	void simulate(unsigned int f);
+};
+
+#endif
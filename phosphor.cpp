@@ -0,0 +1,102 @@
+#include "phosphor.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CHIP8_HAVE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define CHIP8_HAVE_NEON
+#endif
+
+Phosphor::Phosphor()
+{
+	clear();
+}
+
+void Phosphor::set_decay(unsigned int percent)
+{
+	if (percent > 99)
+		percent = 99;
+
+	keep = percent * 256 / 100;
+}
+
+void Phosphor::clear()
+{
+	memset(intensity, 0, sizeof(intensity));
+}
+
+void Phosphor::update(const BYTE* screen)
+{
+	// jasnosc = zapalony ? 255 : jasnosc * keep / 256
+#if defined(CHIP8_HAVE_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi8(-1);
+	const __m128i k = _mm_set1_epi16(static_cast<short>(keep));
+
+	for (int i = 0; i < pixels; i += 16)
+	{
+		const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(intensity + i));
+		const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(screen + i));
+
+		const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(v, zero), k), 8);
+		const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(v, zero), k), 8);
+		const __m128i lit = _mm_andnot_si128(_mm_cmpeq_epi8(s, zero), ones);
+
+		_mm_store_si128(reinterpret_cast<__m128i*>(intensity + i), _mm_or_si128(_mm_packus_epi16(lo, hi), lit));
+	}
+#elif defined(CHIP8_HAVE_NEON)
+	const uint8x8_t k = vdup_n_u8(static_cast<uint8_t>(keep));
+
+	for (int i = 0; i < pixels; i += 16)
+	{
+		const uint8x16_t v = vld1q_u8(intensity + i);
+		const uint8x16_t s = vld1q_u8(screen + i);
+
+		const uint8x8_t lo = vshrn_n_u16(vmull_u8(vget_low_u8(v), k), 8);
+		const uint8x8_t hi = vshrn_n_u16(vmull_u8(vget_high_u8(v), k), 8);
+		const uint8x16_t lit = vtstq_u8(s, s);
+
+		vst1q_u8(intensity + i, vorrq_u8(vcombine_u8(lo, hi), lit));
+	}
+#else
+	for (int i = 0; i < pixels; i++)
+		intensity[i] = screen[i] ? 255 : static_cast<BYTE>(intensity[i] * keep >> 8);
+#endif
+}
+
+void Phosphor::to_argb(uint32_t* out, int pitch) const
+{
+#if defined(CHIP8_HAVE_SSE2)
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+	for (int y = 0; y < height; y++)
+	{
+		const BYTE* src = intensity + y * width;
+		__m128i* dst = reinterpret_cast<__m128i*>(reinterpret_cast<BYTE*>(out) + y * pitch);
+
+		for (int x = 0; x < width; x += 16)
+		{
+			// bajt v -> 0xFFvvvvvv
+			const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(src + x));
+			const __m128i lo = _mm_unpacklo_epi8(v, v);
+			const __m128i hi = _mm_unpackhi_epi8(v, v);
+
+			_mm_storeu_si128(dst++, _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+			_mm_storeu_si128(dst++, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+			_mm_storeu_si128(dst++, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+			_mm_storeu_si128(dst++, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+		}
+	}
+#else
+	for (int y = 0; y < height; y++)
+	{
+		const BYTE* src = intensity + y * width;
+		uint32_t* dst = reinterpret_cast<uint32_t*>(reinterpret_cast<BYTE*>(out) + y * pitch);
+
+		for (int x = 0; x < width; x++)
+			dst[x] = 0xFF000000u | src[x] * 0x010101u;
+	}
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef PHOSPHOR_H
+#define PHOSPHOR_H
+
+#include <cstdint>
+#include "chip8core.h"
+
+// poswiata luminoforu zmniejszajaca migotanie gier, ktore kasuja i rysuja
+// sprite'y przez XOR: kazdy piksel ma jasnosc, ktora z kazda klatka maleje
+// o staly procent, a zapalony piksel ustawia ja na pelna. Liczone wektorowo
+// (SSE2 / NEON, bez nich zwykla petla) na obrazie 64x32 przed wyslaniem
+// tekstury, wiec koszt nie zalezy od pixel_size
+class Phosphor
+{
+public:
+	static const int	width			= Chip8Core::width;
+	static const int	height			= Chip8Core::height;
+	static const int	pixels			= width * height;
+
+private:
+	alignas(16) BYTE	intensity[pixels];
+	unsigned int		keep			= 0;	// ulamek jasnosci zostajacy po klatce, /256
+
+public:
+	Phosphor();
+
+	// decay - procent jasnosci zostajacy po jednej klatce (0 = bez poswiaty, do 99)
+	void set_decay(unsigned int percent);
+	bool enabled() const { return keep != 0; }
+
+	void clear();
+	// kolejna klatka obrazu (bajt na piksel, 0 = zgaszony, wiersze po width)
+	void update(const BYTE* screen);
+	// jasnosci jako szarosci ARGB8888; pitch w bajtach
+	void to_argb(uint32_t* out, int pitch) const;
+
+	const BYTE* data() const { return intensity; }
+};
+
+#endif
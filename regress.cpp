@@ -0,0 +1,344 @@
+#include "regress.h"
+#include "hash.h"
+#include "romfile.h"
+#include "analysis.h"
+#include "config.h" // parse_timing
+#include <algorithm> // sort
+#include <atomic>
+#include <cinttypes> // PRIx64
+#include <cstdio>
+#include <cstring> // strcmp
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+	#include <io.h> // _findfirst
+#else
+	#include <dirent.h>
+#endif
+
+using namespace std;
+
+static const char golden_magic[] = "# chip8 golden v1";
+
+bool GoldenStream::load(const std::string& path)
+{
+	ifstream file(path);
+
+	if (!file)
+		return false;
+
+	string line;
+
+	if (!getline(file, line) || line.compare(0, sizeof(golden_magic) - 1, golden_magic) != 0)
+		return false;
+
+	hashes.clear();
+
+	while (getline(file, line))
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+
+		if (line.empty())
+			continue;
+
+		unsigned int value = 0;
+		uint64_t h = 0;
+		char name[16];
+
+		if (sscanf(line.c_str(), "cycles_per_frame %u", &value) == 1)
+			cycles_per_frame = value;
+		else if (sscanf(line.c_str(), "timing %15s", name) == 1)
+		{
+			if (!parse_timing(name, timing))
+				return false;
+		}
+		else if (sscanf(line.c_str(), "seed %u", &value) == 1)
+			seed = value;
+		else if (sscanf(line.c_str(), "regs %u", &value) == 1)
+			with_regs = value != 0;
+		else if (sscanf(line.c_str(), "%" SCNx64, &h) == 1)
+			hashes.push_back(h);
+		else
+			return false;
+	}
+
+	return true;
+}
+
+bool GoldenStream::save(const std::string& path) const
+{
+	FILE* f = fopen(path.c_str(), "w");
+
+	if (!f)
+		return false;
+
+	fprintf(f, "%s\ncycles_per_frame %u\nseed %u\nregs %u\n", golden_magic, cycles_per_frame, seed, with_regs ? 1 : 0);
+
+	// stare wzorce nie maja tej linii i oznaczaja staly model czasu
+	if (timing == Chip8Core::TIMING_VIP)
+		fprintf(f, "timing vip\n");
+
+	for (size_t i = 0; i < hashes.size(); i++)
+		fprintf(f, "%016" PRIx64 "\n", hashes[i]);
+
+	return fclose(f) == 0;
+}
+
+uint64_t frame_hash(const Chip8State& s, bool with_regs)
+{
+	uint64_t seed = 0;
+
+	if (with_regs)
+	{
+		// pakujemy rejestry recznie, zeby hasz nie zalezal od wyrownania struktury
+		BYTE regs[Chip8State::reg_size + 2 * Chip8State::stack_size + 7];
+		BYTE* p = regs;
+
+		memcpy(p, s.registers, Chip8State::reg_size);
+		p += Chip8State::reg_size;
+
+		for (int i = 0; i < Chip8State::stack_size; i++)
+		{
+			*p++ = s.stack[i] & 0xFF;
+			*p++ = s.stack[i] >> 8;
+		}
+
+		*p++ = s.address_I & 0xFF;
+		*p++ = s.address_I >> 8;
+		*p++ = s.program_counter & 0xFF;
+		*p++ = s.program_counter >> 8;
+		*p++ = s.stack_ptr;
+		*p++ = s.delay_timer;
+		*p++ = s.sound_timer;
+
+		seed = hash64(regs, sizeof(regs));
+	}
+
+	return hash64(&s.screen[0][0], Chip8Core::height * Chip8Core::pitch(), seed);
+}
+
+void run_hash_stream(Chip8Core& core, const InputMovie& movie, size_t frames, bool with_regs, std::vector<uint64_t>& out)
+{
+	core.reset();
+
+	out.resize(frames);
+
+	for (size_t frame = 0; frame < frames; frame++)
+	{
+		core.set_keys(movie.at(frame));
+		core.run_frame();
+		out[frame] = frame_hash(core, with_regs);
+	}
+}
+
+std::string fusion_report(const Chip8Core& core)
+{
+	const Chip8Core::FusionStats& s = core.fusion_stats();
+	const double total = s.instructions ? static_cast<double>(s.instructions) : 1.0;
+
+	unsigned long long covered = 0;
+	string parts;
+	char buf[96];
+
+	for (int k = Chip8Core::FUSE_ANNN_DXYN; k < Chip8Core::FUSE_KINDS; k++)
+	{
+		covered += s.covered[k];
+		snprintf(buf, sizeof(buf), "%s%s %.1f%%", parts.empty() ? "" : ", ", Chip8Core::fusion_name(k), 100.0 * s.covered[k] / total);
+		parts += buf;
+	}
+
+	snprintf(buf, sizeof(buf), "fusion %.1f%% of %llu instructions (", 100.0 * covered / total, s.instructions);
+
+	return buf + parts + ")";
+}
+
+long first_divergence(const std::vector<uint64_t>& expected, const std::vector<uint64_t>& actual)
+{
+	const size_t n = min(expected.size(), actual.size());
+
+	for (size_t i = 0; i < n; i++)
+	{
+		if (expected[i] != actual[i])
+			return static_cast<long>(i);
+	}
+
+	if (expected.size() != actual.size())
+		return static_cast<long>(n);
+
+	return -1;
+}
+
+// nazwy plikow z katalogu o danym rozszerzeniu (bez rozszerzenia), posortowane
+static void list_dir(const std::string& dir, const std::string& ext, std::vector<std::string>& names)
+{
+	names.clear();
+
+#ifdef _WIN32
+	_finddata_t fd;
+	const intptr_t h = _findfirst((dir + "/*" + ext).c_str(), &fd);
+
+	if (h != -1)
+	{
+		do
+		{
+			const string name = fd.name;
+			names.push_back(name.substr(0, name.size() - ext.size()));
+		} while (_findnext(h, &fd) == 0);
+
+		_findclose(h);
+	}
+#else
+	DIR* d = opendir(dir.c_str());
+
+	if (!d)
+		return;
+
+	while (dirent* e = readdir(d))
+	{
+		const string name = e->d_name;
+
+		if (name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0)
+			names.push_back(name.substr(0, name.size() - ext.size()));
+	}
+
+	closedir(d);
+#endif
+
+	sort(names.begin(), names.end());
+}
+
+int run_corpus(const std::string& dir, const CorpusOptions& opt)
+{
+	vector<string> names;
+	list_dir(dir, ".ch8", names);
+
+	if (names.empty())
+	{
+		cerr << "No *.ch8 files in " << dir << endl;
+		return 1;
+	}
+
+	vector<string> results(names.size());
+	vector<char> failed(names.size(), 0);
+	atomic<size_t> next(0);
+
+	auto worker = [&]()
+	{
+		Chip8Core core;
+		core.set_fusion(opt.fusion);
+		AnalysisCache cache(opt.analysis_cache);
+		vector<uint64_t> actual;
+
+		for (size_t i = next++; i < names.size(); i = next++)
+		{
+			const string base = dir + "/" + names[i];
+			char msg[256];
+
+			vector<BYTE> rom;
+
+			if (!read_rom_file(base + ".ch8", rom) || !core.load_rom(rom.empty() ? nullptr : &rom[0], rom.size()))
+			{
+				results[i] = "FAIL " + names[i] + ": can't load ROM";
+				failed[i] = 1;
+				continue;
+			}
+
+			cache.load(core);
+
+			InputMovie movie;
+			movie.load(base + ".movie");
+
+			GoldenStream golden;
+
+			if (opt.update)
+			{
+				golden.cycles_per_frame = opt.cycles_per_frame;
+				golden.timing = opt.timing;
+				golden.seed = opt.seed ? opt.seed : 1;
+				golden.with_regs = opt.with_regs;
+
+				core.set_cycles_per_frame(golden.cycles_per_frame);
+				core.set_timing(golden.timing);
+				core.set_seed(golden.seed);
+				run_hash_stream(core, movie, movie.size() ? movie.size() : opt.default_frames, golden.with_regs, golden.hashes);
+				cache.store(core);
+
+				if (golden.save(base + ".golden"))
+				{
+					snprintf(msg, sizeof(msg), "UPDATED %s (%u frames)", names[i].c_str(), static_cast<unsigned int>(golden.hashes.size()));
+				}
+				else
+				{
+					snprintf(msg, sizeof(msg), "FAIL %s: can't write golden file", names[i].c_str());
+					failed[i] = 1;
+				}
+
+				results[i] = msg;
+				continue;
+			}
+
+			if (!golden.load(base + ".golden"))
+			{
+				results[i] = "FAIL " + names[i] + ": missing or corrupt golden file";
+				failed[i] = 1;
+				continue;
+			}
+
+			core.set_cycles_per_frame(golden.cycles_per_frame);
+			core.set_timing(golden.timing);
+			core.set_seed(golden.seed);
+			run_hash_stream(core, movie, golden.hashes.size(), golden.with_regs, actual);
+			cache.store(core);
+
+			const long diverged = first_divergence(golden.hashes, actual);
+
+			if (diverged < 0)
+			{
+				snprintf(msg, sizeof(msg), "PASS %s (%u frames)", names[i].c_str(), static_cast<unsigned int>(actual.size()));
+			}
+			else
+			{
+				snprintf(msg, sizeof(msg), "FAIL %s: first divergence at frame %ld (expected %016" PRIx64 ", got %016" PRIx64 ")",
+					names[i].c_str(), diverged, golden.hashes[diverged], actual[diverged]);
+				failed[i] = 1;
+			}
+
+			results[i] = msg;
+
+			if (opt.stats)
+				results[i] += "\n    " + fusion_report(core);
+		}
+	};
+
+	unsigned int jobs = opt.jobs;
+
+	if (jobs == 0)
+		jobs = max(1u, thread::hardware_concurrency());
+
+	jobs = min<unsigned int>(jobs, static_cast<unsigned int>(names.size()));
+
+	vector<thread> pool;
+
+	for (unsigned int i = 1; i < jobs; i++)
+		pool.push_back(thread(worker));
+
+	worker();
+
+	for (size_t i = 0; i < pool.size(); i++)
+		pool[i].join();
+
+	int failures = 0;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		cout << results[i] << "\n";
+		failures += failed[i];
+	}
+
+	cout << names.size() - failures << "/" << names.size() << " ROMs " << (opt.update ? "updated" : "passed") << ".\n";
+
+	return failures;
+}
@@ -0,0 +1,55 @@
+#ifndef REGRESS_H
+#define REGRESS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chip8core.h"
+#include "movie.h"
+
+// wzorcowy strumien haszy klatek dla jednej gry (plik *.golden)
+struct GoldenStream
+{
+	unsigned int			cycles_per_frame	= 8;
+	int						timing				= Chip8Core::TIMING_FIXED;
+	unsigned int			seed				= 1;	// ziarno generatora Cxkk (stare wzorce: domyslne)
+	bool					with_regs			= false;
+	std::vector<uint64_t>	hashes;
+
+	bool load(const std::string& path);
+	bool save(const std::string& path) const;
+};
+
+// hasz obrazu, opcjonalnie razem z rejestrami, I, PC, stosem i timerami
+uint64_t frame_hash(const Chip8State& s, bool with_regs);
+inline uint64_t frame_hash(const Chip8Core& core, bool with_regs) { return frame_hash(core.state(), with_regs); }
+
+// wykonuje gre od resetu z nagranym wejsciem i zapisuje hasz kazdej klatki
+void run_hash_stream(Chip8Core& core, const InputMovie& movie, size_t frames, bool with_regs, std::vector<uint64_t>& out);
+
+// hit rate superinstrukcji w jednej linii, np. "fusion 41.2% (Annn+Dxyn 10.1%, ...)"
+std::string fusion_report(const Chip8Core& core);
+
+// numer pierwszej klatki, w ktorej strumienie sie roznia, albo -1
+long first_divergence(const std::vector<uint64_t>& expected, const std::vector<uint64_t>& actual);
+
+// sprawdza (albo przy update generuje od nowa) wszystkie gry NAZWA.ch8 z katalogu.
+// Wejscie z NAZWA.movie (jesli jest), wzorzec w NAZWA.golden. Gry sa
+// sprawdzane rownolegle; zwraca liczbe bledow
+struct CorpusOptions
+{
+	bool				update				= false;
+	size_t				default_frames		= 600;
+	bool				with_regs			= false;
+	unsigned int		cycles_per_frame	= 8;
+	int					timing				= Chip8Core::TIMING_FIXED;
+	unsigned int		seed				= 0;	// przy update; 0 = domyslne ziarno rdzenia
+	unsigned int		jobs				= 0;	// 0 = wszystkie rdzenie
+	bool				fusion				= true;
+	bool				stats				= false;
+	std::string			analysis_cache;		// puste = bez zapisanej analizy
+};
+
+int run_corpus(const std::string& dir, const CorpusOptions& opt);
+
+#endif
@@ -0,0 +1,587 @@
+#include "romanalysis.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace
+{
+	// jak instrukcja zmienia przeplyw sterowania
+	enum InstrKind
+	{
+		K_NORMAL = 0,
+		K_JUMP,
+		K_CALL,
+		K_RET,
+		K_SKIP,
+		K_INDIRECT,
+		K_INVALID
+	};
+
+	// podzial jak w Chip8Core::decode_opcode; instrukcje, ktore rdzen tylko
+	// zglasza jako nieznane, zwykle oznaczaja, ze wykonanie weszlo w dane
+	int classify(WORD op)
+	{
+		switch (op & 0xF000)
+		{
+		case 0x0000:
+			if ((op & 0x00FF) == 0x00E0)
+				return K_NORMAL;
+
+			return (op & 0x00FF) == 0x00EE ? K_RET : K_INVALID;
+		case 0x1000: return K_JUMP;
+		case 0x2000: return K_CALL;
+		case 0x3000:
+		case 0x4000:
+		case 0x5000:
+		case 0x9000: return K_SKIP;
+		case 0x8000:
+			return (op & 0x000F) <= 0x0007 || (op & 0x000F) == 0x000E ? K_NORMAL : K_INVALID;
+		case 0xB000: return K_INDIRECT;
+		case 0xE000:
+			return (op & 0x00FF) == 0x009E || (op & 0x00FF) == 0x00A1 ? K_SKIP : K_INVALID;
+		case 0xF000:
+			switch (op & 0x00FF)
+			{
+			case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E:
+			case 0x29: case 0x33: case 0x55: case 0x65:
+				return K_NORMAL;
+			default:
+				return K_INVALID;
+			}
+		default:
+			return K_NORMAL;
+		}
+	}
+
+	const char* const edge_names[RomAnalysis::EDGE_KINDS] = { "fall", "jump", "skip", "call" };
+}
+
+string disassemble(WORD op)
+{
+	const unsigned int x = (op >> 8) & 0xF;
+	const unsigned int y = (op >> 4) & 0xF;
+	const unsigned int n = op & 0xF;
+	const unsigned int kk = op & 0xFF;
+	const unsigned int nnn = op & 0xFFF;
+
+	char buf[32];
+
+	switch (op & 0xF000)
+	{
+	case 0x0000:
+		if (kk == 0xE0)
+			return "CLS";
+
+		if (kk == 0xEE)
+			return "RET";
+
+		snprintf(buf, sizeof(buf), "SYS 0x%03X", nnn);
+		break;
+	case 0x1000: snprintf(buf, sizeof(buf), "JP 0x%03X", nnn); break;
+	case 0x2000: snprintf(buf, sizeof(buf), "CALL 0x%03X", nnn); break;
+	case 0x3000: snprintf(buf, sizeof(buf), "SE V%X, 0x%02X", x, kk); break;
+	case 0x4000: snprintf(buf, sizeof(buf), "SNE V%X, 0x%02X", x, kk); break;
+	case 0x5000: snprintf(buf, sizeof(buf), "SE V%X, V%X", x, y); break;
+	case 0x6000: snprintf(buf, sizeof(buf), "LD V%X, 0x%02X", x, kk); break;
+	case 0x7000: snprintf(buf, sizeof(buf), "ADD V%X, 0x%02X", x, kk); break;
+	case 0x8000:
+	{
+		static const char* const ops[16] = { "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+			nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr };
+
+		if (!ops[n])
+			return "???";
+
+		snprintf(buf, sizeof(buf), "%s V%X, V%X", ops[n], x, y);
+	}
+		break;
+	case 0x9000: snprintf(buf, sizeof(buf), "SNE V%X, V%X", x, y); break;
+	case 0xA000: snprintf(buf, sizeof(buf), "LD I, 0x%03X", nnn); break;
+	case 0xB000: snprintf(buf, sizeof(buf), "JP V0, 0x%03X", nnn); break;
+	case 0xC000: snprintf(buf, sizeof(buf), "RND V%X, 0x%02X", x, kk); break;
+	case 0xD000: snprintf(buf, sizeof(buf), "DRW V%X, V%X, %u", x, y, n); break;
+	case 0xE000:
+		if (kk == 0x9E)
+			snprintf(buf, sizeof(buf), "SKP V%X", x);
+		else if (kk == 0xA1)
+			snprintf(buf, sizeof(buf), "SKNP V%X", x);
+		else
+			return "???";
+		break;
+	default:
+		switch (kk)
+		{
+		case 0x07: snprintf(buf, sizeof(buf), "LD V%X, DT", x); break;
+		case 0x0A: snprintf(buf, sizeof(buf), "LD V%X, K", x); break;
+		case 0x15: snprintf(buf, sizeof(buf), "LD DT, V%X", x); break;
+		case 0x18: snprintf(buf, sizeof(buf), "LD ST, V%X", x); break;
+		case 0x1E: snprintf(buf, sizeof(buf), "ADD I, V%X", x); break;
+		case 0x29: snprintf(buf, sizeof(buf), "LD F, V%X", x); break;
+		case 0x33: snprintf(buf, sizeof(buf), "LD B, V%X", x); break;
+		case 0x55: snprintf(buf, sizeof(buf), "LD [I], V%X", x); break;
+		case 0x65: snprintf(buf, sizeof(buf), "LD V%X, [I]", x); break;
+		default: return "???";
+		}
+		break;
+	}
+
+	return buf;
+}
+
+RomAnalysis::RomAnalysis()
+{
+	memset(flags, 0, sizeof(flags));
+}
+
+void RomAnalysis::analyze(const BYTE* image, size_t rom_size)
+{
+	memory = image;
+	rom_end = static_cast<WORD>(Chip8Core::game_start_addr + rom_size);
+	memset(flags, 0, sizeof(flags));
+	blocks.clear();
+
+	discover();
+	build_blocks();
+	find_data();
+}
+
+void RomAnalysis::discover()
+{
+	vector<WORD> work;
+
+	const auto add_target = [&](unsigned int addr, BYTE f)
+	{
+		addr &= ram_size - 1;
+		flags[addr] |= F_LEADER | f;
+		work.push_back(static_cast<WORD>(addr));
+	};
+
+	add_target(Chip8Core::game_start_addr, 0);
+
+	while (!work.empty())
+	{
+		WORD pc = work.back();
+		work.pop_back();
+
+		// liniowo az do instrukcji zmieniajacej przeplyw albo juz odkrytego kodu
+		while (!(flags[pc] & F_CODE) && pc + 1 < ram_size)
+		{
+			// skok w srodek innej instrukcji - dwa przesuniete ciagi instrukcji
+			if ((flags[pc] & F_OPERAND) || (flags[pc + 1] & F_CODE))
+			{
+				flags[pc] |= F_OVERLAP;
+				flags[pc + 1] |= F_OVERLAP;
+			}
+
+			flags[pc] |= F_CODE;
+			flags[pc + 1] |= F_OPERAND;
+
+			const WORD op = word_at(pc);
+			const int kind = classify(op);
+
+			if (kind == K_NORMAL)
+			{
+				pc += 2;
+				continue;
+			}
+
+			if (kind == K_JUMP)
+				add_target(op & 0x0FFF, F_JUMP_TARGET);
+			else if (kind == K_CALL)
+			{
+				add_target(op & 0x0FFF, F_CALL_TARGET);
+				add_target(pc + 2, F_JUMP_TARGET);
+			}
+			else if (kind == K_SKIP)
+			{
+				add_target(pc + 2, 0);
+				add_target(pc + 4, 0);
+			}
+
+			break;
+		}
+	}
+}
+
+void RomAnalysis::build_blocks()
+{
+	for (unsigned int start = 0; start < ram_size; start++)
+	{
+		if ((flags[start] & (F_LEADER | F_CODE)) != (F_LEADER | F_CODE))
+			continue;
+
+		Block b;
+		b.start = static_cast<WORD>(start);
+		b.returns = b.indirect = b.halts = b.invalid = false;
+
+		unsigned int pc = start;
+
+		for (;;)
+		{
+			const WORD op = word_at(static_cast<WORD>(pc));
+			const int kind = classify(op);
+			const unsigned int next = pc + 2;
+
+			if (kind == K_NORMAL)
+			{
+				if (next + 1 >= ram_size || !(flags[next] & F_CODE))
+				{
+					b.invalid = true;
+					b.end = static_cast<WORD>(next < ram_size ? next : ram_size);
+					break;
+				}
+
+				if (flags[next] & F_LEADER)
+				{
+					b.end = static_cast<WORD>(next);
+					b.out.push_back(Edge{ static_cast<WORD>(next), EDGE_FALL });
+					break;
+				}
+
+				pc = next;
+				continue;
+			}
+
+			b.end = static_cast<WORD>(next < ram_size ? next : ram_size);
+
+			switch (kind)
+			{
+			case K_JUMP:
+				b.out.push_back(Edge{ static_cast<WORD>(op & 0x0FFF), EDGE_JUMP });
+				b.halts = (op & 0x0FFF) == pc;
+				break;
+			case K_CALL:
+				b.out.push_back(Edge{ static_cast<WORD>(op & 0x0FFF), EDGE_CALL });
+				b.out.push_back(Edge{ static_cast<WORD>(next & (ram_size - 1)), EDGE_FALL });
+				break;
+			case K_SKIP:
+				b.out.push_back(Edge{ static_cast<WORD>(next & (ram_size - 1)), EDGE_FALL });
+				b.out.push_back(Edge{ static_cast<WORD>((pc + 4) & (ram_size - 1)), EDGE_SKIP });
+				break;
+			case K_RET:
+				b.returns = true;
+				break;
+			case K_INDIRECT:
+				b.indirect = true;
+				break;
+			default:
+				b.invalid = true;
+				break;
+			}
+
+			break;
+		}
+
+		blocks.push_back(b);
+	}
+}
+
+void RomAnalysis::mark(WORD addr, unsigned int len, BYTE flag)
+{
+	for (unsigned int i = 0; i < len && addr + i < ram_size; i++)
+		flags[addr + i] |= flag;
+}
+
+void RomAnalysis::find_data()
+{
+	// I jest znany tylko po Annn w tym samym bloku
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		bool known = false;
+		WORD I = 0;
+
+		for (unsigned int pc = blocks[i].start; pc + 1 < blocks[i].end; pc += 2)
+		{
+			const WORD op = word_at(static_cast<WORD>(pc));
+			const unsigned int x = (op >> 8) & 0xF;
+
+			if ((op & 0xF000) == 0xA000)
+			{
+				I = op & 0x0FFF;
+				known = true;
+			}
+			else if ((op & 0xF000) == 0xD000)
+			{
+				if (known)
+					mark(I, op & 0xF, F_SPRITE);
+			}
+			else if ((op & 0xF000) == 0xF000)
+			{
+				switch (op & 0x00FF)
+				{
+				case 0x33:
+					if (known)
+						mark(I, 3, F_DATA);
+					break;
+				case 0x55:
+				case 0x65:
+					if (known)
+						mark(I, x + 1, F_DATA);
+
+					// rdzen przesuwa I przy kopiowaniu
+					known = false;
+					break;
+				case 0x1E:
+				case 0x29:
+					known = false;
+					break;
+				default:
+					break;
+				}
+			}
+		}
+	}
+}
+
+WORD RomAnalysis::end_addr() const
+{
+	unsigned int end = rom_end;
+
+	for (unsigned int a = end; a < ram_size; a++)
+	{
+		if (flags[a] & (F_CODE | F_OPERAND | F_SPRITE | F_DATA))
+			end = a + 1;
+	}
+
+	return static_cast<WORD>(end);
+}
+
+unsigned int RomAnalysis::code_bytes() const
+{
+	unsigned int n = 0;
+
+	for (unsigned int a = Chip8Core::game_start_addr; a < ram_size; a++)
+		n += (flags[a] & (F_CODE | F_OPERAND)) != 0;
+
+	return n;
+}
+
+unsigned int RomAnalysis::data_bytes() const
+{
+	unsigned int n = 0;
+
+	for (unsigned int a = Chip8Core::game_start_addr; a < ram_size; a++)
+		n += (flags[a] & (F_SPRITE | F_DATA)) != 0;
+
+	return n;
+}
+
+std::string RomAnalysis::listing() const
+{
+	string out;
+	char buf[160];
+
+	snprintf(buf, sizeof(buf), "; %u blocks, %u code bytes, %u data bytes, game 0x%03X-0x%03X\n",
+		static_cast<unsigned int>(blocks.size()), code_bytes(), data_bytes(), Chip8Core::game_start_addr, rom_end - 1);
+	out += buf;
+
+	const unsigned int end = end_addr();
+
+	for (unsigned int a = Chip8Core::game_start_addr; a < end; )
+	{
+		const BYTE f = flags[a];
+
+		if (f & F_CODE)
+		{
+			if (f & F_CALL_TARGET)
+				snprintf(buf, sizeof(buf), "\nsub_%03X:\n", a);
+			else if (f & F_LEADER)
+				snprintf(buf, sizeof(buf), "\nL_%03X:\n", a);
+			else
+				buf[0] = 0;
+
+			out += buf;
+
+			const WORD op = word_at(static_cast<WORD>(a));
+			snprintf(buf, sizeof(buf), "  %03X  %04X  %s", a, op, disassemble(op).c_str());
+			out += buf;
+
+			if (f & F_OVERLAP)
+				out += "  ; overlaps another instruction";
+
+			if (f & (F_SPRITE | F_DATA))
+				out += "  ; also read as data";
+
+			out += '\n';
+
+			// przy nakladajacych sie ciagach drugi bajt moze byc poczatkiem innej instrukcji
+			a += (a + 1 < ram_size && (flags[a + 1] & F_CODE)) ? 1 : 2;
+			continue;
+		}
+
+		if (f & F_SPRITE)
+		{
+			char pixels[9];
+
+			for (int bit = 0; bit < 8; bit++)
+				pixels[bit] = memory[a] & (0x80 >> bit) ? '#' : '.';
+
+			pixels[8] = 0;
+
+			snprintf(buf, sizeof(buf), "  %03X  %02X    db 0x%02X            ; %s\n", a, memory[a], memory[a], pixels);
+			out += buf;
+			a++;
+			continue;
+		}
+
+		if (f & F_DATA)
+		{
+			snprintf(buf, sizeof(buf), "  %03X  %02X    db 0x%02X            ; variable\n", a, memory[a], memory[a]);
+			out += buf;
+			a++;
+			continue;
+		}
+
+		// nieuzywane bajty po 8 w linii
+		snprintf(buf, sizeof(buf), "  %03X        db ", a);
+		out += buf;
+
+		for (unsigned int i = 0; i < 8 && a < end && !(flags[a] & (F_CODE | F_SPRITE | F_DATA)); i++, a++)
+		{
+			snprintf(buf, sizeof(buf), i ? ", 0x%02X" : "0x%02X", memory[a]);
+			out += buf;
+		}
+
+		out += '\n';
+	}
+
+	return out;
+}
+
+std::string RomAnalysis::dot() const
+{
+	string out = "digraph chip8 {\n"
+		"\tnode [shape=box, fontname=\"monospace\", fontsize=10];\n";
+	char buf[160];
+
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		const Block& b = blocks[i];
+
+		snprintf(buf, sizeof(buf), "\tb%03X [label=\"", b.start);
+		out += buf;
+
+		if (flags[b.start] & F_CALL_TARGET)
+		{
+			snprintf(buf, sizeof(buf), "sub_%03X:\\l", b.start);
+			out += buf;
+		}
+
+		for (unsigned int pc = b.start; pc + 1 < b.end; pc += 2)
+		{
+			const WORD op = word_at(static_cast<WORD>(pc));
+			snprintf(buf, sizeof(buf), "%03X: %s\\l", pc, disassemble(op).c_str());
+			out += buf;
+		}
+
+		out += '"';
+
+		if (b.start == Chip8Core::game_start_addr)
+			out += ", peripheries=2";
+
+		if (b.invalid)
+			out += ", color=red";
+		else if (b.indirect)
+			out += ", color=orange";
+		else if (b.halts)
+			out += ", color=gray";
+
+		out += "];\n";
+
+		for (size_t e = 0; e < b.out.size(); e++)
+		{
+			static const char* const styles[EDGE_KINDS] = { "", " [label=\"jp\"]", " [style=dashed, label=\"skip\"]",
+				" [style=dotted, color=blue, label=\"call\"]" };
+
+			snprintf(buf, sizeof(buf), "\tb%03X -> b%03X%s;\n", b.start, b.out[e].to, styles[b.out[e].kind]);
+			out += buf;
+		}
+	}
+
+	out += "}\n";
+
+	return out;
+}
+
+std::string RomAnalysis::block_map() const
+{
+	string out = "# chip8 block map 1\n"
+		"# block START END [fall|jump|skip|call:ADDR]... [ret] [indirect] [halt] [invalid]\n"
+		"# sprite|data START END\n"
+		"# addresses in hex, END is one past the last byte\n";
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "rom 0x%03X 0x%03X\n", Chip8Core::game_start_addr, rom_end);
+	out += buf;
+
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		const Block& b = blocks[i];
+
+		snprintf(buf, sizeof(buf), "block 0x%03X 0x%03X", b.start, b.end);
+		out += buf;
+
+		for (size_t e = 0; e < b.out.size(); e++)
+		{
+			snprintf(buf, sizeof(buf), " %s:0x%03X", edge_names[b.out[e].kind], b.out[e].to);
+			out += buf;
+		}
+
+		if (b.returns)
+			out += " ret";
+
+		if (b.indirect)
+			out += " indirect";
+
+		if (b.halts)
+			out += " halt";
+
+		if (b.invalid)
+			out += " invalid";
+
+		out += '\n';
+	}
+
+	// ciagle zakresy danych
+	static const BYTE kinds[] = { F_SPRITE, F_DATA };
+	static const char* const names[] = { "sprite", "data" };
+
+	for (int k = 0; k < 2; k++)
+	{
+		for (unsigned int a = 0; a < ram_size; )
+		{
+			if (!(flags[a] & kinds[k]))
+			{
+				a++;
+				continue;
+			}
+
+			const unsigned int start = a;
+
+			while (a < ram_size && (flags[a] & kinds[k]))
+				a++;
+
+			snprintf(buf, sizeof(buf), "%s 0x%03X 0x%03X\n", names[k], start, a);
+			out += buf;
+		}
+	}
+
+	return out;
+}
+
+void RomAnalysis::predecode(Chip8Core& core) const
+{
+	// najpierw wszystkie cele skokow - superinstrukcja nie moze ich obejmowac
+	for (unsigned int a = 0; a < ram_size; a++)
+	{
+		if (flags[a] & (F_JUMP_TARGET | F_CALL_TARGET))
+			core.add_jump_target(static_cast<WORD>(a));
+	}
+
+	for (unsigned int a = 0; a < ram_size; a++)
+	{
+		if (flags[a] & F_CODE)
+			core.predecode(static_cast<WORD>(a));
+	}
+}
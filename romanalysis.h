@@ -0,0 +1,100 @@
+#ifndef ROMANALYSIS_H
+#define ROMANALYSIS_H
+
+#include <string>
+#include <vector>
+#include "chip8core.h"
+
+// tekst instrukcji w skladni Cowgoda ("LD I, 0x2A4", "DRW V0, V1, 5"); "???" dla nieznanej
+std::string disassemble(WORD opcode);
+
+// statyczna analiza gry bez jej uruchamiania: instrukcje sa odkrywane od 0x200
+// wzdluz skokow, wywolan i pominiec (SE, SNE, SKP, SKNP), z nich powstaje graf
+// przeplywu sterowania z blokow podstawowych. Dane sa oddzielane od kodu na
+// podstawie rejestru I ustawionego w tym samym bloku: sprite'y z Annn + Dxyn,
+// zmienne z Fx33, Fx55 i Fx65. Skoki Bnnn (JP V0, addr) nie sa sledzone
+class RomAnalysis
+{
+public:
+	static const WORD	ram_size		= Chip8Core::ram_size;
+
+	// znaczniki bajtow pamieci
+	enum Flag
+	{
+		F_CODE			= 0x01,		// pierwszy bajt instrukcji
+		F_OPERAND		= 0x02,		// drugi bajt instrukcji
+		F_LEADER		= 0x04,		// poczatek bloku
+		F_JUMP_TARGET	= 0x08,		// cel JP albo powrot z CALL
+		F_CALL_TARGET	= 0x10,		// poczatek funkcji
+		F_SPRITE		= 0x20,		// dane czytane przez Dxyn
+		F_DATA			= 0x40,		// dane czytane albo zapisywane przez Fx33, Fx55, Fx65
+		F_OVERLAP		= 0x80		// bajt nalezy do dwoch roznych ciagow instrukcji
+	};
+
+	enum EdgeKind
+	{
+		EDGE_FALL = 0,		// nastepna instrukcja
+		EDGE_JUMP,
+		EDGE_SKIP,			// instrukcja pominieta przez SE/SNE/SKP/SKNP
+		EDGE_CALL,			// wywolanie (blok konczy sie tez krawedzia EDGE_FALL do powrotu)
+		EDGE_KINDS
+	};
+
+	struct Edge
+	{
+		WORD			to;
+		int				kind;
+	};
+
+	struct Block
+	{
+		WORD			start;
+		WORD			end;			// pierwszy adres za blokiem
+		std::vector<Edge> out;
+		bool			returns;		// konczy sie RET
+		bool			indirect;		// konczy sie JP V0, addr
+		bool			halts;			// skok sam do siebie (koniec programu)
+		bool			invalid;		// konczy sie nieznana instrukcja albo poza pamiecia
+	};
+
+private:
+	const BYTE*			memory			= nullptr;
+	WORD				rom_end			= Chip8Core::game_start_addr;
+	BYTE				flags[ram_size];
+	std::vector<Block>	blocks;
+
+public:
+	RomAnalysis();
+
+	// image - obraz 4 KB (czcionka + gra, np. Chip8Core::image()), rom_size - dlugosc gry.
+	// Obraz musi zyc tak dlugo, jak ten obiekt
+	void analyze(const BYTE* image, size_t rom_size);
+
+	BYTE flag(WORD addr) const { return flags[addr & (ram_size - 1)]; }
+	const std::vector<Block>& get_blocks() const { return blocks; }
+	// ostatni adres objety gra albo odwolaniami z kodu (wylacznie)
+	WORD end_addr() const;
+
+	unsigned int code_bytes() const;
+	unsigned int data_bytes() const;
+
+	// listing: kod z etykietami, dane jako db (sprite'y z podgladem pikseli)
+	std::string listing() const;
+	// graf blokow dla Graphviz (dot -Tsvg)
+	std::string dot() const;
+	// mapa blokow w prostym formacie tekstowym, linia na blok albo zakres danych
+	std::string block_map() const;
+
+	// przenosi cele skokow i adresy kodu do rdzenia, zeby rozpoznal superinstrukcje
+	// z gory, zamiast przy pierwszym wykonaniu (patrz Chip8Core::predecode)
+	void predecode(Chip8Core& core) const;
+
+private:
+	WORD word_at(WORD addr) const { return (memory[addr] << 8) | memory[(addr + 1) & (ram_size - 1)]; }
+	void discover();
+	void build_blocks();
+	void find_data();
+	void mark(WORD addr, unsigned int len, BYTE flag);
+};
+
+#endif
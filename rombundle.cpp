@@ -0,0 +1,243 @@
+#include "rombundle.h"
+#include "hash.h"
+#include <algorithm> // sort
+#include <cstdio>
+#include <cstdlib> // strtoull
+#include <cstring> // memcmp, strcmp
+
+using namespace std;
+
+static const char bundle_magic[4] = { 'C', '8', 'R', 'B' };
+static const uint32_t bundle_version = 1;
+static const char bundle_ext[] = ".c8b:";
+
+static const size_t max_rom_size = Chip8Core::ram_size - Chip8Core::game_start_addr;
+
+bool RomBundle::open(const std::string& path)
+{
+	close();
+
+	if (!file.open_read(path) || file.size() < sizeof(BundleHeader))
+	{
+		close();
+		return false;
+	}
+
+	const unsigned char* base = file.data();
+	const size_t size = file.size();
+	const BundleHeader* h = reinterpret_cast<const BundleHeader*>(base);
+
+	if (memcmp(h->magic, bundle_magic, sizeof(bundle_magic)) != 0 || h->version != bundle_version)
+	{
+		close();
+		return false;
+	}
+
+	// indeks i tablica nazw musza sie miescic w pliku, a nazwy konczyc zerem
+	const size_t index_end = sizeof(BundleHeader) + static_cast<size_t>(h->count) * (sizeof(BundleEntry) + sizeof(uint32_t));
+
+	if (index_end > size || h->names_offset < index_end || h->names_size == 0
+		|| h->names_offset > size || h->names_size > size - h->names_offset
+		|| base[h->names_offset + h->names_size - 1] != 0
+		|| h->data_offset > size || h->data_size > size - h->data_offset)
+	{
+		close();
+		return false;
+	}
+
+	const BundleEntry* e = reinterpret_cast<const BundleEntry*>(base + sizeof(BundleHeader));
+	const uint32_t* order = reinterpret_cast<const uint32_t*>(base + sizeof(BundleHeader) + h->count * sizeof(BundleEntry));
+	const char* n = reinterpret_cast<const char*>(base + h->names_offset);
+
+	for (uint32_t i = 0; i < h->count; i++)
+	{
+		const bool bad_entry = e[i].name >= h->names_size || e[i].length > max_rom_size
+			|| e[i].offset < h->data_offset || e[i].offset - h->data_offset > h->data_size
+			|| e[i].length > h->data_size - (e[i].offset - h->data_offset)
+			|| (i > 0 && e[i - 1].hash > e[i].hash) || order[i] >= h->count;
+
+		if (bad_entry)
+		{
+			close();
+			return false;
+		}
+	}
+
+	// dopiero teraz wszystkie nazwy sa sprawdzone
+	for (uint32_t i = 1; i < h->count; i++)
+	{
+		if (strcmp(n + e[order[i - 1]].name, n + e[order[i]].name) >= 0)
+		{
+			close();
+			return false;
+		}
+	}
+
+	header = h;
+	entries = e;
+	by_name = order;
+	names = n;
+
+	return true;
+}
+
+void RomBundle::close()
+{
+	file.close();
+	header = nullptr;
+	entries = nullptr;
+	by_name = nullptr;
+	names = nullptr;
+}
+
+const BundleEntry* RomBundle::find_hash(uint64_t hash) const
+{
+	const BundleEntry* end = entries + size();
+	const BundleEntry* it = lower_bound(entries, end, hash,
+		[](const BundleEntry& e, uint64_t h) { return e.hash < h; });
+
+	return it != end && it->hash == hash ? it : nullptr;
+}
+
+const BundleEntry* RomBundle::find(const std::string& name) const
+{
+	if (!header)
+		return nullptr;
+
+	if (name.size() == 17 && name[0] == '#')
+	{
+		char* end = nullptr;
+		const uint64_t hash = strtoull(name.c_str() + 1, &end, 16);
+
+		return *end == 0 ? find_hash(hash) : nullptr;
+	}
+
+	const uint32_t* end = by_name + size();
+	const uint32_t* it = lower_bound(by_name, end, name.c_str(),
+		[this](uint32_t i, const char* s) { return strcmp(names + entries[i].name, s) < 0; });
+
+	return it != end && name == names + entries[*it].name ? &entries[*it] : nullptr;
+}
+
+bool RomBundle::split_path(const std::string& rom_path, std::string& bundle, std::string& name)
+{
+	// szukamy ".c8b:", a nie pierwszego dwukropka - sciezka moze miec litere dysku
+	const size_t pos = rom_path.rfind(bundle_ext);
+
+	if (pos == string::npos)
+		return false;
+
+	bundle = rom_path.substr(0, pos + sizeof(bundle_ext) - 2);
+	name = rom_path.substr(pos + sizeof(bundle_ext) - 1);
+
+	return true;
+}
+
+bool RomBundle::write(const std::string& path, const std::vector<BundleItem>& items)
+{
+	const uint32_t count = static_cast<uint32_t>(items.size());
+
+	// indeks po haszu (przy rownych haszach po nazwie) i po nazwie
+	vector<uint64_t> hashes(count);
+	vector<uint32_t> order(count), name_order(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (items[i].data.size() > max_rom_size)
+			return false;
+
+		hashes[i] = hash64(items[i].data.empty() ? nullptr : &items[i].data[0], items[i].data.size());
+		order[i] = i;
+	}
+
+	sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+		{ return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : items[a].name < items[b].name; });
+
+	vector<uint32_t> slot(count); // numer wpisu w indeksie dla gry i
+
+	for (uint32_t i = 0; i < count; i++)
+		slot[order[i]] = i;
+
+	for (uint32_t i = 0; i < count; i++)
+		name_order[i] = i;
+
+	sort(name_order.begin(), name_order.end(), [&](uint32_t a, uint32_t b)
+		{ return strcmp(items[a].name.c_str(), items[b].name.c_str()) < 0; });
+
+	for (uint32_t i = 1; i < count; i++)
+	{
+		if (items[name_order[i - 1]].name == items[name_order[i]].name)
+			return false; // powtorzona nazwa
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+		name_order[i] = slot[name_order[i]];
+
+	BundleHeader h;
+	memcpy(h.magic, bundle_magic, sizeof(bundle_magic));
+	h.version = bundle_version;
+	h.count = count;
+	h.names_offset = static_cast<uint32_t>(sizeof(BundleHeader) + count * (sizeof(BundleEntry) + sizeof(uint32_t)));
+	h.reserved = 0;
+
+	string name_blob;
+	vector<BYTE> data;
+	vector<BundleEntry> index(count);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const BundleItem& item = items[order[i]];
+		BundleEntry& e = index[i];
+
+		e.hash = hashes[order[i]];
+		e.name = static_cast<uint32_t>(name_blob.size());
+		e.length = static_cast<uint16_t>(item.data.size());
+		e.reserved = 0;
+		e.quirks = item.quirks;
+
+		name_blob += item.name;
+		name_blob += '\0';
+
+		// ta sama gra pod inna nazwa wskazuje ten sam obraz
+		if (i > 0 && index[i - 1].hash == e.hash && index[i - 1].length == e.length
+			&& memcmp(data.data() + index[i - 1].offset, item.data.data(), e.length) == 0)
+		{
+			e.offset = index[i - 1].offset;
+		}
+		else
+		{
+			e.offset = static_cast<uint32_t>(data.size());
+			data.insert(data.end(), item.data.begin(), item.data.end());
+		}
+	}
+
+	if (name_blob.empty())
+		name_blob += '\0';
+
+	h.names_size = static_cast<uint32_t>(name_blob.size());
+	h.data_offset = h.names_offset + h.names_size;
+	h.data_size = static_cast<uint32_t>(data.size());
+
+	for (uint32_t i = 0; i < count; i++)
+		index[i].offset += h.data_offset;
+
+	FILE* f = fopen(path.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+	if (count)
+	{
+		ok = ok && fwrite(&index[0], sizeof(BundleEntry), count, f) == count;
+		ok = ok && fwrite(&name_order[0], sizeof(uint32_t), count, f) == count;
+	}
+
+	ok = ok && fwrite(name_blob.data(), 1, name_blob.size(), f) == name_blob.size();
+
+	if (!data.empty())
+		ok = ok && fwrite(&data[0], 1, data.size(), f) == data.size();
+
+	return fclose(f) == 0 && ok;
+}
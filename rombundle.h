@@ -0,0 +1,79 @@
+#ifndef ROMBUNDLE_H
+#define ROMBUNDLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "chip8core.h"
+#include "mapfile.h"
+
+// paczka wielu gier w jednym pliku (*.c8b), czytana przez mmap. Uklad pliku
+// (liczby little endian):
+//   BundleHeader
+//   BundleEntry[count]      - indeks posortowany po haszu obrazu gry
+//   uint32_t[count]         - numery wpisow posortowane po nazwie
+//   nazwy                   - napisy zakonczone zerem
+//   obrazy gier             - jeden za drugim; identyczne gry sa zapisane raz
+struct BundleHeader
+{
+	char				magic[4];		// "C8RB"
+	uint32_t			version;
+	uint32_t			count;
+	uint32_t			names_offset;
+	uint32_t			names_size;
+	uint32_t			data_offset;
+	uint32_t			data_size;
+	uint32_t			reserved;
+};
+
+struct BundleEntry
+{
+	uint64_t			hash;			// hash64 obrazu gry
+	uint32_t			name;			// przesuniecie nazwy w tablicy nazw
+	uint32_t			offset;			// przesuniecie obrazu od poczatku pliku
+	uint16_t			length;
+	uint16_t			reserved;
+	uint32_t			quirks;			// Chip8Core::QUIRK_* wykryte przy pakowaniu
+};
+
+// gra do spakowania
+struct BundleItem
+{
+	std::string			name;
+	std::vector<BYTE>	data;
+	unsigned int		quirks			= 0;
+};
+
+class RomBundle
+{
+private:
+	MappedFile			file;
+	const BundleHeader*	header			= nullptr;
+	const BundleEntry*	entries			= nullptr;
+	const uint32_t*		by_name			= nullptr;
+	const char*			names			= nullptr;
+
+public:
+	// otwiera i sprawdza cala paczke (zakresy, kolejnosc indeksow), wiec
+	// pozniejsze wyszukiwanie moze jej ufac
+	bool open(const std::string& path);
+	void close();
+
+	size_t size() const { return header ? header->count : 0; }
+	const BundleEntry& entry(size_t i) const { return entries[i]; }
+	const char* name(const BundleEntry& e) const { return names + e.name; }
+	// obraz gry prosto z mapowania pliku
+	const BYTE* image(const BundleEntry& e) const { return file.data() + e.offset; }
+
+	// nazwa gry albo "#" i 16 cyfr szesnastkowych hasza; nullptr, gdy brak
+	const BundleEntry* find(const std::string& name) const;
+	const BundleEntry* find_hash(uint64_t hash) const;
+
+	// "paczka.c8b:NAZWA" -> paczka i nazwa; false dla zwyklej sciezki
+	static bool split_path(const std::string& rom_path, std::string& bundle, std::string& name);
+
+	// zapisuje paczke z podanych gier
+	static bool write(const std::string& path, const std::vector<BundleItem>& items);
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "romfile.h"
+#include "rombundle.h"
+#include <iostream>
+#include <fstream>
+
+using namespace std;
+
+// gra z paczki trafia do rdzenia prosto z mapowania pliku
+static bool load_bundled_rom(const std::string& bundle_path, const std::string& name, Chip8Core& core)
+{
+	RomBundle bundle;
+
+	if (!bundle.open(bundle_path))
+	{
+		cerr << "Can't read ROM bundle " << bundle_path << endl;
+		return false;
+	}
+
+	const BundleEntry* e = bundle.find(name);
+
+	if (!e)
+	{
+		cerr << "No game " << name << " in " << bundle_path << endl;
+		return false;
+	}
+
+	cout << "Reading " << bundle.name(*e) << " from " << bundle_path << " (" << e->length << " bytes).\n";
+
+	return core.load_rom(bundle.image(*e), e->length);
+}
+
+bool load_rom_file(const std::string& path, Chip8Core& core)
+{
+	string bundle_path, name;
+
+	if (RomBundle::split_path(path, bundle_path, name))
+		return load_bundled_rom(bundle_path, name, core);
+
+	// wczytujemy plik z gra
+
+	ifstream file(path, ifstream::binary);
+
+	if (file)
+	{
+		cout << "Reading file " << path << endl;
+
+		// wczytujemy rozmiar pliku
+		file.seekg(0, file.end);
+		const auto len = file.tellg();
+		file.seekg(0, file.beg);
+
+		cout << "File size is " << len << " bytes.\n";
+
+		if (len > (Chip8Core::ram_size - Chip8Core::game_start_addr))
+		{
+			cerr << "Game file is too big!\n";
+			return false;
+		}
+
+		BYTE rom[Chip8Core::ram_size - Chip8Core::game_start_addr];
+		file.read((char*)rom, len);
+
+		if (file)
+		{
+			cout << "File loaded successfully.\n";
+			return core.load_rom(rom, static_cast<size_t>(len));
+		}
+		else
+		{
+			cerr << "Error: loaded only " << file.gcount() << " bytes.\n";
+		}
+	}
+	else
+	{
+		cerr << "Can't read file " << path << endl;
+	}
+
+	return false;
+}
+
+bool read_rom_file(const std::string& path, std::vector<BYTE>& data)
+{
+	string bundle_path, name;
+
+	if (RomBundle::split_path(path, bundle_path, name))
+	{
+		RomBundle bundle;
+		const BundleEntry* e = bundle.open(bundle_path) ? bundle.find(name) : nullptr;
+
+		if (!e)
+			return false;
+
+		data.assign(bundle.image(*e), bundle.image(*e) + e->length);
+		return true;
+	}
+
+	ifstream file(path, ifstream::binary);
+
+	if (!file)
+		return false;
+
+	file.seekg(0, file.end);
+	const auto len = file.tellg();
+	file.seekg(0, file.beg);
+
+	if (len < 0 || len > (Chip8Core::ram_size - Chip8Core::game_start_addr))
+		return false;
+
+	data.resize(static_cast<size_t>(len));
+
+	if (len > 0)
+		file.read((char*)&data[0], len);
+
+	return static_cast<bool>(file);
+}
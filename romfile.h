@@ -0,0 +1,15 @@
+#ifndef ROMFILE_H
+#define ROMFILE_H
+
+#include <string>
+#include <vector>
+#include "chip8core.h"
+
+// wczytuje plik z gra do rdzenia; komunikaty leca na cout/cerr.
+// Sciezka "paczka.c8b:NAZWA" wczytuje gre z paczki (patrz rombundle.h)
+bool load_rom_file(const std::string& path, Chip8Core& core);
+
+// cichy odczyt calego pliku z gra do pamieci (np. dla wielu gier naraz)
+bool read_rom_file(const std::string& path, std::vector<BYTE>& data);
+
+#endif
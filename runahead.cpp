@@ -0,0 +1,63 @@
+#include "runahead.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring> // memcpy
+
+using namespace std;
+using namespace std::chrono;
+
+static unsigned long long ns_since(steady_clock::time_point t0)
+{
+	return static_cast<unsigned long long>(duration_cast<nanoseconds>(steady_clock::now() - t0).count());
+}
+
+bool RunAhead::run_frame(Chip8Core& core)
+{
+	shown = nullptr;
+
+	const auto t0 = steady_clock::now();
+	const bool done = core.run_frame();
+
+	// przy pulapkach debuggera przewidywanie mogloby zatrzymac sie w srodku
+	if (!done || depth == 0 || core.debugging())
+		return done;
+
+	const auto t1 = steady_clock::now();
+
+	// zapis i odtworzenie to kopie plaskiej struktury; restore_state przepisuje
+	// tylko strony pamieci zmienione w trakcie przewidywania
+	snapshot = core.state();
+
+	for (unsigned int i = 0; i < depth; i++)
+		core.run_frame();
+
+	memcpy(frame, core.framebuffer(), sizeof(frame));
+	shown = frame;
+
+	core.restore_state(snapshot);
+
+	base_ns += duration_cast<nanoseconds>(t1 - t0).count();
+	extra_ns += ns_since(t1);
+	frames++;
+
+	return done;
+}
+
+std::string RunAhead::report() const
+{
+	char buf[160];
+
+	if (!frames)
+	{
+		snprintf(buf, sizeof(buf), "run-ahead %u: no frames", depth);
+		return buf;
+	}
+
+	const double base = base_ns * 1e-3 / frames;
+	const double extra = extra_ns * 1e-3 / frames;
+
+	snprintf(buf, sizeof(buf), "run-ahead %u: %.2f us/frame emulation + %.2f us/frame run-ahead (+%.0f%%)",
+		depth, base, extra, base > 0 ? 100.0 * extra / base : 0.0);
+
+	return buf;
+}
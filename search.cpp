@@ -0,0 +1,444 @@
+#include "search.h"
+#include "hash.h"
+#include "regress.h"
+#include <algorithm> // max, min, push_heap, pop_heap, sort
+#include <chrono>
+#include <cstddef> // offsetof
+#include <cstdio>
+#include <cstring> // memcpy
+#include <thread>
+
+using namespace std;
+using namespace std::chrono;
+
+// w kolejce stan bez pamieci gry: reszta struktury w calosci i tylko strony
+// zmienione przez program (restore_state czyta z pamieci wylacznie je)
+static const size_t		rest_offset		= offsetof(Chip8State, registers);
+static const size_t		rest_size		= sizeof(Chip8State) - rest_offset;
+
+static void pack_state(const Chip8State& s, vector<BYTE>& out)
+{
+	size_t pages = 0;
+
+	for (int p = 0; p < Chip8State::pages; p++)
+		pages += s.dirty_pages >> p & 1;
+
+	out.resize(rest_size + pages * Chip8State::page_size);
+	memcpy(&out[0], &s.registers, rest_size);
+
+	BYTE* dst = &out[rest_size];
+
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		if (s.dirty_pages >> p & 1)
+		{
+			memcpy(dst, &s.game_memory[p * Chip8State::page_size], Chip8State::page_size);
+			dst += Chip8State::page_size;
+		}
+	}
+}
+
+static void unpack_state(const vector<BYTE>& in, Chip8State& s)
+{
+	memcpy(&s.registers, &in[0], rest_size);
+
+	const BYTE* src = &in[rest_size];
+
+	for (int p = 0; p < Chip8State::pages; p++)
+	{
+		if (s.dirty_pages >> p & 1)
+		{
+			memcpy(&s.game_memory[p * Chip8State::page_size], src, Chip8State::page_size);
+			src += Chip8State::page_size;
+		}
+	}
+}
+
+// hasz calego stanu maszyny. Klawisze pomijamy - sa ustawiane przed kazda
+// klatka; niezmienione strony pamieci sa rowne obrazowi gry, wiec wystarcza
+// zmienione. Kolizje 64-bitowych haszy (i tak nieprawdopodobne) moglyby
+// najwyzej odciac czesc przestrzeni
+static uint64_t state_hash(const Chip8State& s)
+{
+	uint64_t h = frame_hash(s, true);
+
+	h = hash64(&s.rng_state, sizeof(s.rng_state), h);
+	h = hash64(&s.vip_cycles, sizeof(s.vip_cycles), h);
+	h = hash64(&s.dirty_pages, sizeof(s.dirty_pages), h);
+
+	for (int p = 0; p < Chip8State::pages; p++)
+		if (s.dirty_pages >> p & 1)
+			h = hash64(&s.game_memory[p * Chip8State::page_size], Chip8State::page_size, h);
+
+	return h ? h : 1;
+}
+
+// kolejnosc w kopcu dla best-first: a ma nizszy priorytet niz b (nizszy wynik,
+// przy rownym dluzsza sciezka)
+struct OpenOrder
+{
+	template <class T>
+	bool operator()(const T& a, const T& b) const { return a.score != b.score ? a.score < b.score : a.depth > b.depth; }
+};
+
+bool StateSearch::insert(uint64_t hash)
+{
+	// liniowe probkowanie; slot zajmujemy przez CAS z pustego
+	for (size_t i = hash & table_mask; ; i = (i + 1) & table_mask)
+	{
+		uint64_t cur = table[i].load(memory_order_relaxed);
+
+		while (cur == 0)
+		{
+			if (table_count.load(memory_order_relaxed) >= table_limit)
+			{
+				table_full = true;
+				return false;
+			}
+
+			if (table[i].compare_exchange_weak(cur, hash, memory_order_relaxed))
+			{
+				table_count++;
+				return true;
+			}
+		}
+
+		if (cur == hash)
+			return false;
+	}
+}
+
+size_t StateSearch::used_bytes() const
+{
+	return (table_mask + 1) * sizeof(uint64_t) + nodes.capacity() * sizeof(Node) + open_bytes;
+}
+
+void StateSearch::push(Open&& o)
+{
+	open_bytes += sizeof(Open) + o.state.capacity();
+	open.push_back(move(o));
+
+	if (opt->best_first)
+		push_heap(open.begin(), open.end(), OpenOrder());
+}
+
+void StateSearch::prune()
+{
+	// best-first po przekroczeniu pamieci: wyrzucamy najgorsza czesc kolejki,
+	// az zostanie 3/4 limitu, zeby nie przycinac przy kazdym kroku
+	sort(open.begin(), open.end(), [](const Open& a, const Open& b) { return OpenOrder()(b, a); });
+
+	while (!open.empty() && used_bytes() > opt->memory_limit / 4 * 3)
+	{
+		open_bytes -= sizeof(Open) + open.back().state.capacity();
+		open.pop_back();
+		dropped++;
+	}
+
+	make_heap(open.begin(), open.end(), OpenOrder());
+}
+
+bool StateSearch::advance(Chip8Core& core, WORD mask, int& score, unsigned int& frames, WORD& observed)
+{
+	const SearchGoal& goal = opt->goal;
+
+	core.set_keys(mask);
+	core.take_observed_keys();
+	core.take_observed_bcd();
+
+	for (frames = 1; frames <= opt->frames_per_step; frames++)
+	{
+		// jedyna pulapka to cel PC - run_frame() zatrzymuje sie na niej w srodku
+		// klatki; PC rowny celowi na granicy klatki tez wystarcza
+		const bool done = core.run_frame();
+		const int bcd = core.take_observed_bcd();
+
+		frames_run++;
+		score = max(score, bcd);
+
+		if (!done || goal.pc == core.state().program_counter || (goal.score >= 0 && bcd >= goal.score) ||
+			(goal.screen && frame_hash(core.state(), false) == goal.screen_hash))
+		{
+			observed = core.take_observed_keys();
+			return true;
+		}
+	}
+
+	frames = opt->frames_per_step;
+	observed = core.take_observed_keys();
+
+	return false;
+}
+
+void StateSearch::reach_goal(const Open& from, WORD mask, unsigned int frames)
+{
+	lock_guard<mutex> guard(goal_lock);
+
+	const unsigned int depth = from.depth + frames;
+
+	if (found && depth >= goal_depth)
+		return;
+
+	goal_parent = from.node;
+	goal_mask = mask;
+	goal_frames = frames;
+	goal_depth = depth;
+	found = true;
+}
+
+void StateSearch::add_child(Chip8Core& core, const Open& from, WORD mask, int score, vector<Open>& out)
+{
+	const unsigned int depth = from.depth + opt->frames_per_step;
+
+	// z tej glebokosci nie ma juz pelnego kroku - nie ma po co zapamietywac
+	if (depth + opt->frames_per_step > opt->max_depth)
+		return;
+
+	if (!insert(state_hash(core.state())))
+	{
+		if (!table_full)
+			duplicates++;
+
+		return;
+	}
+
+	Open o;
+	pack_state(core.state(), o.state);
+	o.node = from.node;
+	o.mask = mask;
+	o.depth = depth;
+	o.score = score;
+
+	out.push_back(move(o));
+}
+
+void StateSearch::expand(Chip8Core& core, Chip8State& scratch, const Open& from, vector<Open>& out)
+{
+	unpack_state(from.state, scratch);
+	core.restore_state(scratch);
+
+	int score = from.score;
+	unsigned int frames;
+	WORD observed;
+
+	// probny krok ze wszystkimi klawiszami: kazda instrukcja sprawdzajaca ktorys
+	// z nich zostawi slad w observed. Bez sladu kazda maska da ten sam wynik.
+	// Cel osiagniety dzieki kilku klawiszom naraz sie nie liczy - w filmie
+	// maja byc tylko maski z listy
+	const bool reached = advance(core, all_keys, score, frames, observed);
+
+	if (!observed)
+	{
+		if (reached)
+			reach_goal(from, 0, frames);
+		else
+			add_child(core, from, 0, score, out);
+
+		return;
+	}
+
+	input_steps++;
+
+	for (size_t a = 0; a < opt->actions.size() && !found; a++)
+	{
+		const WORD mask = opt->actions[a];
+
+		core.restore_state(scratch);
+		score = from.score;
+
+		if (advance(core, mask, score, frames, observed))
+		{
+			reach_goal(from, mask, frames);
+			return;
+		}
+
+		add_child(core, from, mask, score, out);
+	}
+}
+
+void StateSearch::build_path()
+{
+	found_path.clear();
+
+	for (uint32_t n = goal_parent; n != no_parent && nodes[n].parent != no_parent; n = nodes[n].parent)
+		found_path.insert(found_path.end(), opt->frames_per_step, nodes[n].mask);
+
+	reverse(found_path.begin(), found_path.end());
+	found_path.insert(found_path.end(), goal_frames, goal_mask);
+}
+
+bool StateSearch::run(const Chip8Core& start, const SearchOptions& options)
+{
+	const auto t0 = steady_clock::now();
+
+	opt = &options;
+	all_keys = 0;
+
+	for (size_t i = 0; i < opt->actions.size(); i++)
+		all_keys |= opt->actions[i];
+
+	nodes.clear();
+	open.clear();
+	open_bytes = 0;
+	found_path.clear();
+	found = false;
+	goal_parent = no_parent;
+	frames_run = 0;
+	duplicates = 0;
+	input_steps = 0;
+	expanded = 0;
+	dropped = 0;
+	deepest = 0;
+	peak_bytes = 0;
+
+	// 1/8 pamieci na zbior haszy (potega dwojki), zapelniany najwyzej w 3/4
+	size_t slots = 1024;
+
+	while (slots * 2 * sizeof(uint64_t) <= opt->memory_limit / 8)
+		slots *= 2;
+
+	table.reset(new atomic<uint64_t>[slots]);
+
+	for (size_t i = 0; i < slots; i++)
+		table[i].store(0, memory_order_relaxed);
+
+	table_mask = slots - 1;
+	table_limit = slots / 4 * 3;
+	table_count = 0;
+	table_full = false;
+
+	threads = opt->jobs ? opt->jobs : max(1u, thread::hardware_concurrency());
+
+	// kazdy watek ma wlasny rdzen na obrazie gry startowego
+	vector<unique_ptr<Chip8Core>> cores(threads);
+	vector<Chip8State> scratch(threads);
+
+	for (unsigned int i = 0; i < threads; i++)
+	{
+		cores[i].reset(new Chip8Core);
+		cores[i]->share_image(start);
+		cores[i]->set_cycles_per_frame(start.get_cycles_per_frame());
+		cores[i]->set_timing(start.get_timing());
+		cores[i]->set_fusion(start.get_fusion());
+		cores[i]->restore_state(start.state());
+
+		if (opt->goal.pc >= 0)
+			cores[i]->set_breakpoint(static_cast<WORD>(opt->goal.pc), true);
+	}
+
+	nodes.push_back(Node{ no_parent, 0 });
+	insert(state_hash(start.state()));
+
+	if (opt->goal.pc == start.state().program_counter ||
+		(opt->goal.screen && frame_hash(start.state(), false) == opt->goal.screen_hash))
+	{
+		seconds = duration<double>(steady_clock::now() - t0).count();
+		return true;
+	}
+
+	Open root;
+	pack_state(start.state(), root.state);
+	root.node = 0;
+	root.mask = 0;
+	root.depth = 0;
+	root.score = -1;
+	push(move(root));
+
+	// paczka na tyle duza, zeby watki nie czekaly na siebie co kilka wezlow
+	const size_t batch_size = threads * 32;
+	vector<Open> batch;
+	vector<vector<Open>> children(threads);
+
+	while (!open.empty() && !found)
+	{
+		batch.clear();
+
+		while (!open.empty() && batch.size() < batch_size)
+		{
+			if (opt->best_first)
+				pop_heap(open.begin(), open.end(), OpenOrder());
+
+			Open& o = opt->best_first ? open.back() : open.front();
+			open_bytes -= sizeof(Open) + o.state.capacity();
+			batch.push_back(move(o));
+
+			if (opt->best_first)
+				open.pop_back();
+			else
+				open.pop_front();
+		}
+
+		atomic<size_t> next(0);
+
+		auto worker = [&](unsigned int w)
+		{
+			for (size_t k = next++; k < batch.size() && !found; k = next++)
+				expand(*cores[w], scratch[w], batch[k], children[w]);
+		};
+
+		vector<thread> pool;
+		const unsigned int active = static_cast<unsigned int>(min<size_t>(threads, batch.size()));
+
+		for (unsigned int w = 1; w < active; w++)
+			pool.push_back(thread(worker, w));
+
+		worker(0);
+
+		for (size_t i = 0; i < pool.size(); i++)
+			pool[i].join();
+
+		expanded += batch.size();
+
+		// dzieci dostaja numery wezlow dopiero teraz, w jednym watku
+		for (unsigned int w = 0; w < threads; w++)
+		{
+			for (size_t i = 0; i < children[w].size(); i++)
+			{
+				Open& c = children[w][i];
+
+				if (!opt->best_first && used_bytes() + sizeof(Open) + c.state.capacity() > opt->memory_limit)
+				{
+					dropped++;
+					continue;
+				}
+
+				nodes.push_back(Node{ c.node, c.mask });
+				c.node = static_cast<uint32_t>(nodes.size() - 1);
+				deepest = max(deepest, c.depth);
+				push(move(c));
+			}
+
+			children[w].clear();
+		}
+
+		peak_bytes = max(peak_bytes, used_bytes());
+
+		if (opt->best_first && used_bytes() > opt->memory_limit)
+			prune();
+
+		if (table_full)
+			break;
+	}
+
+	if (found)
+		build_path();
+
+	open.clear();
+	open_bytes = 0;
+	seconds = duration<double>(steady_clock::now() - t0).count();
+
+	return found;
+}
+
+string StateSearch::report() const
+{
+	char buf[512];
+
+	snprintf(buf, sizeof(buf),
+		"%llu states expanded, %llu unique, %llu duplicates, %llu with key input, %llu dropped\n"
+		"%llu frames emulated in %.2f s on %u threads (%.0f frames/s), deepest %u frames, peak memory %.1f MB",
+		expanded, static_cast<unsigned long long>(table_count.load()), duplicates.load(), input_steps.load(), dropped,
+		frames_run.load(), seconds, threads, seconds > 0 ? frames_run.load() / seconds : 0.0, deepest, peak_bytes / 1048576.0);
+
+	return buf;
+}
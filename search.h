@@ -0,0 +1,125 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "chip8core.h"
+
+// cel przeszukiwania; wystarczy osiagnac dowolny z ustawionych
+struct SearchGoal
+{
+	int					pc				= -1;		// adres instrukcji (-1 = bez celu)
+	int					score			= -1;		// wartosc >= score zamieniona na BCD (Fx33)
+	bool				screen			= false;
+	uint64_t			screen_hash		= 0;		// frame_hash(s, false), jak w --hash-out
+
+	bool any() const { return pc >= 0 || score >= 0 || screen; }
+};
+
+struct SearchOptions
+{
+	SearchGoal			goal;
+	std::vector<WORD>	actions;					// maski klawiszy probowane w kazdym kroku
+	unsigned int		frames_per_step	= 1;		// tyle klatek trwa jedna maska
+	unsigned int		max_depth		= 600;		// najdluzsza sciezka w klatkach
+	size_t				memory_limit	= size_t(1024) << 20;
+	unsigned int		jobs			= 0;		// 0 = wszystkie rdzenie
+	bool				best_first		= false;	// najpierw wyzszy wynik BCD zamiast wszerz
+};
+
+// przeszukiwanie przestrzeni stanow gry: od stanu poczatkowego probujemy masek
+// klawiszy krok po kroku, az program osiagnie cel. Wezly sa rozwijane paczkami
+// rownolegle (kazdy watek ma wlasny rdzen na wspolnym obrazie gry), a stany juz
+// widziane odrzuca wspolny zbior haszy calego stanu maszyny (tablica z otwartym
+// adresowaniem na atomowych slowach, bez blokad). Zanim sprobujemy wszystkich
+// masek, krok jest wykonywany z wcisnietymi wszystkimi klawiszami - jesli
+// program zadnego nie sprawdzil, wynik nie zalezy od wejscia i wystarczy jeden
+// potomek. Stany w kolejce trzymamy bez niezmienionych stron pamieci
+class StateSearch
+{
+public:
+	StateSearch() : table_count(0), table_full(false), found(false), frames_run(0), duplicates(0), input_steps(0) {}
+	StateSearch(const StateSearch&) = delete;
+	StateSearch& operator=(const StateSearch&) = delete;
+
+	// start: gra w stanie poczatkowym; nie jest zmieniana. false = cel nieosiagniety
+	// (przeszukane wszystko do max_depth albo skonczyla sie pamiec - patrz complete())
+	bool run(const Chip8Core& start, const SearchOptions& opt);
+
+	// maski kolejnych klatek od stanu poczatkowego do celu
+	const std::vector<WORD>& path() const { return found_path; }
+	// false = czesc stanow odrzucona z braku pamieci, wiec brak celu nic nie dowodzi
+	bool complete() const { return dropped == 0 && !table_full; }
+	std::string report() const;
+
+private:
+	static const uint32_t		no_parent		= 0xFFFFFFFF;
+
+	// drzewo sciezek: kazdy wezel to maska kroku i wezel, z ktorego wyszla
+	struct Node
+	{
+		uint32_t			parent;
+		WORD				mask;
+	};
+
+	struct Open
+	{
+		std::vector<BYTE>	state;		// pack_state()
+		uint32_t			node;		// u dziecka z watku na razie wezel rodzica
+		WORD				mask;
+		unsigned int		depth;		// w klatkach
+		int					score;		// najwyzsza wartosc BCD na sciezce
+	};
+
+	const SearchOptions*		opt				= nullptr;
+	WORD						all_keys		= 0;
+
+	std::vector<Node>			nodes;
+	std::deque<Open>			open;
+	size_t						open_bytes		= 0;
+
+	// zbior haszy odwiedzonych stanow; 0 oznacza pusty slot
+	std::unique_ptr<std::atomic<uint64_t>[]>	table;
+	size_t						table_mask		= 0;
+	size_t						table_limit		= 0;
+	std::atomic<size_t>			table_count;
+	std::atomic<bool>			table_full;
+
+	// cel: znaleziony przez dowolny watek, zostaje najkrotsza sciezka
+	std::mutex					goal_lock;
+	std::atomic<bool>			found;
+	uint32_t					goal_parent		= no_parent;
+	WORD						goal_mask		= 0;
+	unsigned int				goal_frames		= 0;
+	unsigned int				goal_depth		= 0;
+	std::vector<WORD>			found_path;
+
+	// statystyki
+	std::atomic<unsigned long long>	frames_run;
+	std::atomic<unsigned long long>	duplicates;
+	std::atomic<unsigned long long>	input_steps;	// kroki, w ktorych program czytal klawisze
+	unsigned long long			expanded		= 0;
+	unsigned long long			dropped			= 0;
+	unsigned int				deepest			= 0;
+	size_t						peak_bytes		= 0;
+	unsigned int				threads			= 1;
+	double						seconds			= 0;
+
+	bool insert(uint64_t hash);
+	size_t used_bytes() const;
+	void push(Open&& o);
+	void prune();
+
+	void expand(Chip8Core& core, Chip8State& scratch, const Open& from, std::vector<Open>& out);
+	bool advance(Chip8Core& core, WORD mask, int& score, unsigned int& frames, WORD& observed);
+	void add_child(Chip8Core& core, const Open& from, WORD mask, int score, std::vector<Open>& out);
+	void reach_goal(const Open& from, WORD mask, unsigned int frames);
+	void build_path();
+};
+
+#endif
@@ -0,0 +1,167 @@
+#include "session.h"
+#include "analysis.h"
+#include "hash.h"
+#include <chrono>
+#include <cstddef> // offsetof
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+static const char		session_magic[4]	= { 'C', '8', 'S', 'S' };
+static const uint32_t	session_version		= 1;
+
+// naglowek, dwa sloty i biezacy stan, kazde od granicy 64 bajtow
+static const size_t		header_size			= 64;
+static const size_t		slot_stride			= (sizeof(SessionFile::Slot) + 63) & ~static_cast<size_t>(63);
+static const size_t		live_offset			= header_size + 2 * slot_stride;
+static const size_t		file_size			= live_offset + sizeof(Chip8State);
+
+static_assert(sizeof(SessionFile::Header) <= header_size, "session header must fit in its block");
+
+SessionFile::SessionFile()
+	: written(0), quit(false)
+{
+}
+
+SessionFile::~SessionFile()
+{
+	close();
+}
+
+SessionFile::Slot* SessionFile::slot(uint64_t n) const
+{
+	return reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(slots) + (n & 1 ? 0 : slot_stride));
+}
+
+uint64_t SessionFile::slot_checksum(const Slot& s)
+{
+	return hash64(&s.seq, sizeof(Slot) - offsetof(Slot, seq));
+}
+
+bool SessionFile::open(const std::string& path, Chip8Core& c8, bool& resumed)
+{
+	close();
+	resumed = false;
+
+	if (!file.open_write(path, file_size))
+	{
+		cerr << "Can't open session file " << path << endl;
+		return false;
+	}
+
+	unsigned char* base = file.data();
+	Header* hdr = reinterpret_cast<Header*>(base);
+	slots = reinterpret_cast<Slot*>(base + header_size);
+	live = reinterpret_cast<Chip8State*>(base + live_offset);
+
+	const uint64_t game = image_hash(c8);
+	const bool same = memcmp(hdr->magic, session_magic, sizeof(session_magic)) == 0 && hdr->version == session_version
+		&& hdr->state_size == sizeof(Chip8State) && hdr->image_hash == game;
+
+	seq = 0;
+	frame = 0;
+
+	if (same)
+	{
+		// nowszy z poprawnych slotow; ten zapisywany w chwili awarii ma zla sume
+		const Slot* best = nullptr;
+
+		for (int i = 0; i < 2; i++)
+		{
+			const Slot* s = slot(i);
+
+			if (s->seq && s->checksum == slot_checksum(*s) && (!best || s->seq > best->seq))
+				best = s;
+		}
+
+		if (best)
+		{
+			c8.restore_state(best->state);
+			seq = best->seq;
+			frame = best->frame;
+			resumed = true;
+		}
+	}
+	else if (memcmp(hdr->magic, session_magic, sizeof(session_magic)) == 0)
+		cerr << "Session file " << path << " belongs to another game or version, starting a new session.\n";
+
+	if (!resumed)
+	{
+		memset(base, 0, live_offset);
+		memcpy(hdr->magic, session_magic, sizeof(session_magic));
+		hdr->version = session_version;
+		hdr->state_size = sizeof(Chip8State);
+		hdr->image_hash = game;
+	}
+
+	core = &c8;
+	core->attach_state(live);
+
+	written.store(0);
+	quit.store(false);
+	checkpoint();
+	syncer = thread(&SessionFile::sync_loop, this);
+
+	return true;
+}
+
+void SessionFile::checkpoint()
+{
+	Slot* s = slot(++seq);
+
+	s->seq = seq;
+	s->frame = frame;
+	s->reserved = 0;
+	memcpy(&s->state, &core->state(), sizeof(Chip8State));
+	s->checksum = slot_checksum(*s);
+
+	since = 0;
+	written.store(seq, memory_order_release);
+}
+
+void SessionFile::sync_loop()
+{
+	uint64_t synced = 0;
+
+	// checkpoint co pol sekundy i zapis trwajacy zwykle milisekundy - slot,
+	// ktory watek zapisuje, dlugo jeszcze nie bedzie nadpisywany. Biezacego
+	// stanu nie zapisujemy: po zapisie system chroni strony przed zapisem, zeby
+	// wykryc kolejne zmiany, i kazda klatka placilaby za to bledami stron
+	while (!quit.load())
+	{
+		const uint64_t w = written.load(memory_order_acquire);
+
+		if (w != synced)
+		{
+			file.sync(true, 0, live_offset);
+			synced = w;
+		}
+		else
+			this_thread::sleep_for(chrono::milliseconds(20));
+	}
+}
+
+void SessionFile::close()
+{
+	if (!core)
+		return;
+
+	checkpoint();
+
+	quit.store(true);
+
+	if (syncer.joinable())
+		syncer.join();
+
+	file.sync(true);
+
+	// inny modul (np. shm_export) mogl juz przeniesc stan gdzie indziej
+	if (&core->state() == live)
+		core->attach_state(nullptr);
+
+	file.close();
+	core = nullptr;
+	live = nullptr;
+	slots = nullptr;
+}
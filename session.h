@@ -0,0 +1,93 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "chip8core.h"
+#include "mapfile.h"
+
+// sesja odporna na awarie: stan rdzenia zyje w pliku zmapowanym w pamieci
+// (attach_state), wiec po zabiciu procesu (takze kill -9) zostaje w pamieci
+// podrecznej systemu. Ostatni stan moze byc jednak w polowie klatki, dlatego
+// co checkpoint_frames klatek jego kopia z numerem i suma kontrolna trafia na
+// przemian do jednego z dwoch slotow. Po restarcie wznawiamy z nowszego
+// poprawnego slotu. Zapis na dysk (msync) robi osobny watek, wiec petla klatek
+// nigdy na niego nie czeka - kosztuje ja tylko kopia stanu i hasz (kilka us)
+class SessionFile
+{
+public:
+	// domyslnie pol sekundy - przy kill -9 tracimy najwyzej tyle
+	static const unsigned int	default_checkpoint	= 30;
+
+	struct Header
+	{
+		char					magic[4];		// "C8SS"
+		uint32_t				version;
+		uint32_t				state_size;		// sizeof(Chip8State)
+		uint32_t				reserved;
+		uint64_t				image_hash;		// gra, do ktorej nalezy sesja
+	};
+
+	struct Slot
+	{
+		uint64_t				checksum;		// hash64 wszystkiego za tym polem
+		uint64_t				seq;			// 0 = pusty
+		uint64_t				frame;
+		uint64_t				reserved;
+		Chip8State				state;
+	};
+
+private:
+	MappedFile					file;
+	Chip8Core*					core			= nullptr;
+	Chip8State*					live			= nullptr;
+	Slot*						slots			= nullptr;
+	uint64_t					seq				= 0;
+	uint64_t					frame			= 0;
+	unsigned int				interval		= default_checkpoint;
+	unsigned int				since			= 0;
+
+	std::thread					syncer;
+	std::atomic<uint64_t>		written;		// ostatni zapisany checkpoint
+	std::atomic<bool>			quit;
+
+public:
+	SessionFile();
+	~SessionFile();
+
+	SessionFile(const SessionFile&) = delete;
+	SessionFile& operator=(const SessionFile&) = delete;
+
+	// otwiera albo tworzy plik sesji dla wczytanej gry. Jesli jest w nim poprawny
+	// stan tej gry, rdzen go dostaje (resumed = true). Potem stan rdzenia
+	// przenosi sie do pliku
+	bool open(const std::string& path, Chip8Core& c8, bool& resumed);
+	// ostatni checkpoint, zapis na dysk z czekaniem, rdzen wraca do wlasnego stanu
+	void close();
+	bool is_open() const { return core != nullptr; }
+
+	void set_interval(unsigned int frames) { interval = frames ? frames : 1; }
+	// numer klatki z wznowionej sesji (0 dla nowej)
+	uint64_t frame_number() const { return frame; }
+
+	// wolane po kazdej skonczonej klatce
+	void frame_done()
+	{
+		frame++;
+
+		if (core && ++since >= interval)
+			checkpoint();
+	}
+
+	void checkpoint();
+
+private:
+	void sync_loop();
+	// slot dla checkpointu n: nieparzyste w pierwszym, parzyste w drugim
+	Slot* slot(uint64_t n) const;
+	static uint64_t slot_checksum(const Slot& s);
+};
+
+#endif
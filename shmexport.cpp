@@ -0,0 +1,251 @@
+#include "shmexport.h"
+#include <cstring> // memcpy, memcmp
+#include <iostream>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char		shm_magic[4]	= { 'C', '8', 'S', 'H' };
+static const uint32_t	shm_version		= 1;
+static const uint32_t	state_offset	= 64;
+
+// tyle razy probujemy trafic miedzy klatki, zanim read() sie podda
+static const int		read_attempts	= 1000;
+
+static size_t segment_size()
+{
+	return state_offset + sizeof(Chip8State);
+}
+
+#ifdef _WIN32
+
+static string object_name(const string& name)
+{
+	return "Local\\chip8-" + name;
+}
+
+static void* map_segment(const string& name, bool create, void*& mapping)
+{
+	const size_t size = segment_size();
+
+	if (create)
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), object_name(name).c_str());
+	else
+		mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, object_name(name).c_str());
+
+	if (!mapping)
+		return nullptr;
+
+	void* p = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+
+	if (!p)
+	{
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+
+	return p;
+}
+
+static void unmap_segment(void* p, const string&, bool, void*& mapping)
+{
+	UnmapViewOfFile(p);
+	CloseHandle(mapping);
+	mapping = nullptr;
+}
+
+#else
+
+static string object_name(const string& name)
+{
+	return "/chip8-" + name;
+}
+
+static void* map_segment(const string& name, bool create)
+{
+	const size_t size = segment_size();
+	const int fd = shm_open(object_name(name).c_str(), create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+
+	if (fd < 0)
+		return nullptr;
+
+	struct stat sb;
+
+	if ((create && ftruncate(fd, size) != 0) || fstat(fd, &sb) != 0 || static_cast<size_t>(sb.st_size) < size)
+	{
+		::close(fd);
+
+		if (create)
+			shm_unlink(object_name(name).c_str());
+
+		return nullptr;
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+
+	return p == MAP_FAILED ? nullptr : p;
+}
+
+static void unmap_segment(void* p, const string& name, bool owner)
+{
+	munmap(p, segment_size());
+
+	if (owner)
+		shm_unlink(object_name(name).c_str());
+}
+
+#endif
+
+SharedExport::~SharedExport()
+{
+	close();
+}
+
+bool SharedExport::create(const std::string& segment, Chip8Core& c8)
+{
+	close();
+
+#ifdef _WIN32
+	void* p = map_segment(segment, true, mapping);
+#else
+	void* p = map_segment(segment, true);
+#endif
+
+	if (!p)
+	{
+		cerr << "Can't create shared memory segment " << object_name(segment) << endl;
+		return false;
+	}
+
+	hdr = new (p) SharedHeader;
+	memcpy(hdr->magic, shm_magic, sizeof(shm_magic));
+	hdr->version = shm_version;
+	hdr->state_size = sizeof(Chip8State);
+	hdr->state_offset = state_offset;
+	hdr->watchers.store(0);
+	hdr->reserved = 0;
+	hdr->seq.store(0);
+
+	name = segment;
+	owner = true;
+	size = segment_size();
+	seq = 0;
+
+	// od teraz rdzen pracuje wprost na stanie w segmencie
+	core = &c8;
+	core->attach_state(reinterpret_cast<Chip8State*>(static_cast<char*>(p) + state_offset));
+
+	cout << "Publishing state in shared memory " << object_name(segment) << ".\n";
+
+	return true;
+}
+
+bool SharedExport::attach(const std::string& segment)
+{
+	close();
+
+#ifdef _WIN32
+	void* p = map_segment(segment, false, mapping);
+#else
+	void* p = map_segment(segment, false);
+#endif
+
+	if (!p)
+		return false;
+
+	hdr = static_cast<SharedHeader*>(p);
+	name = segment;
+	owner = false;
+	size = segment_size();
+
+	if (memcmp(hdr->magic, shm_magic, sizeof(shm_magic)) != 0 || hdr->version != shm_version
+		|| hdr->state_size != sizeof(Chip8State) || hdr->state_offset != state_offset)
+	{
+		cerr << "Shared memory segment " << object_name(segment) << " has an unsupported layout\n";
+		close();
+		return false;
+	}
+
+	// zgloszenie podgladu, potem licznik: kazda klatka konczaca sie po
+	// tym odczycie juz wie o podgladzie i zaznaczy swoj poczatek
+	hdr->watchers.fetch_add(1);
+	attach_seq = hdr->seq.load();
+	synced = false;
+
+	return true;
+}
+
+void SharedExport::close()
+{
+	if (!hdr)
+		return;
+
+	if (core)
+	{
+		core->attach_state(nullptr);
+		core = nullptr;
+	}
+
+	if (!owner)
+		hdr->watchers.fetch_sub(1);
+
+#ifdef _WIN32
+	unmap_segment(hdr, name, owner, mapping);
+#else
+	unmap_segment(hdr, name, owner);
+#endif
+
+	hdr = nullptr;
+	owner = false;
+}
+
+bool SharedExport::read(Chip8State& out, uint64_t& frame)
+{
+	if (!hdr || owner)
+		return false;
+
+	const Chip8State* state = reinterpret_cast<const Chip8State*>(reinterpret_cast<const char*>(hdr) + hdr->state_offset);
+
+	for (int attempt = 0; attempt < read_attempts; attempt++)
+	{
+		const uint64_t before = hdr->seq.load(memory_order_acquire);
+
+		// klatka trwajaca w chwili podlaczenia mogla nie byc zaznaczona
+		if (!synced)
+		{
+			if (before == attach_seq)
+				return false;
+
+			synced = true;
+		}
+
+		if (before & 1)
+		{
+			this_thread::yield();
+			continue;
+		}
+
+		memcpy(&out, state, sizeof(Chip8State));
+		atomic_thread_fence(memory_order_acquire);
+
+		if (hdr->seq.load(memory_order_relaxed) == before)
+		{
+			frame = before / 2;
+			return true;
+		}
+	}
+
+	return false;
+}
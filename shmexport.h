@@ -0,0 +1,90 @@
+#ifndef SHMEXPORT_H
+#define SHMEXPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "chip8core.h"
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared-memory seqlock needs lock-free 64-bit atomics");
+
+// naglowek segmentu pamieci wspoldzielonej; za nim (od state_offset) lezy
+// Chip8State instancji. Strony pamieci gry niezmienione przez program maja
+// w nim nieokreslona zawartosc (patrz Chip8State::dirty_pages)
+struct SharedHeader
+{
+	char					magic[4];		// "C8SH"
+	uint32_t				version;
+	uint32_t				state_size;		// sizeof(Chip8State) u piszacego
+	uint32_t				state_offset;
+	std::atomic<uint32_t>	watchers;		// podlaczone podglady
+	uint32_t				reserved;
+	// seqlock: nieparzysty = trwa klatka; seq / 2 = liczba wykonanych klatek
+	std::atomic<uint64_t>	seq;
+};
+
+// publikacja stanu instancji w nazwanym segmencie pamieci wspoldzielonej
+// (shm_open / nazwane mapowanie w Windows) dla podgladow w innych procesach.
+// Stan rdzenia jest przenoszony do segmentu (attach_state), wiec emulator
+// niczego nie kopiuje. Bez podgladow klatka kosztuje jeden zapis licznika;
+// z podgladem dochodzi zapis nieparzystego licznika na poczatku klatki.
+// Podglad nigdy nie blokuje emulacji - przy zmianie licznika w trakcie
+// czytania po prostu czyta jeszcze raz
+class SharedExport
+{
+private:
+	SharedHeader*			hdr				= nullptr;
+	size_t					size			= 0;
+	std::string				name;
+	bool					owner			= false;
+	Chip8Core*				core			= nullptr;
+	uint64_t				seq				= 0;	// strona piszaca
+	uint64_t				attach_seq		= 0;	// strona czytajaca
+	bool					synced			= false;
+#ifdef _WIN32
+	void*					mapping			= nullptr;
+#endif
+
+public:
+	SharedExport() {}
+	~SharedExport();
+
+	SharedExport(const SharedExport&) = delete;
+	SharedExport& operator=(const SharedExport&) = delete;
+
+	// emulator: tworzy segment o danej nazwie i przenosi do niego stan rdzenia
+	bool create(const std::string& segment, Chip8Core& c8);
+	// podglad: podlacza sie do istniejacego segmentu
+	bool attach(const std::string& segment);
+	// emulator odzyskuje wlasny stan, segment jest usuwany
+	void close();
+	bool is_open() const { return hdr != nullptr; }
+
+	// emulator: nawias wokol wszystkiego, co zmienia stan w danej klatce
+	void begin_frame()
+	{
+		if (hdr && hdr->watchers.load())
+		{
+			hdr->seq.store(seq + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+	}
+
+	// zapis sekwencyjnie spojny: podglad, ktory zobaczy ten licznik, ma pewnosc,
+	// ze nastepna klatka zauwazy go w watchers (patrz read())
+	void end_frame()
+	{
+		if (hdr)
+		{
+			seq += 2;
+			hdr->seq.store(seq);
+		}
+	}
+
+	// podglad: spojna kopia stanu po ostatniej pelnej klatce; false, gdy
+	// emulator jeszcze nie zakonczyl klatki od podlaczenia albo nie udalo sie
+	// trafic miedzy klatki
+	bool read(Chip8State& out, uint64_t& frame);
+};
+
+#endif
@@ -0,0 +1,333 @@
+#include "wall.h"
+#include "chip8.h"
+#include "romfile.h"
+#include "rombundle.h"
+#include <chrono>
+#include <cmath> // sqrt
+#include <cstdio>
+#include <cstring> // memcmp
+#include <ctime> // time
+#include <iostream>
+#include "elapsedtimer.h"
+
+using namespace std;
+using namespace std::chrono;
+
+static const Uint32 pixel_on		= 0xFFFFFFFF;
+static const Uint32 pixel_off		= 0xFF000000;
+static const Uint32 border_color	= 0xFF303030;
+
+// okno miesci sie na typowym ekranie; piksel gry nie jest wiekszy niz pixel_size
+static const int max_window_w		= 1600;
+static const int max_window_h		= 900;
+
+static unsigned long long ns_since(steady_clock::time_point t0)
+{
+	return duration_cast<nanoseconds>(steady_clock::now() - t0).count();
+}
+
+Chip8Wall::Chip8Wall(const Chip8Config& cfg)
+	: batch(cfg.wall)
+{
+	const unsigned int count = batch.size();
+
+	columns = cfg.wall_columns ? cfg.wall_columns : static_cast<unsigned int>(ceil(sqrt(static_cast<double>(count))));
+	rows = (count + columns - 1) / columns;
+
+	frames.resize(static_cast<size_t>(count) * Chip8Batch::packed_frame_size);
+	shown.resize(frames.size());
+	actions.resize(count);
+
+	log_set_level(cfg.log_level);
+
+	batch.set_cycles_per_frame(cfg.cycles_per_frame);
+	batch.set_timing(cfg.timing);
+
+	for (unsigned int i = 0; i < count; i++)
+		batch.env(i).set_fusion(cfg.fusion);
+
+	loaded = load_roms(cfg);
+
+	batch.set_seed(cfg.seed ? cfg.seed : static_cast<unsigned int>(time(nullptr)));
+
+	init_display(cfg.pixel_size);
+}
+
+Chip8Wall::~Chip8Wall()
+{
+	if (atlas)
+		SDL_DestroyTexture(atlas);
+
+	if (renderer)
+		SDL_DestroyRenderer(renderer);
+
+	if (win)
+		SDL_DestroyWindow(win);
+
+	SDL_Quit();
+}
+
+bool Chip8Wall::load_roms(const Chip8Config& cfg)
+{
+	RomBundle bundle;
+
+	if (bundle.open(cfg.rom_path))
+	{
+		if (!bundle.size())
+			return false;
+
+		for (unsigned int i = 0; i < batch.size(); i++)
+		{
+			// kolejne instancje tej samej gry dziela obraz z pierwsza
+			if (i >= bundle.size())
+			{
+				batch.env(i).share_image(batch.env(i % bundle.size()));
+				continue;
+			}
+
+			const BundleEntry& e = bundle.entry(i);
+
+			if (!batch.env(i).load_rom(bundle.image(e), e.length))
+				return false;
+		}
+
+		cout << "Wall of " << batch.size() << " instances running " << bundle.size() << " games from " << cfg.rom_path << ".\n";
+		return true;
+	}
+
+	vector<BYTE> rom;
+
+	if (!read_rom_file(cfg.rom_path, rom))
+	{
+		cerr << "Can't read " << cfg.rom_path << endl;
+		return false;
+	}
+
+	if (!batch.load_rom(rom.empty() ? nullptr : &rom[0], rom.size()))
+		return false;
+
+	cout << "Wall of " << batch.size() << " instances running " << cfg.rom_path << ".\n";
+	return true;
+}
+
+void Chip8Wall::init_display(int pixel_size)
+{
+	video_ok = false;
+
+	if (SDL_Init(SDL_INIT_VIDEO) != 0)
+		return;
+
+	const int atlas_w = static_cast<int>(columns) * tile_w + 1;
+	const int atlas_h = static_cast<int>(rows) * tile_h + 1;
+
+	scale = pixel_size;
+
+	if (scale * atlas_w > max_window_w)
+		scale = max_window_w / atlas_w;
+
+	if (scale * atlas_h > max_window_h)
+		scale = max_window_h / atlas_h;
+
+	if (scale < 1)
+		scale = 1;
+
+	win = SDL_CreateWindow(
+		"CHIP-8 Emulator",
+		SDL_WINDOWPOS_CENTERED,
+		SDL_WINDOWPOS_CENTERED,
+		atlas_w * scale,
+		atlas_h * scale,
+		SDL_WINDOW_SHOWN);
+
+	if (!win)
+	{
+		cerr << "SDL_CreateWindow Error: " << SDL_GetError() << endl;
+		return;
+	}
+
+	renderer = SDL_CreateRenderer(
+		win,
+		-1,
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+
+	// bez karty graficznej zostaje renderer programowy
+	if (!renderer)
+		renderer = SDL_CreateRenderer(win, -1, SDL_RENDERER_SOFTWARE);
+
+	if (!renderer)
+	{
+		cerr << "SDL_CreateRenderer Error: " << SDL_GetError() << endl;
+		return;
+	}
+
+	atlas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, atlas_w, atlas_h);
+
+	if (!atlas)
+	{
+		cerr << "SDL_CreateTexture Error: " << SDL_GetError() << endl;
+		return;
+	}
+
+	clear_atlas();
+
+	video_ok = true;
+}
+
+void Chip8Wall::clear_atlas()
+{
+	void* pixels;
+	int pitch;
+
+	if (SDL_LockTexture(atlas, nullptr, &pixels, &pitch) != 0)
+		return;
+
+	const int atlas_w = static_cast<int>(columns) * tile_w + 1;
+	const int atlas_h = static_cast<int>(rows) * tile_h + 1;
+
+	// ramki miedzy kafelkami; wnetrza kafelkow nadpisze pierwsza klatka
+	for (int y = 0; y < atlas_h; y++)
+	{
+		Uint32* row = reinterpret_cast<Uint32*>(static_cast<BYTE*>(pixels) + y * pitch);
+
+		for (int x = 0; x < atlas_w; x++)
+			row[x] = border_color;
+	}
+
+	SDL_UnlockTexture(atlas);
+
+	repaint = true;
+}
+
+void Chip8Wall::upload_tile(unsigned int i)
+{
+	SDL_Rect r;
+	r.x = 1 + static_cast<int>(i % columns) * tile_w;
+	r.y = 1 + static_cast<int>(i / columns) * tile_h;
+	r.w = Chip8Core::width;
+	r.h = Chip8Core::height;
+
+	void* pixels;
+	int pitch;
+
+	if (SDL_LockTexture(atlas, &r, &pixels, &pitch) != 0)
+		return;
+
+	const BYTE* packed = &frames[static_cast<size_t>(i) * Chip8Batch::packed_frame_size];
+
+	for (int y = 0; y < Chip8Core::height; y++)
+	{
+		Uint32* row = reinterpret_cast<Uint32*>(static_cast<BYTE*>(pixels) + y * pitch);
+
+		for (int x = 0; x < Chip8Core::width; x += 8)
+		{
+			const BYTE bits = *packed++;
+
+			for (int b = 0; b < 8; b++)
+				row[x + b] = (bits & (0x80 >> b)) ? pixel_on : pixel_off;
+		}
+	}
+
+	SDL_UnlockTexture(atlas);
+}
+
+void Chip8Wall::draw()
+{
+	const auto t0 = steady_clock::now();
+
+	for (unsigned int i = 0; i < batch.size(); i++)
+	{
+		const size_t offset = static_cast<size_t>(i) * Chip8Batch::packed_frame_size;
+
+		if (repaint || memcmp(&frames[offset], &shown[offset], Chip8Batch::packed_frame_size) != 0)
+		{
+			upload_tile(i);
+			tiles_uploaded++;
+		}
+	}
+
+	// wyslane obrazy staja sie wzorcem dla nastepnej klatki
+	frames.swap(shown);
+	repaint = false;
+
+	const auto t1 = steady_clock::now();
+	upload_ns += duration_cast<nanoseconds>(t1 - t0).count();
+
+	SDL_RenderCopy(renderer, atlas, nullptr, nullptr);
+	SDL_RenderPresent(renderer);
+
+	present_ns += ns_since(t1);
+}
+
+int Chip8Wall::game_loop()
+{
+	if (!video_ok)
+	{
+		cerr << "Couldn't initialize video! Quitting...\n";
+		getchar();
+		return -1;
+	}
+
+	if (!loaded)
+	{
+		cerr << "Game file not loaded! Quitting...\n";
+		getchar();
+		return -1;
+	}
+
+	cout << "\nStarting the wall...\n\n";
+
+	ElapsedTimer tim(1000 / 60);
+
+	while (alive)
+	{
+		if (tim.elapsed())
+		{
+			tim.tic();
+
+			// klawiatura steruje wszystkimi instancjami naraz
+			const Uint8* kb = SDL_GetKeyboardState(nullptr);
+			const WORD keys = Chip8::keypad_mask(kb);
+
+			for (size_t i = 0; i < actions.size(); i++)
+				actions[i] = keys;
+
+			alive = kb[SDL_SCANCODE_ESCAPE] ? false : true;
+
+			const auto t0 = steady_clock::now();
+			batch.step(&actions[0], 1, &frames[0], nullptr, nullptr);
+			step_ns += ns_since(t0);
+
+			draw();
+			frames_run++;
+		}
+
+		sdl_events();
+		SDL_Delay(1);
+	}
+
+	cout << "Game Over.\n" << report() << "\n";
+
+	return 0;
+}
+
+void Chip8Wall::sdl_events()
+{
+	SDL_Event evt;
+
+	while (SDL_PollEvent(&evt))
+	{
+		if (evt.type == SDL_QUIT)
+			alive = false;
+	}
+}
+
+std::string Chip8Wall::report() const
+{
+	const double n = frames_run ? static_cast<double>(frames_run) : 1.0;
+	char buf[192];
+
+	snprintf(buf, sizeof(buf), "wall: %u tiles, %llu frames, %.1f tiles uploaded/frame, step %.2f ms, upload %.2f ms, present %.2f ms",
+		batch.size(), frames_run, tiles_uploaded / n, step_ns * 1e-6 / n, upload_ns * 1e-6 / n, present_ns * 1e-6 / n);
+
+	return buf;
+}
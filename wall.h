@@ -0,0 +1,70 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <string>
+#include <vector>
+#include "SDL.h"
+#include "chip8_batch.h"
+#include "config.h"
+
+// sciana wielu gier w jednym oknie (monitoring, kioski). Wszystkie instancje
+// sa krokowane razem przez Chip8Batch, ktory od razu pakuje obrazy bit na piksel.
+// Obrazy leza w jednej teksturze-atlasie (streaming, 1 teksel na piksel), do
+// ktorej wysylamy tylko kafelki zmienione od poprzedniej klatki; cala sciana
+// to jedno kopiowanie tekstury i jeden present
+class Chip8Wall
+{
+private:
+	static const int	tile_w			= Chip8Core::width + 1;		// z ramka 1 teksela
+	static const int	tile_h			= Chip8Core::height + 1;
+
+	Chip8Batch			batch;
+	unsigned int		columns;
+	unsigned int		rows;
+	int					scale			= 1;
+	bool				loaded			= false;
+	bool				video_ok		= false;
+	bool				alive			= true;
+	bool				repaint			= true;		// nastepna klatka wysyla wszystkie kafelki
+
+	// obrazy z biezacej i poprzedniej klatki (Chip8Batch::packed_frame_size na kafelek)
+	std::vector<BYTE>	frames;
+	std::vector<BYTE>	shown;
+	std::vector<WORD>	actions;
+
+	// statystyka
+	unsigned long long	frames_run		= 0;
+	unsigned long long	tiles_uploaded	= 0;
+	unsigned long long	step_ns			= 0;
+	unsigned long long	upload_ns		= 0;
+	unsigned long long	present_ns		= 0;
+
+	// rzeczy od SDLa
+	SDL_Window*			win				= nullptr;
+	SDL_Renderer*		renderer		= nullptr;
+	SDL_Texture*		atlas			= nullptr;
+
+public:
+	// cfg.wall instancji; gdy rom_path to paczka *.c8b, kolejne instancje
+	// dostaja kolejne gry z paczki, w przeciwnym razie ta sama gre z ziarnami seed + i
+	explicit Chip8Wall(const Chip8Config& cfg);
+	~Chip8Wall();
+
+	Chip8Wall(const Chip8Wall&) = delete;
+	Chip8Wall& operator=(const Chip8Wall&) = delete;
+
+	int game_loop();
+
+	// np. "wall: 256 tiles, 1200 frames, 31.2 tiles uploaded/frame, step 0.21 ms, upload 0.05 ms, present 0.80 ms"
+	std::string report() const;
+
+private:
+	bool load_roms(const Chip8Config& cfg);
+	void init_display(int pixel_size);
+	void clear_atlas();
+	void upload_tile(unsigned int i);
+	void draw();
+	void sdl_events();
+};
+
+#endif